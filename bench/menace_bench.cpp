@@ -0,0 +1,1989 @@
+/*
+Frame-time benchmark
+
+Drives the render loop headless for a fixed number of frames over synthetic scenes and writes json
+(menace_bench.json unless --output is given):
+    ./menace_bench --frames 300 --output bench.json
+    ./menace_bench --scene drawcalls --scale 4
+
+Per frame we record the cpu time spent submitting the frame and the gpu time from a GL_TIME_ELAPSED query.
+Queries are read back a few frames late from a ring so the readback never stalls the pipeline,
+which also throttles the cpu to at most kQueryLatency frames ahead, like a swap chain would.
+All scene data comes from a fixed seed so runs are comparable between commits.
+*/
+#include <glad/glad.h>
+#include "HeadlessContext.h"
+#include "Framebuffer.h"
+#include "ShaderManager.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "Renderer.h"
+#include "Object3D.h"
+#include "RingBuffer.h"
+#include "GLState.h"
+#include "AssetStreamer.h"
+#include "SimdMath.h"
+#include "TransformHierarchy.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "OcclusionRasterizer.h"
+#include "MeshletCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef MENACE_GIT_REVISION
+#define MENACE_GIT_REVISION "unknown"
+#endif
+
+static const int kQueryLatency = 4;
+
+//--------------------------------------------------SHADERS----------------------------------------------------------------------
+
+static const char* benchVertexSource = "#version 330 core\n"
+                                       "layout (location = 0) in vec3 aPos;\n"
+                                       "layout (location = 1) in vec3 aColor;\n"
+                                       "uniform vec2 uOffset;\n"
+                                       "out vec3 vColor;\n"
+                                       "void main()\n"
+                                       "{\n"
+                                       "   vColor = aColor;\n"
+                                       "   gl_Position = vec4(aPos.xy + uOffset, aPos.z, 1.0);\n"
+                                       "}\n";
+
+//Object3D scenes: the model matrix comes per instance (attributes 3-6) or per draw (uniform)
+static const char* benchInstancedVertexSource = "#version 330 core\n"
+                                                "layout (location = 0) in vec3 aPos;\n"
+                                                "layout (location = 1) in vec3 aColor;\n"
+                                                "layout (location = 3) in mat4 aModel;\n"
+                                                "out vec3 vColor;\n"
+                                                "void main()\n"
+                                                "{\n"
+                                                "   vColor = aColor;\n"
+                                                "   gl_Position = aModel * vec4(aPos, 1.0);\n"
+                                                "}\n";
+
+static const char* benchUniformModelVertexSource = "#version 330 core\n"
+                                                   "layout (location = 0) in vec3 aPos;\n"
+                                                   "layout (location = 1) in vec3 aColor;\n"
+                                                   "uniform mat4 uModel;\n"
+                                                   "out vec3 vColor;\n"
+                                                   "void main()\n"
+                                                   "{\n"
+                                                   "   vColor = aColor;\n"
+                                                   "   gl_Position = uModel * vec4(aPos, 1.0);\n"
+                                                   "}\n";
+
+//the tint constant is patched per variant so every program is a genuinely different binary
+static std::string benchFragmentSource(int variant)
+{
+    float tint = (variant % 16) / 16.0f;
+    return "#version 330 core\n"
+           "in vec3 vColor;\n"
+           "out vec4 FragColor;\n"
+           "void main()\n"
+           "{\n"
+           "   FragColor = vec4(vColor * " + std::to_string(1.0f - tint * 0.5f) + ", 1.0);\n"
+           "}\n";
+}
+
+static GLuint compileBenchProgram(int variant, const char* vertexSource = benchVertexSource)
+{
+    std::string fragmentSource = benchFragmentSource(variant);
+    const char* fragmentText = fragmentSource.c_str();
+
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentText, NULL);
+    glCompileShader(fragmentShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR: BENCH PROGRAM LINKING FAILED\n" << infoLog << std::endl;
+    }
+    return program;
+}
+
+//--------------------------------------------------SCENES----------------------------------------------------------------------
+
+//appends one small random triangle (pos + color, 6 floats per vertex) inside the [-1, 1] square
+static void appendTriangle(std::vector<float>& vertices, std::mt19937& rng, float size)
+{
+    std::uniform_real_distribution<float> position(-1.0f + size, 1.0f - size);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float cx = position(rng), cy = position(rng), z = unit(rng) * 2.0f - 1.0f;
+    const float corners[3][2] = { { -size, -size }, { size, -size }, { 0.0f, size } };
+    for (const auto& corner : corners) {
+        vertices.insert(vertices.end(), { cx + corner[0], cy + corner[1], z, unit(rng), unit(rng), unit(rng) });
+    }
+}
+
+static GLuint uploadVertices(const std::vector<float>& vertices, GLuint& VBO)
+{
+    GLuint VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    return VAO;
+}
+
+class BenchScene {
+    public:
+        virtual ~BenchScene() = default;
+        virtual const char* Name() const = 0;
+        virtual void Setup() = 0;
+        virtual void Draw() = 0;
+        virtual void Teardown() = 0;
+
+        //scene specific numbers for the json, e.g. mesh statistics
+        virtual void Stats(std::vector<std::pair<std::string, double>>& stats) const { (void)stats; }
+
+        //the size parameter of the scene, reported in the json
+        int count = 0;
+};
+
+//N triangles in a single buffer and a single draw call, measures raw vertex/raster throughput
+class TrianglesScene : public BenchScene {
+    public:
+        explicit TrianglesScene(int triangles) { count = triangles; }
+        const char* Name() const override { return "triangles"; }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            std::vector<float> vertices;
+            vertices.reserve((std::size_t)count * 18);
+            for (int i = 0; i < count; ++i) {
+                appendTriangle(vertices, rng, 0.02f);
+            }
+            program_ = compileBenchProgram(0);
+            VAO_ = uploadVertices(vertices, VBO_);
+        }
+
+        void Draw() override {
+            glUseProgram(program_);
+            glUniform2f(glGetUniformLocation(program_, "uOffset"), 0.0f, 0.0f);
+            glBindVertexArray(VAO_);
+            glDrawArrays(GL_TRIANGLES, 0, count * 3);
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays(1, &VAO_);
+            glDeleteBuffers(1, &VBO_);
+            glDeleteProgram(program_);
+        }
+
+    private:
+        GLuint program_ = 0, VAO_ = 0, VBO_ = 0;
+};
+
+//N separate meshes (own VAO + VBO each), measures the cost of binding geometry per object
+class MeshesScene : public BenchScene {
+    public:
+        explicit MeshesScene(int meshes) { count = meshes; }
+        const char* Name() const override { return "meshes"; }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            program_ = compileBenchProgram(0);
+            VAOs_.resize(count);
+            VBOs_.resize(count);
+            for (int i = 0; i < count; ++i) {
+                //a handful of triangles per mesh so the draw is not entirely empty
+                std::vector<float> vertices;
+                for (int t = 0; t < 8; ++t) {
+                    appendTriangle(vertices, rng, 0.01f);
+                }
+                VAOs_[i] = uploadVertices(vertices, VBOs_[i]);
+            }
+        }
+
+        void Draw() override {
+            glUseProgram(program_);
+            glUniform2f(glGetUniformLocation(program_, "uOffset"), 0.0f, 0.0f);
+            for (GLuint VAO : VAOs_) {
+                glBindVertexArray(VAO);
+                glDrawArrays(GL_TRIANGLES, 0, 8 * 3);
+            }
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays((GLsizei)VAOs_.size(), VAOs_.data());
+            glDeleteBuffers((GLsizei)VBOs_.size(), VBOs_.data());
+            glDeleteProgram(program_);
+        }
+
+    private:
+        GLuint program_ = 0;
+        std::vector<GLuint> VAOs_, VBOs_;
+};
+
+//N draw calls of one triangle each from a single VAO with a uniform change in between, measures per-draw overhead
+class DrawCallsScene : public BenchScene {
+    public:
+        explicit DrawCallsScene(int draws) { count = draws; }
+        const char* Name() const override { return "drawcalls"; }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> offset(-0.9f, 0.9f);
+            std::vector<float> vertices;
+            appendTriangle(vertices, rng, 0.01f);
+            offsets_.resize((std::size_t)count * 2);
+            for (float& value : offsets_) {
+                value = offset(rng);
+            }
+            program_ = compileBenchProgram(0);
+            offsetLocation_ = glGetUniformLocation(program_, "uOffset");
+            VAO_ = uploadVertices(vertices, VBO_);
+        }
+
+        void Draw() override {
+            glUseProgram(program_);
+            glBindVertexArray(VAO_);
+            for (int i = 0; i < count; ++i) {
+                glUniform2f(offsetLocation_, offsets_[i * 2], offsets_[i * 2 + 1]);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays(1, &VAO_);
+            glDeleteBuffers(1, &VBO_);
+            glDeleteProgram(program_);
+        }
+
+    private:
+        GLuint program_ = 0, VAO_ = 0, VBO_ = 0;
+        GLint offsetLocation_ = -1;
+        std::vector<float> offsets_;
+};
+
+//N program switches per frame cycling through a fixed set of programs, measures glUseProgram + validation cost
+class ShaderSwitchesScene : public BenchScene {
+    public:
+        explicit ShaderSwitchesScene(int switches) { count = switches; }
+        const char* Name() const override { return "shader_switches"; }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            std::vector<float> vertices;
+            appendTriangle(vertices, rng, 0.01f);
+            for (int i = 0; i < kPrograms; ++i) {
+                programs_.push_back(compileBenchProgram(i));
+                offsetLocations_.push_back(glGetUniformLocation(programs_.back(), "uOffset"));
+            }
+            VAO_ = uploadVertices(vertices, VBO_);
+        }
+
+        void Draw() override {
+            glBindVertexArray(VAO_);
+            for (int i = 0; i < count; ++i) {
+                int program = i % kPrograms;
+                glUseProgram(programs_[program]);
+                glUniform2f(offsetLocations_[program], (program - kPrograms / 2) * 0.05f, 0.0f);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays(1, &VAO_);
+            glDeleteBuffers(1, &VBO_);
+            for (GLuint program : programs_) {
+                glDeleteProgram(program);
+            }
+            programs_.clear();
+            offsetLocations_.clear();
+        }
+
+    private:
+        static const int kPrograms = 32;
+        GLuint VAO_ = 0, VBO_ = 0;
+        std::vector<GLuint> programs_;
+        std::vector<GLint> offsetLocations_;
+};
+
+//side x side quads covering the screen as a triangle soup, color derived from position so shared corners are identical
+static std::vector<float> buildGridSoup(int side)
+{
+    std::vector<float> vertices;
+    vertices.reserve((std::size_t)side * side * 6 * 6);
+    auto corner = [&](int x, int y) {
+        float u = (float)x / side, v = (float)y / side;
+        vertices.insert(vertices.end(), { u * 1.8f - 0.9f, v * 1.8f - 0.9f, 0.0f, u, v, 1.0f - u });
+    };
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            corner(x, y); corner(x + 1, y); corner(x + 1, y + 1);
+            corner(x, y); corner(x + 1, y + 1); corner(x, y + 1);
+        }
+    }
+    return vertices;
+}
+
+//a dense grid drawn as raw triangles, the baseline for grid_indexed
+class GridSoupScene : public BenchScene {
+    public:
+        explicit GridSoupScene(int side) : side_(side) { count = side * side; }
+        const char* Name() const override { return "grid_soup"; }
+
+        void Setup() override {
+            std::vector<float> vertices = buildGridSoup(side_);
+            vertexCount_ = (GLsizei)(vertices.size() / 6);
+            program_ = compileBenchProgram(0);
+            VAO_ = uploadVertices(vertices, VBO_);
+        }
+
+        void Draw() override {
+            glUseProgram(program_);
+            glUniform2f(glGetUniformLocation(program_, "uOffset"), 0.0f, 0.0f);
+            glBindVertexArray(VAO_);
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays(1, &VAO_);
+            glDeleteBuffers(1, &VBO_);
+            glDeleteProgram(program_);
+        }
+
+    private:
+        int side_;
+        GLsizei vertexCount_ = 0;
+        GLuint program_ = 0, VAO_ = 0, VBO_ = 0;
+};
+
+//the same grid through Mesh: deduplicated vertices, 16/32 bit indices, glDrawElements
+//packed = half3 positions + unorm8 colors (12 bytes per vertex instead of 24)
+//quantized = VertexLayout::Quantized, unorm16 positions undone by a uniform dequantization matrix
+//cached = the quantized mesh written to the binary cache and loaded back from it, reports build vs load time
+class GridIndexedScene : public BenchScene {
+    public:
+        enum Mode { Float, Packed, Quantized, Cached };
+
+        GridIndexedScene(int side, Mode mode) : side_(side), mode_(mode) { count = side * side; }
+        const char* Name() const override {
+            static const char* names[] = { "grid_indexed", "grid_packed", "grid_quantized", "grid_cached" };
+            return names[mode_];
+        }
+
+        void Setup() override {
+            std::vector<float> vertices = buildGridSoup(side_);
+            VertexLayout layout = VertexLayout::PositionColor();
+            if (mode_ == Packed) {
+                layout = VertexLayout::PositionColorPacked();
+            } else if (mode_ != Float) {
+                layout = VertexLayout::Quantized(layout);
+            }
+            auto start = std::chrono::steady_clock::now();
+            mesh_ = std::make_unique<Mesh>(vertices, vertices.size() * sizeof(float), true, true, layout);
+            glFinish();
+            buildMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (mode_ == Cached) {
+                //load time covers open + map + validate + upload, the file is in the page cache after the write,
+                //like any asset that was loaded before
+                const std::string path = "menace_bench_grid.mmsh";
+                if (!MeshFile::Write(path, *mesh_)) {
+                    return;
+                }
+                start = std::chrono::steady_clock::now();
+                MeshFile file;
+                if (file.Open(path)) {
+                    mesh_ = std::make_unique<Mesh>(file);
+                    glFinish();
+                    loadMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    fileBytes_ = file.FileBytes();
+                }
+                file.Close();
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+
+            if (mode_ != Float && mode_ != Packed) {
+                program_ = compileBenchProgram(0, benchUniformModelVertexSource);
+                float dequantization[16];
+                mesh_->Dequantization().Matrix(dequantization);
+                glUseProgram(program_);
+                glUniformMatrix4fv(glGetUniformLocation(program_, "uModel"), 1, GL_FALSE, dequantization);
+            } else {
+                program_ = compileBenchProgram(0);
+            }
+        }
+
+        void Draw() override {
+            glUseProgram(program_);
+            if (mode_ == Float || mode_ == Packed) {
+                glUniform2f(glGetUniformLocation(program_, "uOffset"), 0.0f, 0.0f);
+            }
+            mesh_->Draw();
+        }
+
+        void Teardown() override {
+            mesh_.reset();
+            glDeleteProgram(program_);
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            stats.push_back({ "vertices", (double)mesh_->VertexCount() });
+            stats.push_back({ "index_bits", mesh_->IndexType() == GL_UNSIGNED_SHORT ? 16.0 : 32.0 });
+            stats.push_back({ "acmr_before", mesh_->CacheStatsBefore().acmr });
+            stats.push_back({ "acmr_after", mesh_->CacheStatsAfter().acmr });
+            stats.push_back({ "atvr_before", mesh_->CacheStatsBefore().atvr });
+            stats.push_back({ "atvr_after", mesh_->CacheStatsAfter().atvr });
+            stats.push_back({ "host_bytes", (double)mesh_->HostBytes() });
+            stats.push_back({ "device_bytes", (double)mesh_->DeviceBytes() });
+            stats.push_back({ "vertex_stride", (double)mesh_->Layout().VertexBytes() });
+            stats.push_back({ "position_error", mesh_->QuantizationErrors().position });
+            stats.push_back({ "color_error", mesh_->QuantizationErrors().color });
+            stats.push_back({ "build_ms", buildMs_ });
+            if (mode_ == Cached) {
+                stats.push_back({ "file_bytes", (double)fileBytes_ });
+                stats.push_back({ "load_ms", loadMs_ });
+                stats.push_back({ "load_mb_per_s", loadMs_ > 0.0 ? fileBytes_ / (loadMs_ * 1000.0) : 0.0 });
+            }
+        }
+
+    private:
+        int side_;
+        Mode mode_;
+        double buildMs_ = 0.0, loadMs_ = 0.0;
+        std::size_t fileBytes_ = 0;
+        GLuint program_ = 0;
+        std::unique_ptr<Mesh> mesh_;
+};
+
+//N objects with random program/geometry/texture/depth submitted in random order through the Renderer,
+//sorted = the real path, unsorted = same queue issued in submission order (redundant binds are still skipped)
+class RendererQueueScene : public BenchScene {
+    public:
+        RendererQueueScene(int objects, bool sorted) : sorted_(sorted) { count = objects; }
+        const char* Name() const override { return sorted_ ? "queue_sorted" : "queue_unsorted"; }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            for (int i = 0; i < kPrograms; ++i) {
+                programs_.push_back(compileBenchProgram(i));
+            }
+            for (int i = 0; i < kMeshes; ++i) {
+                std::vector<float> vertices;
+                for (int t = 0; t < 4; ++t) {
+                    appendTriangle(vertices, rng, 0.01f);
+                }
+                meshes_.push_back(std::make_unique<Mesh>(vertices, vertices.size() * sizeof(float)));
+            }
+            textures_.resize(kTextures);
+            glGenTextures(kTextures, textures_.data());
+            for (int i = 0; i < kTextures; ++i) {
+                unsigned char texel[4] = { (unsigned char)(i * 32), 128, 255, 255 };
+                glBindTexture(GL_TEXTURE_2D, textures_[i]);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+            }
+
+            std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+            objects_.resize(count);
+            for (Object& object : objects_) {
+                object.program = rng() % kPrograms;
+                object.mesh = rng() % kMeshes;
+                object.texture = rng() % kTextures;
+                object.depth = depth(rng);
+            }
+            renderer_.SetSorting(sorted_);
+        }
+
+        void Draw() override {
+            renderer_.BeginFrame();
+            for (const Object& object : objects_) {
+                renderer_.Submit(*meshes_[object.mesh], programs_[object.program], textures_[object.texture], object.depth);
+            }
+            renderer_.Flush();
+        }
+
+        void Teardown() override {
+            meshes_.clear();
+            for (GLuint program : programs_) {
+                glDeleteProgram(program);
+            }
+            programs_.clear();
+            glDeleteTextures((GLsizei)textures_.size(), textures_.data());
+            textures_.clear();
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            const Renderer::Stats& frame = renderer_.GetStats();
+            stats.push_back({ "draw_calls", (double)frame.drawCalls });
+            stats.push_back({ "program_binds", (double)frame.programBinds });
+            stats.push_back({ "vao_binds", (double)frame.vaoBinds });
+            stats.push_back({ "texture_binds", (double)frame.textureBinds });
+        }
+
+    private:
+        static const int kPrograms = 16, kMeshes = 64, kTextures = 8;
+        struct Object {
+            int program, mesh, texture;
+            float depth;
+        };
+        bool sorted_;
+        Renderer renderer_;
+        std::vector<GLuint> programs_, textures_;
+        std::vector<std::unique_ptr<Mesh>> meshes_;
+        std::vector<Object> objects_;
+};
+
+//N copies of one mesh as Object3Ds on a grid, instanced = one glDrawElementsInstanced through the Renderer,
+//individual = the same objects as one glUniformMatrix4fv + glDrawElements each,
+//culled = instanced, but the grid is twice as wide and tall as the view, FrustumCuller drops the 3/4 outside,
+//gpu_culled = the same grid culled by GpuCuller's compute shader and drawn with glMultiDrawElementsIndirect
+class ObjectsScene : public BenchScene {
+    public:
+        enum Mode { Individual, Instanced, Culled, GpuCulled, Occluded, CpuOccluded };
+
+        ObjectsScene(int objects, Mode mode) : mode_(mode) { count = objects; }
+        const char* Name() const override {
+            const char* names[] = { "objects_individual", "objects_instanced", "objects_culled", "objects_gpu_culled", "objects_occluded", "objects_cpu_occluded" };
+            return names[mode_];
+        }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            std::vector<float> vertices;
+            for (int t = 0; t < 4; ++t) {
+                appendTriangle(vertices, rng, 0.05f);
+            }
+            mesh_ = std::make_unique<Mesh>(vertices, vertices.size() * sizeof(float));
+            program_ = compileBenchProgram(0, mode_ == Individual ? benchUniformModelVertexSource : benchInstancedVertexSource);
+            modelLocation_ = glGetUniformLocation(program_, "uModel");
+
+            int side = (int)std::ceil(std::sqrt((double)count));
+            float extent = mode_ == Individual || mode_ == Instanced ? 1.0f : 2.0f;
+            float scale = extent / side;
+            bool walled = mode_ == Occluded || mode_ == CpuOccluded;
+            objects_.reserve(count + 1);
+            for (int i = 0; i < count; ++i) {
+                Object3D object(mesh_.get(), program_);
+                //occluded: a thin layer at depth 0.75, behind the wall
+                object.SetScale(scale, scale, walled ? 0.1f : 1.0f);
+                object.SetPosition(-extent + (2 * (i % side) + 1) * scale, -extent + (2 * (i / side) + 1) * scale, walled ? 0.5f : 0.0f);
+                objects_.push_back(object);
+            }
+            if (walled) {
+                //one quad in front of the grid covering the middle 80% of the screen
+                std::vector<float> quad;
+                const float corners[6][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, -1 }, { 1, 1 }, { -1, 1 } };
+                for (const auto& corner : corners) {
+                    quad.insert(quad.end(), { corner[0], corner[1], 0.0f, 0.3f, 0.3f, 0.3f });
+                }
+                occluder_ = std::make_unique<Mesh>(quad, quad.size() * sizeof(float));
+                Object3D wall(occluder_.get(), program_);
+                wall.SetScale(0.8f, 0.8f, 1.0f);
+                wall.SetPosition(0.0f, 0.0f, -0.5f);
+                objects_.push_back(wall);
+            }
+            if (mode_ == Culled || mode_ == CpuOccluded) {
+                culler_.Create();
+            }
+            if (mode_ == CpuOccluded) {
+                rasterizer_.Create();
+            }
+            GpuCuller::Options gpuOptions;
+            gpuOptions.occlusion = mode_ == Occluded;
+            if ((mode_ == GpuCulled || mode_ == Occluded) && gpuCuller_.Create(gpuOptions)) {
+                gpuCuller_.SetObjects(objects_);
+            }
+        }
+
+        void Draw() override {
+            if (mode_ == GpuCulled) {
+                gpuCuller_.Cull(Frustum::FromMatrix(Mat4()));
+                gpuCuller_.Draw();
+                return;
+            }
+            if (mode_ == Occluded) {
+                //the scene doesn't know the bench's framebuffer, GL does
+                GLint target = 0, viewport[4] = {};
+                glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                gpuCuller_.Cull(Mat4());
+                gpuCuller_.Draw();
+                if (gpuCuller_.CullOccluded((GLuint)target, viewport[2], viewport[3])) {
+                    gpuCuller_.Draw();
+                }
+                return;
+            }
+            if (mode_ == CpuOccluded) {
+                //the wall (the last object) is the only occluder, everything else is tested against it
+                rasterizer_.BeginFrame(Mat4());
+                rasterizer_.AddOccluder(objects_.back());
+                rasterizer_.Rasterize();
+                renderer_.BeginFrame();
+                for (uint32_t index : rasterizer_.Cull(objects_, culler_.Cull(Frustum::FromMatrix(Mat4()), objects_))) {
+                    renderer_.Submit(objects_[index]);
+                }
+                renderer_.Flush();
+                return;
+            }
+            if (mode_ == Culled) {
+                //the bench programs draw straight in clip space, so the frustum is that of the identity matrix
+                renderer_.BeginFrame();
+                for (uint32_t index : culler_.Cull(Frustum::FromMatrix(Mat4()), objects_)) {
+                    renderer_.Submit(objects_[index]);
+                }
+                renderer_.Flush();
+                return;
+            }
+            if (mode_ == Instanced) {
+                renderer_.BeginFrame();
+                for (const Object3D& object : objects_) {
+                    renderer_.Submit(object);
+                }
+                renderer_.Flush();
+                return;
+            }
+            glUseProgram(program_);
+            glBindVertexArray(mesh_->VertexArray());
+            for (const Object3D& object : objects_) {
+                glUniformMatrix4fv(modelLocation_, 1, GL_FALSE, object.Transform());
+                glDrawElements(GL_TRIANGLES, mesh_->IndexCount(), mesh_->IndexType(), 0);
+            }
+        }
+
+        void Teardown() override {
+            culler_.Destroy();
+            rasterizer_.Destroy();
+            gpuCuller_.Destroy();
+            renderer_.Clear();
+            objects_.clear();
+            mesh_.reset();
+            occluder_.reset();
+            glDeleteProgram(program_);
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            if (mode_ == GpuCulled) {
+                const GpuCuller::Stats& gpu = gpuCuller_.GetStats();
+                stats.push_back({ "draw_calls", (double)gpu.drawCalls });
+                stats.push_back({ "tested", (double)gpu.objects });
+                stats.push_back({ "visible", (double)gpuCuller_.CountVisible() });
+                stats.push_back({ "upload_ms", gpu.uploadMs });
+                return;
+            }
+            if (mode_ == Occluded) {
+                GpuCuller::OcclusionStats occlusion = gpuCuller_.ReadOcclusionStats();
+                stats.push_back({ "draw_calls", (double)gpuCuller_.GetStats().drawCalls });
+                stats.push_back({ "tested", (double)occlusion.tested });
+                stats.push_back({ "frustum_culled", (double)occlusion.frustumCulled });
+                stats.push_back({ "occluded", (double)occlusion.occluded });
+                stats.push_back({ "first_phase", (double)occlusion.firstPhase });
+                stats.push_back({ "second_phase", (double)occlusion.secondPhase });
+                stats.push_back({ "occluded_triangles", (double)occlusion.occludedTriangles });
+                stats.push_back({ "pyramid_levels", (double)gpuCuller_.GetStats().pyramidLevels });
+                return;
+            }
+            const Renderer::Stats& frame = renderer_.GetStats();
+            stats.push_back({ "draw_calls", mode_ != Individual ? (double)frame.drawCalls : (double)count });
+            stats.push_back({ "instances", mode_ != Individual ? (double)frame.instances : 0.0 });
+            if (mode_ == Culled || mode_ == CpuOccluded) {
+                const FrustumCuller::Stats& cull = culler_.GetStats();
+                stats.push_back({ "tested", (double)cull.tested });
+                stats.push_back({ "visible", (double)cull.visible });
+                stats.push_back({ "cull_ms", cull.cullMs });
+                stats.push_back({ "cull_threads", (double)cull.threads });
+            }
+            if (mode_ == CpuOccluded) {
+                const OcclusionRasterizer::Stats& raster = rasterizer_.GetStats();
+                stats.push_back({ "occluded", (double)raster.occluded });
+                stats.push_back({ "occluder_triangles", (double)raster.triangles });
+                stats.push_back({ "raster_ms", raster.transformMs + raster.setupMs + raster.rasterMs });
+                stats.push_back({ "occlusion_test_ms", raster.testMs });
+            }
+        }
+
+    private:
+        Mode mode_;
+        GLuint program_ = 0;
+        GLint modelLocation_ = -1;
+        Renderer renderer_;
+        FrustumCuller culler_;
+        OcclusionRasterizer rasterizer_;
+        GpuCuller gpuCuller_;
+        std::unique_ptr<Mesh> mesh_, occluder_;
+        std::vector<Object3D> objects_;
+};
+
+//a uv sphere of radius 0.5 without seams, pos + color: the poles are single vertices and the last column wraps to the
+//first; counter clockwise seen from outside, (rings - 1) * segments * 2 triangles
+static void appendSphere(std::vector<float>& vertices, std::vector<unsigned int>& indices, int rings, int segments)
+{
+    unsigned int base = (unsigned int)(vertices.size() / 6);
+    for (int r = 0; r <= rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            if ((r == 0 || r == rings) && s > 0) {
+                continue;
+            }
+            float theta = 3.14159265f * r / rings, phi = 6.28318531f * s / segments;
+            float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            vertices.insert(vertices.end(), { 0.5f * x, 0.5f * y, 0.5f * z, x * 0.5f + 0.5f, y * 0.5f + 0.5f, z * 0.5f + 0.5f });
+        }
+    }
+    auto vertex = [&](int r, int s) -> unsigned int {
+        return base + (r == 0 ? 0 : r == rings ? 1 + (rings - 1) * segments : 1 + (r - 1) * segments + s % segments);
+    };
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            if (r != 0) {
+                indices.insert(indices.end(), { vertex(r, s), vertex(r, s + 1), vertex(r + 1, s) });
+            }
+            if (r != rings - 1) {
+                indices.insert(indices.end(), { vertex(r, s + 1), vertex(r + 1, s + 1), vertex(r + 1, s) });
+            }
+        }
+    }
+}
+
+static const char* benchViewProjectionVertexSource = "#version 330 core\n"
+                                                     "layout (location = 0) in vec3 aPos;\n"
+                                                     "layout (location = 1) in vec3 aColor;\n"
+                                                     "layout (location = 3) in mat4 aModel;\n"
+                                                     "uniform mat4 uViewProjection;\n"
+                                                     "out vec3 vColor;\n"
+                                                     "void main()\n"
+                                                     "{\n"
+                                                     "   vColor = aColor;\n"
+                                                     "   gl_Position = uViewProjection * aModel * vec4(aPos, 1.0);\n"
+                                                     "}\n";
+
+//N copies of a dense sphere (20k triangles) on a field stretching away from a perspective camera, drawn through the
+//Renderer, full = always LOD 0, selected = the Renderer picks a level of the mesh's LOD chain per object (1 pixel budget)
+class LodScene : public BenchScene {
+    public:
+        enum Mode { Full, Selected };
+
+        LodScene(int objects, Mode mode) : mode_(mode) { count = objects; }
+        const char* Name() const override { return mode_ == Full ? "lod_full" : "lod_selected"; }
+
+        void Setup() override {
+            std::vector<float> vertices;
+            std::vector<unsigned int> indices;
+            appendSphere(vertices, indices, 100, 100);
+            mesh_ = std::make_unique<Mesh>(std::move(vertices), std::move(indices));
+            auto start = std::chrono::steady_clock::now();
+            Mesh::LodOptions options;
+            options.maxLods = 6;
+            options.simplify.attributeWeights = { 0.1f, 0.1f, 0.1f };
+            mesh_->GenerateLods(options);
+            generateMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            program_ = compileBenchProgram(0, benchViewProjectionVertexSource);
+            viewProjectionLocation_ = glGetUniformLocation(program_, "uViewProjection");
+
+            //rows from 2 to 200 units away, as wide as the view at their distance
+            int rows = std::max(1, (int)std::sqrt((double)count / 4));
+            int columns = (count + rows - 1) / rows;
+            objects_.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                float distance = 2.0f + 198.0f * (i / columns) / rows;
+                float x = ((i % columns) + 0.5f) / columns * 2.0f - 1.0f;
+                Object3D object(mesh_.get(), program_);
+                object.SetPosition(x * distance * kTanHalfFov * 1.5f, -1.0f, -distance);
+                objects_.push_back(object);
+            }
+        }
+
+        void Draw() override {
+            GLint viewport[4] = {};
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            float aspect = viewport[3] > 0 ? (float)viewport[2] / viewport[3] : 1.0f;
+            Mat4 viewProjection = Mat4::Perspective(2.0f * std::atan(kTanHalfFov), aspect, 0.1f, 500.0f);
+            GLState::Get().UseProgram(program_);
+            glUniformMatrix4fv(viewProjectionLocation_, 1, GL_FALSE, viewProjection.Data());
+
+            renderer_.BeginFrame();
+            if (mode_ == Selected) {
+                const float camera[3] = { 0.0f, 0.0f, 0.0f };
+                renderer_.SetLodSelection(camera, viewport[3] / (2.0f * kTanHalfFov), 1.0f);
+            }
+            for (const Object3D& object : objects_) {
+                renderer_.Submit(object);
+            }
+            renderer_.Flush();
+        }
+
+        void Teardown() override {
+            renderer_.Clear();
+            objects_.clear();
+            mesh_.reset();
+            glDeleteProgram(program_);
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            const Renderer::Stats& frame = renderer_.GetStats();
+            const std::vector<MeshLod>& lods = mesh_->Lods();
+            stats.push_back({ "draw_calls", (double)frame.drawCalls });
+            stats.push_back({ "instances", (double)frame.instances });
+            stats.push_back({ "triangles", (double)frame.triangles });
+            stats.push_back({ "reduced_instances", (double)frame.reducedInstances });
+            stats.push_back({ "lods", (double)lods.size() });
+            stats.push_back({ "coarsest_lod_triangles", (double)(lods.back().indexCount / 3) });
+            stats.push_back({ "coarsest_lod_error", (double)lods.back().error });
+            stats.push_back({ "lod_generate_ms", generateMs_ });
+        }
+
+    private:
+        static constexpr float kTanHalfFov = 0.5f;
+
+        Mode mode_;
+        GLuint program_ = 0;
+        GLint viewProjectionLocation_ = -1;
+        double generateMs_ = 0.0;
+        Renderer renderer_;
+        std::unique_ptr<Mesh> mesh_;
+        std::vector<Object3D> objects_;
+};
+
+//N dense spheres (20k triangles) in a ring around a perspective camera, the mesh cut into meshlets and loaded back
+//from the binary cache; whole = every sphere drawn in full, multidraw / indirect = MeshletCuller drops off screen and
+//back facing meshlets and draws the rest with glMultiDrawElements / glMultiDrawElementsIndirect (skipped without 4.3)
+class MeshletScene : public BenchScene {
+    public:
+        enum Mode { Whole, MultiDraw, Indirect };
+
+        MeshletScene(int objects, Mode mode) : mode_(mode) { count = objects; }
+        const char* Name() const override {
+            const char* names[] = { "meshlets_whole", "meshlets_multidraw", "meshlets_indirect" };
+            return names[mode_];
+        }
+
+        void Setup() override {
+            std::vector<float> vertices;
+            std::vector<unsigned int> indices;
+            appendSphere(vertices, indices, 100, 100);
+            Mesh built(std::move(vertices), std::move(indices));
+            auto start = std::chrono::steady_clock::now();
+            built.BuildMeshlets();
+            buildMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            //the meshlets have to survive the cache, the drawn mesh is the one loaded back
+            const std::string path = "menace_bench_meshlets.mmsh";
+            MeshFile file;
+            if (MeshFile::Write(path, built) && file.Open(path)) {
+                mesh_ = std::make_unique<Mesh>(file);
+            }
+            file.Close();
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            if (!mesh_) {
+                return;
+            }
+
+            program_ = compileBenchProgram(0, benchViewProjectionVertexSource);
+            viewProjectionLocation_ = glGetUniformLocation(program_, "uViewProjection");
+
+            //rings of spheres all around the camera, about a quarter of them in the view
+            objects_.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                float angle = 6.28318531f * (i % 32) / 32.0f;
+                float distance = 3.0f + 2.0f * (i / 32);
+                Object3D object(mesh_.get(), program_);
+                object.SetPosition(std::sin(angle) * distance, 0.0f, -std::cos(angle) * distance);
+                objects_.push_back(object);
+            }
+
+            MeshletCuller::Options options;
+            options.indirect = mode_ == Indirect;
+            culler_.Create(options);
+        }
+
+        void Draw() override {
+            if (!mesh_) {
+                return;
+            }
+            GLint viewport[4] = {};
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            float aspect = viewport[3] > 0 ? (float)viewport[2] / viewport[3] : 1.0f;
+            Mat4 viewProjection = Mat4::Perspective(1.2f, aspect, 0.1f, 200.0f);
+            GLState::Get().UseProgram(program_);
+            glUniformMatrix4fv(viewProjectionLocation_, 1, GL_FALSE, viewProjection.Data());
+
+            if (mode_ == Whole) {
+                renderer_.BeginFrame();
+                for (const Object3D& object : objects_) {
+                    renderer_.Submit(object);
+                }
+                renderer_.Flush();
+                return;
+            }
+            culler_.BeginFrame(Frustum::FromMatrix(viewProjection), Vec3(0.0f, 0.0f, 0.0f));
+            for (const Object3D& object : objects_) {
+                culler_.Submit(object);
+            }
+            culler_.Draw();
+        }
+
+        void Teardown() override {
+            culler_.Destroy();
+            renderer_.Clear();
+            objects_.clear();
+            mesh_.reset();
+            glDeleteProgram(program_);
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            stats.push_back({ "meshlets_per_mesh", mesh_ ? (double)mesh_->Meshlets().size() : 0.0 });
+            stats.push_back({ "meshlet_build_ms", buildMs_ });
+            if (mode_ == Whole) {
+                stats.push_back({ "draw_calls", (double)renderer_.GetStats().drawCalls });
+                stats.push_back({ "triangles", (double)renderer_.GetStats().triangles });
+                return;
+            }
+            const MeshletCuller::Stats& cull = culler_.GetStats();
+            stats.push_back({ "draw_calls", (double)cull.drawCalls });
+            stats.push_back({ "triangles", (double)cull.triangles });
+            stats.push_back({ "tested", (double)cull.meshlets });
+            stats.push_back({ "frustum_culled", (double)cull.frustumCulled });
+            stats.push_back({ "backfacing", (double)cull.backfacing });
+            stats.push_back({ "ranges", (double)cull.ranges });
+            stats.push_back({ "indirect", cull.indirect ? 1.0 : 0.0 });
+            stats.push_back({ "cull_ms", cull.cullMs });
+        }
+
+    private:
+        Mode mode_;
+        GLuint program_ = 0;
+        GLint viewProjectionLocation_ = -1;
+        double buildMs_ = 0.0;
+        Renderer renderer_;
+        MeshletCuller culler_;
+        std::unique_ptr<Mesh> mesh_;
+        std::vector<Object3D> objects_;
+};
+
+//N triangles rewritten by the CPU every frame, subdata = glBufferSubData into one GL_DYNAMIC_DRAW buffer
+//(implicit sync with the previous frame's draw), orphan / persistent = written straight into a RingBuffer
+class DynamicGeometryScene : public BenchScene {
+    public:
+        enum Mode { SubData, Orphan, Persistent };
+
+        DynamicGeometryScene(int triangles, Mode mode) : mode_(mode) { count = triangles; }
+        const char* Name() const override {
+            return mode_ == SubData ? "dynamic_subdata" : (mode_ == Orphan ? "dynamic_orphan" : "dynamic_persistent");
+        }
+
+        void Setup() override {
+            std::mt19937 rng(1234);
+            base_.reserve((std::size_t)count * 18);
+            for (int i = 0; i < count; ++i) {
+                appendTriangle(base_, rng, 0.01f);
+            }
+            scratch_.resize(base_.size());
+            program_ = compileBenchProgram(0);
+            offsetLocation_ = glGetUniformLocation(program_, "uOffset");
+
+            std::size_t bytes = base_.size() * sizeof(float);
+            if (mode_ == SubData) {
+                glGenBuffers(1, &VBO_);
+                glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+                glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+            } else {
+                //one stride of slack for the alignment of the allocation
+                ring_.Create(bytes + kStride, 3, mode_ == Persistent);
+                VBO_ = ring_.Buffer();
+            }
+            glGenVertexArrays(1, &VAO_);
+            glBindVertexArray(VAO_);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, kStride, (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, kStride, (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            frame_ = 0;
+        }
+
+        void Draw() override {
+            std::size_t bytes = base_.size() * sizeof(float);
+            float* target = scratch_.data();
+            GLint first = 0;
+            RingBuffer::Allocation allocation;
+            if (mode_ != SubData) {
+                ring_.BeginFrame();
+                //aligned to the stride, so the offset is a whole number of vertices and the VAO never changes
+                allocation = ring_.Allocate(bytes, kStride);
+                if (!allocation.data) {
+                    return;
+                }
+                target = (float*)allocation.data;
+                first = (GLint)(allocation.offset / kStride);
+            }
+
+            //wobble every vertex so the data really changes each frame
+            float wobble = 0.01f * (float)(frame_++ % 16);
+            for (std::size_t i = 0; i < base_.size(); i += 6) {
+                target[i + 0] = base_[i + 0] + wobble;
+                target[i + 1] = base_[i + 1];
+                target[i + 2] = base_[i + 2];
+                target[i + 3] = base_[i + 3];
+                target[i + 4] = base_[i + 4];
+                target[i + 5] = base_[i + 5];
+            }
+
+            if (mode_ == SubData) {
+                glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, scratch_.data());
+            } else {
+                ring_.Flush();
+            }
+
+            glUseProgram(program_);
+            glUniform2f(offsetLocation_, 0.0f, 0.0f);
+            glBindVertexArray(VAO_);
+            glDrawArrays(GL_TRIANGLES, first, count * 3);
+
+            if (mode_ != SubData) {
+                ring_.EndFrame();
+            }
+        }
+
+        void Teardown() override {
+            glDeleteVertexArrays(1, &VAO_);
+            if (mode_ == SubData) {
+                glDeleteBuffers(1, &VBO_);
+            }
+            ring_.Destroy();
+            glDeleteProgram(program_);
+            base_.clear();
+            scratch_.clear();
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            stats.push_back({ "persistent", ring_.Persistent() ? 1.0 : 0.0 });
+            stats.push_back({ "fence_waits", (double)ring_.GetStats().fenceWaits });
+            stats.push_back({ "fence_wait_ms", ring_.GetStats().waitMs });
+        }
+
+    private:
+        static const GLsizei kStride = 6 * sizeof(float);
+        Mode mode_;
+        int frame_ = 0;
+        GLuint program_ = 0, VAO_ = 0, VBO_ = 0;
+        GLint offsetLocation_ = -1;
+        RingBuffer ring_;
+        std::vector<float> base_, scratch_;
+};
+
+//a level that keeps streaming in: every cycle the same `files` quantized grids are dropped and loaded again,
+//sync = MeshFile + Mesh on the render thread inside one frame, streamed = AssetStreamer with a per frame upload budget
+class StreamingScene : public BenchScene {
+    public:
+        enum Mode { Sync, Streamed };
+
+        StreamingScene(int side, int files, Mode mode) : side_(side), files_(files), mode_(mode) { count = files; }
+        const char* Name() const override { return mode_ == Sync ? "stream_sync" : "stream_budgeted"; }
+
+        void Setup() override {
+            std::vector<float> vertices = buildGridSoup(side_);
+            Mesh grid(vertices, vertices.size() * sizeof(float), true, false, VertexLayout::Quantized(VertexLayout::PositionColor()));
+            for (int f = 0; f < files_; ++f) {
+                paths_.push_back("menace_bench_stream_" + std::to_string(f) + ".mmsh");
+                MeshFile::Write(paths_.back(), grid);
+            }
+            grid.Dequantization().Matrix(dequantization_);
+            fileBytes_ = std::filesystem::file_size(paths_[0]);
+
+            program_ = compileBenchProgram(0, benchUniformModelVertexSource);
+            if (mode_ == Streamed) {
+                AssetStreamer::Options options;
+                options.bytesPerFrame = kBudget;
+                streamer_.Create(options);
+            }
+            frame_ = 0;
+            readyFrame_ = -kCycleFrames;
+            loading_ = false;
+            loads_ = 0;
+            maxUpdateMs_ = 0.0;
+        }
+
+        void Draw() override {
+            if (mode_ == Sync) {
+                if (frame_ % kCycleFrames == 0) {
+                    auto start = std::chrono::steady_clock::now();
+                    meshes_.clear();
+                    for (const std::string& path : paths_) {
+                        MeshFile file;
+                        if (file.Open(path)) {
+                            meshes_.push_back(std::make_unique<Mesh>(file));
+                            loads_++;
+                        }
+                    }
+                    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    maxUpdateMs_ = std::max(maxUpdateMs_, loadMs);
+                }
+            } else {
+                streamer_.Update();
+                if (loading_ && streamer_.Pending() == 0) {
+                    loading_ = false;
+                    readyFrame_ = frame_;
+                    loads_ += handles_.size();
+                }
+                //a new cycle once everything of the last one is in and has been drawn for a while
+                if (!loading_ && frame_ - readyFrame_ >= kCycleFrames / 2) {
+                    for (AssetStreamer::Handle handle : handles_) {
+                        streamer_.Release(handle);
+                    }
+                    handles_.clear();
+                    for (const std::string& path : paths_) {
+                        handles_.push_back(streamer_.Request(path));
+                    }
+                    loading_ = true;
+                }
+            }
+
+            glUseProgram(program_);
+            glUniformMatrix4fv(glGetUniformLocation(program_, "uModel"), 1, GL_FALSE, dequantization_);
+            if (mode_ == Sync) {
+                for (auto& mesh : meshes_) {
+                    mesh->Draw();
+                }
+            } else {
+                for (AssetStreamer::Handle handle : handles_) {
+                    if (Mesh* mesh = streamer_.GetMesh(handle)) {
+                        mesh->Draw();
+                    }
+                }
+            }
+            frame_++;
+        }
+
+        void Teardown() override {
+            meshes_.clear();
+            handles_.clear();
+            streamer_.Destroy();
+            glDeleteProgram(program_);
+            for (const std::string& path : paths_) {
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+            paths_.clear();
+        }
+
+        void Stats(std::vector<std::pair<std::string, double>>& stats) const override {
+            stats.push_back({ "file_bytes", (double)fileBytes_ });
+            stats.push_back({ "meshes_loaded", (double)loads_ });
+            //the most a single frame spent on loading: the whole level for sync, Update() for streamed
+            if (mode_ == Sync) {
+                stats.push_back({ "max_load_ms", maxUpdateMs_ });
+            } else {
+                const AssetStreamer::Stats& streamStats = streamer_.GetStats();
+                stats.push_back({ "max_load_ms", streamStats.maxUpdateMs });
+                stats.push_back({ "budget_bytes", (double)kBudget });
+                stats.push_back({ "max_frame_bytes", (double)streamStats.maxFrameBytes });
+                stats.push_back({ "decode_ms", streamStats.decodeMs });
+            }
+        }
+
+    private:
+        static const int kCycleFrames = 32;
+        static const std::size_t kBudget = 1 << 20;
+        int side_, files_;
+        Mode mode_;
+        int frame_ = 0, readyFrame_ = 0;
+        bool loading_ = false;
+        std::size_t loads_ = 0, fileBytes_ = 0;
+        double maxUpdateMs_ = 0.0;
+        float dequantization_[16];
+        GLuint program_ = 0;
+        std::vector<std::string> paths_;
+        std::vector<std::unique_ptr<Mesh>> meshes_;
+        AssetStreamer streamer_;
+        std::vector<AssetStreamer::Handle> handles_;
+};
+
+//--------------------------------------------------SHADER STARTUP----------------------------------------------------------------------
+
+struct StartupResult {
+    int programs = 0;
+    double coldMs = 0.0;        //empty binary cache: compile + link everything
+    double warmMs = 0.0;        //second launch: everything comes from the binary cache
+    int warmCacheHits = 0;
+    double asyncSubmitMs = 0.0;     //no cache, RequestProgram for everything: time until the render loop could continue
+    double asyncReadyMs = 0.0;      //wall time until the last program was ready, polling Update() like a frame loop
+    double asyncMainThreadMs = 0.0; //main thread time inside the manager during that (submit + every Update)
+    int asyncPolls = 0;
+};
+
+//loads the same set of programs twice through fresh ShaderManagers, like two consecutive launches would
+static StartupResult measureShaderStartup(int programs)
+{
+    const std::string cacheDirectory = "menace_bench_shader_cache";
+    std::error_code error;
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    StartupResult result;
+    result.programs = programs;
+    for (int launch = 0; launch < 2; ++launch) {
+        ShaderManager shaderManager(cacheDirectory);
+        for (int i = 0; i < programs; ++i) {
+            shaderManager.LoadProgramFromSource("variant" + std::to_string(i), benchVertexSource, benchFragmentSource(i));
+        }
+        glFinish();
+        (launch == 0 ? result.coldMs : result.warmMs) = shaderManager.GetStats().loadMs;
+        if (launch == 1) {
+            result.warmCacheHits = shaderManager.GetStats().cacheHits;
+        }
+    }
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    //third launch without a binary cache, compiled through the asynchronous path
+    ShaderManager shaderManager("");
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < programs; ++i) {
+        shaderManager.RequestProgramFromSource("variant" + std::to_string(i), benchVertexSource, benchFragmentSource(i));
+    }
+    result.asyncSubmitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    while (shaderManager.PendingCount() > 0) {
+        shaderManager.Update();
+        glFlush();
+        result.asyncPolls++;
+    }
+    result.asyncReadyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.asyncMainThreadMs = shaderManager.GetStats().loadMs;
+    return result;
+}
+
+//--------------------------------------------------MESH IMPORT----------------------------------------------------------------------
+
+struct ImportResult {
+    std::size_t triangles = 0;
+    int threads = 0;
+    std::size_t objBytes = 0, plyBytes = 0;
+    double objMs = 0.0, plyMs = 0.0;
+    double objMegabytesPerSecond = 0.0, plyMegabytesPerSecond = 0.0;
+};
+
+//writes a side x side quad grid as OBJ (positions + one normal, v//vn faces, so corners get deduplicated)
+//and as binary PLY, then imports both; the files are in the page cache, so this is parse speed, not disk speed
+static ImportResult measureMeshImport(int side)
+{
+    const std::string objPath = "menace_bench_import.obj";
+    const std::string plyPath = "menace_bench_import.ply";
+    std::size_t vertexCount = (std::size_t)(side + 1) * (side + 1);
+    std::size_t faceCount = (std::size_t)side * side * 2;
+
+    FILE* obj = std::fopen(objPath.c_str(), "w");
+    FILE* ply = std::fopen(plyPath.c_str(), "wb");
+    if (!obj || !ply) {
+        if (obj) std::fclose(obj);
+        if (ply) std::fclose(ply);
+        return ImportResult();
+    }
+    std::fprintf(ply, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\nproperty float x\nproperty float y\nproperty float z\n"
+                      "element face %zu\nproperty list uchar int vertex_indices\nend_header\n", vertexCount, faceCount);
+    std::fprintf(obj, "vn 0 0 1\n");
+    for (int y = 0; y <= side; ++y) {
+        for (int x = 0; x <= side; ++x) {
+            float position[3] = { (float)x / side * 2.0f - 1.0f, (float)y / side * 2.0f - 1.0f, std::sin(x * 0.1f) * std::cos(y * 0.1f) * 0.1f };
+            std::fprintf(obj, "v %.6f %.6f %.6f\n", position[0], position[1], position[2]);
+            std::fwrite(position, sizeof(position), 1, ply);
+        }
+    }
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            int corner = y * (side + 1) + x + 1;
+            int quad[4] = { corner, corner + 1, corner + side + 2, corner + side + 1 };
+            std::fprintf(obj, "f %d//1 %d//1 %d//1\nf %d//1 %d//1 %d//1\n", quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]);
+            unsigned char count = 3;
+            int triangles[2][3] = { { quad[0] - 1, quad[1] - 1, quad[2] - 1 }, { quad[0] - 1, quad[2] - 1, quad[3] - 1 } };
+            for (const int* triangle : triangles) {
+                std::fwrite(&count, 1, 1, ply);
+                std::fwrite(triangle, sizeof(int), 3, ply);
+            }
+        }
+    }
+    std::fclose(obj);
+    std::fclose(ply);
+
+    ImportResult result;
+    MeshImporter::Result mesh;
+    if (MeshImporter::Load(objPath, mesh)) {
+        result.triangles = mesh.stats.triangles;
+        result.threads = mesh.stats.threads;
+        result.objBytes = mesh.stats.fileBytes;
+        result.objMs = mesh.stats.totalMs;
+        result.objMegabytesPerSecond = mesh.stats.MegabytesPerSecond();
+    }
+    if (MeshImporter::Load(plyPath, mesh)) {
+        result.plyBytes = mesh.stats.fileBytes;
+        result.plyMs = mesh.stats.totalMs;
+        result.plyMegabytesPerSecond = mesh.stats.MegabytesPerSecond();
+    }
+    std::error_code error;
+    std::filesystem::remove(objPath, error);
+    std::filesystem::remove(plyPath, error);
+    return result;
+}
+
+//a binary PLY of triangles with one quad early on, parsed on several threads: the quad shifts every later record,
+//so the fixed size triangle path has to give up and the record by record path has to read it; true if it did
+static bool checkMixedPolygonImport()
+{
+    const std::size_t vertexCount = 1 << 16, faceCount = 400000, quadFace = 1000;
+    char header[256];
+    int headerLength = std::snprintf(header, sizeof(header), "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n"
+                                     "property float x\nproperty float y\nproperty float z\nelement face %zu\n"
+                                     "property list uchar int vertex_indices\nend_header\n", vertexCount, faceCount);
+    std::vector<char> data(header, header + headerLength);
+    auto append = [&](const void* value, std::size_t size) { data.insert(data.end(), (const char*)value, (const char*)value + size); };
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        float position[3] = { (float)v, 0.0f, 0.0f };
+        append(position, sizeof(position));
+    }
+    for (std::size_t f = 0; f < faceCount; ++f) {
+        //the last index's low byte is 3, so a triangle record read 4 bytes late looks like a triangle with garbage indices
+        int polygon[4] = { (int)(f % vertexCount), (int)((f + 1) % vertexCount), (int)(3 + 256 * (f % 256)), (int)((f + 2) % vertexCount) };
+        unsigned char count = f == quadFace ? 4 : 3;
+        append(&count, 1);
+        append(polygon, count * sizeof(int));
+    }
+
+    for (int threads : { 1, 2, 8 }) {
+        MeshImporter::Options options;
+        options.threads = threads;
+        options.minChunkBytes = 1;
+        MeshImporter::Result mesh;
+        if (!MeshImporter::ParsePLY(data.data(), data.size(), mesh, options, "mixed.ply") || mesh.stats.triangles != faceCount + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------MATH----------------------------------------------------------------------
+
+struct MathResult {
+    const char* backend = "";
+    std::size_t points = 0, matrices = 0;
+    double pointsScalarMs = 0.0, pointsSimdMs = 0.0;
+    double matricesScalarMs = 0.0, matricesSimdMs = 0.0;
+    float pointsMaxError = 0.0f, matricesMaxError = 0.0f;   //largest difference of the simd results to the scalar ones
+};
+
+//above this the simd paths compute something else than the scalar loops, not just round differently
+static const float kMathTolerance = 1e-4f;
+
+static float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float worst = 0.0f;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        worst = std::max(worst, std::fabs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+//best of a few runs, the batches are small enough that one run is noise
+template <typename F>
+static double bestOfMs(int runs, F&& run)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+//SimdMath batch functions against their SimdMath::Scalar loops on the same SoA data, timed and compared
+static MathResult measureMath(std::size_t points, std::size_t matrices)
+{
+    const int kRuns = 5;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    MathResult result;
+    result.backend = SimdMath::Backend();
+    result.points = points;
+    result.matrices = matrices;
+
+    std::vector<float> in(points * 3), out(points * 3), reference(points * 3);
+    for (float& f : in) f = value(rng);
+    Mat4 transform = Mat4::TRS(Vec3(1.0f, 2.0f, 3.0f), Quat::AxisAngle(Vec3(1.0f, 1.0f, 0.0f), 0.7f), Vec3(2.0f, 2.0f, 2.0f));
+    const float* x = in.data();
+    const float* y = x + points;
+    const float* z = y + points;
+    float* outX = out.data();
+    float* outY = outX + points;
+    float* outZ = outY + points;
+    result.pointsScalarMs = bestOfMs(kRuns, [&]() { SimdMath::Scalar::TransformPoints(transform, x, y, z, points, outX, outY, outZ); });
+    reference = out;
+    result.pointsSimdMs = bestOfMs(kRuns, [&]() { SimdMath::TransformPoints(transform, x, y, z, points, outX, outY, outZ); });
+    result.pointsMaxError = maxDifference(out, reference);
+
+    std::vector<float> left(matrices * 16), right(matrices * 16), product(matrices * 16), expected(matrices * 16);
+    for (float& f : left) f = value(rng);
+    for (float& f : right) f = value(rng);
+    const float* a[16];
+    const float* b[16];
+    float* c[16];
+    for (int k = 0; k < 16; ++k) {
+        a[k] = left.data() + k * matrices;
+        b[k] = right.data() + k * matrices;
+        c[k] = product.data() + k * matrices;
+    }
+    result.matricesScalarMs = bestOfMs(kRuns, [&]() { SimdMath::Scalar::MultiplyMatrices(a, b, c, matrices); });
+    expected = product;
+    result.matricesSimdMs = bestOfMs(kRuns, [&]() { SimdMath::MultiplyMatrices(a, b, c, matrices); });
+    result.matricesMaxError = maxDifference(product, expected);
+
+    //Mat4 operator* on matrices 16 bytes past a 32 byte boundary, as aligned as Mat4 promises and not more; called
+    //through a pointer so it is not inlined here, where the compiler can fold the loads into alignment free operands
+    Mat4 (*volatile multiply)(const Mat4&, const Mat4&) = operator*;
+    struct alignas(32) Misaligned {
+        float pad[4];
+        Mat4 left, right;
+    } pair;
+    for (std::size_t i = 0; i < std::min<std::size_t>(matrices, 1024); ++i) {
+        pair.left = Mat4(&left[i * 16]);
+        pair.right = Mat4(&right[i * 16]);
+        Mat4 product4 = multiply(pair.left, pair.right);
+        float* columns[16];
+        for (int k = 0; k < 16; ++k) {
+            a[k] = &pair.left.m[k];
+            b[k] = &pair.right.m[k];
+            columns[k] = &expected[k];
+        }
+        SimdMath::Scalar::MultiplyMatrices(a, b, columns, 1);
+        for (int k = 0; k < 16; ++k) {
+            result.matricesMaxError = std::max(result.matricesMaxError, std::fabs(product4.m[k] - expected[k]));
+        }
+    }
+    return result;
+}
+
+//--------------------------------------------------TRANSFORM HIERARCHY----------------------------------------------------------------------
+
+struct HierarchyResult {
+    std::size_t nodes = 0, animated = 0;
+    int threads = 0;
+    double reorderMs = 0.0;         //sorting the freshly added nodes
+    double fullMs = 0.0;            //every world matrix, the root moved
+    double animatedUs = 0.0;        //mean Update() with `animated` nodes moved per frame
+    std::size_t animatedUpdated = 0;    //mean world matrices that recomputed
+};
+
+//a 4-ary tree of `nodes` nodes, then `animated` random nodes moved per frame like a handful of animated props
+static HierarchyResult measureHierarchy(std::size_t nodes, std::size_t animated)
+{
+    const int kFrames = 200;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    TransformHierarchy hierarchy;
+    std::vector<TransformHierarchy::Handle> handles(nodes);
+    for (std::size_t i = 0; i < nodes; ++i) {
+        handles[i] = hierarchy.Add(i ? handles[(i - 1) / 4] : 0);
+        hierarchy.SetLocal(handles[i], Vec3(value(rng), value(rng), value(rng)),
+                           Quat::AxisAngle(Vec3(0.0f, 1.0f, 0.0f), value(rng)), Vec3(1.0f, 1.0f, 1.0f));
+    }
+    hierarchy.Update();
+
+    HierarchyResult result;
+    result.nodes = nodes;
+    result.animated = animated;
+    result.reorderMs = hierarchy.GetStats().reorderMs;
+    hierarchy.SetTranslation(handles[0], Vec3(1.0f, 0.0f, 0.0f));
+    hierarchy.Update();
+    result.fullMs = hierarchy.GetStats().updateMs;
+    result.threads = hierarchy.GetStats().threads;
+
+    double totalMs = 0.0;
+    std::size_t updated = 0;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        for (std::size_t i = 0; i < animated; ++i) {
+            TransformHierarchy::Handle handle = handles[rng() % nodes];
+            hierarchy.SetRotation(handle, Quat::AxisAngle(Vec3(0.0f, 1.0f, 0.0f), value(rng)));
+        }
+        hierarchy.Update();
+        totalMs += hierarchy.GetStats().updateMs;
+        updated += hierarchy.GetStats().updatedNodes;
+    }
+    result.animatedUs = totalMs * 1000.0 / kFrames;
+    result.animatedUpdated = updated / kFrames;
+    return result;
+}
+
+//--------------------------------------------------OCCLUSION RASTER----------------------------------------------------------------------
+
+struct RasterResult {
+    int width = 0, height = 0, threads = 0;
+    std::size_t triangles = 0, rasterized = 0, boxes = 0, occluded = 0;
+    double rasterMs = 0.0;              //best Rasterize(), transform and setup included
+    double trianglesPerSecond = 0.0;    //submitted triangles
+    double testMs = 0.0;
+    double boxesPerSecond = 0.0;
+};
+
+//`cubes` random cubes in front of a perspective camera rasterized into OcclusionRasterizer's default buffer, then
+//`boxes` random boxes tested against it, no GL involved
+static RasterResult measureOcclusionRaster(std::size_t cubes, std::size_t boxes)
+{
+    const int kRuns = 5;
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    OcclusionRasterizer rasterizer;
+    RasterResult result;
+    if (!rasterizer.Create()) {
+        return result;
+    }
+
+    //one unit cube, counter clockwise seen from outside
+    const float corners[8 * 3] = { -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,  0.5f, 0.5f, -0.5f,
+                                   -0.5f, -0.5f, 0.5f,   0.5f, -0.5f, 0.5f,   -0.5f, 0.5f, 0.5f,   0.5f, 0.5f, 0.5f };
+    const unsigned int faces[36] = { 0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+                                     2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5 };
+    std::vector<Mat4> models(cubes);
+    for (Mat4& model : models) {
+        float size = 0.2f + 0.3f * std::fabs(value(rng));
+        model = Mat4::TRS(Vec3(value(rng) * 8.0f, value(rng) * 4.0f, -6.0f - 10.0f * std::fabs(value(rng))),
+                          Quat::AxisAngle(Vec3(value(rng), value(rng), value(rng)), value(rng) * 3.0f), Vec3(size, size, size));
+    }
+    Mat4 viewProjection = Mat4::Perspective(1.0f, 2.0f, 0.1f, 100.0f);
+
+    auto queue = [&]() {
+        rasterizer.BeginFrame(viewProjection);
+        for (const Mat4& model : models) {
+            rasterizer.AddOccluder(corners, 3, 8, faces, 36, model);
+        }
+    };
+    result.rasterMs = 1e30;
+    for (int i = 0; i < kRuns; ++i) {
+        queue();
+        result.rasterMs = std::min(result.rasterMs, bestOfMs(1, [&]() { rasterizer.Rasterize(); }));
+    }
+
+    std::vector<AABB> bounds(boxes);
+    for (AABB& box : bounds) {
+        Vec3 center(value(rng) * 10.0f, value(rng) * 5.0f, -8.0f - 12.0f * std::fabs(value(rng)));
+        Vec3 extent(0.1f + 0.2f * std::fabs(value(rng)), 0.1f + 0.2f * std::fabs(value(rng)), 0.1f + 0.2f * std::fabs(value(rng)));
+        box = AABB(center - extent, center + extent);
+    }
+    std::size_t occluded = 0;
+    result.testMs = bestOfMs(kRuns, [&]() {
+        occluded = 0;
+        for (const AABB& box : bounds) {
+            occluded += rasterizer.IsVisible(box) ? 0 : 1;
+        }
+    });
+
+    const OcclusionRasterizer::Stats& stats = rasterizer.GetStats();
+    result.width = rasterizer.Width();
+    result.height = rasterizer.Height();
+    result.threads = stats.threads;
+    result.triangles = stats.triangles;
+    result.rasterized = stats.rasterized;
+    result.boxes = boxes;
+    result.occluded = occluded;
+    result.trianglesPerSecond = result.rasterMs > 0.0 ? result.triangles / (result.rasterMs / 1000.0) : 0.0;
+    result.boxesPerSecond = result.testMs > 0.0 ? boxes / (result.testMs / 1000.0) : 0.0;
+    return result;
+}
+
+//--------------------------------------------------GPU CULLER UPDATES----------------------------------------------------------------------
+
+//4 objects in view, then objects 1..3 moved off screen one at a time through UpdateObject, culling after each move;
+//the visible counts have to go 3, 2, 1, anything else means a matrix landed in the wrong buffer
+static bool checkGpuCullerUpdates()
+{
+    std::mt19937 rng(5);
+    std::vector<float> vertices;
+    appendTriangle(vertices, rng, 0.05f);
+    Mesh mesh(vertices, vertices.size() * sizeof(float));
+    GLuint program = compileBenchProgram(0, benchInstancedVertexSource);
+    std::vector<Object3D> objects;
+    for (int i = 0; i < 4; ++i) {
+        Object3D object(&mesh, program);
+        object.SetScale(0.2f, 0.2f, 1.0f);
+        object.SetPosition(-0.6f + 0.4f * i, 0.0f, 0.0f);
+        objects.push_back(object);
+    }
+
+    GpuCuller culler;
+    bool ok = culler.Create() && culler.SetObjects(objects);
+    Frustum frustum = Frustum::FromMatrix(Mat4());
+    culler.Cull(frustum);
+    ok = ok && culler.CountVisible() == 4;
+    for (std::size_t moved = 1; ok && moved < objects.size(); ++moved) {
+        objects[moved].SetPosition(10.0f, 10.0f, 0.0f);
+        culler.UpdateObject(moved, objects[moved]);
+        culler.Cull(frustum);
+        ok = culler.CountVisible() == objects.size() - moved;
+    }
+    culler.Destroy();
+    GLState::Get().DeleteProgram(program);
+    return ok;
+}
+
+//--------------------------------------------------STATISTICS----------------------------------------------------------------------
+
+struct Summary {
+    double mean = 0, min = 0, max = 0, p50 = 0, p90 = 0, p95 = 0, p99 = 0;
+};
+
+//nearest-rank percentile on a sorted sample
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::size_t rank = (std::size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static Summary summarize(std::vector<double> samples)
+{
+    Summary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    summary.mean = total / samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(samples, 50);
+    summary.p90 = percentile(samples, 90);
+    summary.p95 = percentile(samples, 95);
+    summary.p99 = percentile(samples, 99);
+    return summary;
+}
+
+struct SceneResult {
+    std::string name;
+    int count = 0;
+    double wallSeconds = 0.0;
+    std::vector<double> cpuMs, gpuMs;
+    std::vector<std::pair<std::string, double>> stats;
+};
+
+//--------------------------------------------------RUNNER----------------------------------------------------------------------
+
+struct BenchOptions {
+    int frames = 200;
+    int warmup = 20;
+    int width = 1280;
+    int height = 720;
+    int scale = 1;                  //multiplies every scene's N
+    std::string scene;              //run only this scene, empty = all
+    std::string output = "menace_bench.json";
+};
+
+static SceneResult runScene(BenchScene& scene, const BenchOptions& options, Framebuffer& framebuffer)
+{
+    SceneResult result;
+    result.name = scene.Name();
+    result.count = scene.count;
+
+    scene.Setup();
+    framebuffer.Bind();
+    glEnable(GL_DEPTH_TEST);
+
+    GLuint queries[kQueryLatency];
+    glGenQueries(kQueryLatency, queries);
+
+    int totalFrames = options.warmup + options.frames;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < totalFrames + kQueryLatency; ++frame) {
+        GLuint query = queries[frame % kQueryLatency];
+
+        //collect the query issued kQueryLatency frames ago before reusing its slot
+        if (frame >= kQueryLatency) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (frame - kQueryLatency >= options.warmup) {
+                result.gpuMs.push_back(elapsed / 1.0e6);
+            }
+        }
+        if (frame == options.warmup) {
+            wallStart = std::chrono::steady_clock::now();
+        }
+        if (frame >= totalFrames) {
+            continue;
+        }
+
+        auto cpuStart = std::chrono::steady_clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, query);
+
+        //most scenes call GL directly, so the cache can't trust what it saw last frame
+        GLState& state = GLState::Get();
+        state.Invalidate();
+        state.ResetCounters();
+
+        glClearColor(0.2f, 0.9f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.Draw();
+
+        glEndQuery(GL_TIME_ELAPSED);
+        glFlush();
+        double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+        if (frame >= options.warmup) {
+            result.cpuMs.push_back(cpuMs);
+        }
+    }
+
+    glFinish();
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    glDeleteQueries(kQueryLatency, queries);
+    scene.Stats(result.stats);
+    //counters of the last frame, only calls routed through GLState show up here
+    const GLState::Counters& counters = GLState::Get().GetCounters();
+    if (counters.TotalIssued() + counters.TotalElided() > 0) {
+        result.stats.push_back({ "gl_calls_issued", (double)counters.TotalIssued() });
+        result.stats.push_back({ "gl_calls_elided", (double)counters.TotalElided() });
+    }
+    scene.Teardown();
+    return result;
+}
+
+static void writeSummary(FILE* out, const char* name, const Summary& summary)
+{
+    std::fprintf(out, "      \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f }",
+                 name, summary.mean, summary.min, summary.max, summary.p50, summary.p90, summary.p95, summary.p99);
+}
+
+//renderer strings can contain quotes or backslashes, keep the json valid
+static std::string jsonEscape(const char* text)
+{
+    std::string escaped;
+    for (const char* c = text ? text : ""; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        if ((unsigned char)*c >= 0x20) {
+            escaped += *c;
+        }
+    }
+    return escaped;
+}
+
+static void writeJson(FILE* out, const BenchOptions& options, const StartupResult& startup, const ImportResult& import,
+                      const MathResult& math, const HierarchyResult& hierarchy, const RasterResult& raster,
+                      const std::vector<SceneResult>& results)
+{
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"revision\": \"%s\",\n", MENACE_GIT_REVISION);
+    std::fprintf(out, "  \"renderer\": \"%s\",\n", jsonEscape((const char*)glGetString(GL_RENDERER)).c_str());
+    std::fprintf(out, "  \"gl_version\": \"%s\",\n", jsonEscape((const char*)glGetString(GL_VERSION)).c_str());
+    std::fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", options.width, options.height);
+    std::fprintf(out, "  \"frames\": %d,\n  \"warmup\": %d,\n", options.frames, options.warmup);
+    std::fprintf(out, "  \"shader_startup\": { \"programs\": %d, \"cold_ms\": %.4f, \"warm_ms\": %.4f, \"warm_cache_hits\": %d, "
+                      "\"async_submit_ms\": %.4f, \"async_ready_ms\": %.4f, \"async_main_thread_ms\": %.4f, \"async_polls\": %d },\n",
+                 startup.programs, startup.coldMs, startup.warmMs, startup.warmCacheHits,
+                 startup.asyncSubmitMs, startup.asyncReadyMs, startup.asyncMainThreadMs, startup.asyncPolls);
+    std::fprintf(out, "  \"mesh_import\": { \"triangles\": %zu, \"threads\": %d, \"obj_bytes\": %zu, \"obj_ms\": %.4f, \"obj_mb_per_s\": %.2f, "
+                      "\"ply_bytes\": %zu, \"ply_ms\": %.4f, \"ply_mb_per_s\": %.2f },\n",
+                 import.triangles, import.threads, import.objBytes, import.objMs, import.objMegabytesPerSecond,
+                 import.plyBytes, import.plyMs, import.plyMegabytesPerSecond);
+    std::fprintf(out, "  \"math\": { \"backend\": \"%s\", \"points\": %zu, \"points_scalar_ms\": %.4f, \"points_simd_ms\": %.4f, "
+                      "\"points_max_error\": %g, \"matrices\": %zu, \"matrices_scalar_ms\": %.4f, \"matrices_simd_ms\": %.4f, "
+                      "\"matrices_max_error\": %g },\n",
+                 math.backend, math.points, math.pointsScalarMs, math.pointsSimdMs, math.pointsMaxError,
+                 math.matrices, math.matricesScalarMs, math.matricesSimdMs, math.matricesMaxError);
+    std::fprintf(out, "  \"transform_hierarchy\": { \"nodes\": %zu, \"threads\": %d, \"reorder_ms\": %.4f, \"full_update_ms\": %.4f, "
+                      "\"animated\": %zu, \"animated_update_us\": %.3f, \"animated_nodes_updated\": %zu },\n",
+                 hierarchy.nodes, hierarchy.threads, hierarchy.reorderMs, hierarchy.fullMs,
+                 hierarchy.animated, hierarchy.animatedUs, hierarchy.animatedUpdated);
+    std::fprintf(out, "  \"occlusion_raster\": { \"width\": %d, \"height\": %d, \"threads\": %d, \"triangles\": %zu, \"rasterized\": %zu, "
+                      "\"raster_ms\": %.4f, \"triangles_per_s\": %.0f, \"boxes\": %zu, \"occluded\": %zu, \"test_ms\": %.4f, \"boxes_per_s\": %.0f },\n",
+                 raster.width, raster.height, raster.threads, raster.triangles, raster.rasterized,
+                 raster.rasterMs, raster.trianglesPerSecond, raster.boxes, raster.occluded, raster.testMs, raster.boxesPerSecond);
+    std::fprintf(out, "  \"scenes\": [\n");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const SceneResult& result = results[i];
+        std::fprintf(out, "    {\n");
+        std::fprintf(out, "      \"name\": \"%s\",\n", result.name.c_str());
+        std::fprintf(out, "      \"count\": %d,\n", result.count);
+        std::fprintf(out, "      \"fps\": %.2f,\n", result.wallSeconds > 0.0 ? result.cpuMs.size() / result.wallSeconds : 0.0);
+        writeSummary(out, "cpu_ms", summarize(result.cpuMs));
+        std::fprintf(out, ",\n");
+        writeSummary(out, "gpu_ms", summarize(result.gpuMs));
+        if (!result.stats.empty()) {
+            std::fprintf(out, ",\n      \"stats\": {");
+            for (std::size_t s = 0; s < result.stats.size(); ++s) {
+                std::fprintf(out, "%s \"%s\": %.4f", s ? "," : "", result.stats[s].first.c_str(), result.stats[s].second);
+            }
+            std::fprintf(out, " }");
+        }
+        std::fprintf(out, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+            options.width = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.height = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--scale") == 0 && hasValue) {
+            options.scale = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--scene") == 0 && hasValue) {
+            options.scene = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.output = argv[++i];
+        } else {
+            std::cout << "usage: " << argv[0]
+                      << " [--frames N] [--warmup N] [--width W] [--height H] [--scale N] [--scene NAME] [--output FILE.json]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return -1;
+    }
+
+    //4.3 for the GPU culling scene, a driver without it still runs everything else on 3.3
+    HeadlessContext context;
+    if (!context.Create(4, 3) && !context.Create(3, 3)) {
+        return -1;
+    }
+    Framebuffer framebuffer;
+    if (!framebuffer.Create(options.width, options.height)) {
+        return -1;
+    }
+
+    StartupResult startup = measureShaderStartup(32);
+    std::cout << "shader startup (" << startup.programs << " programs): cold " << startup.coldMs << " ms, warm "
+              << startup.warmMs << " ms (" << startup.warmCacheHits << " cache hits), async submit "
+              << startup.asyncSubmitMs << " ms, ready after " << startup.asyncReadyMs << " ms" << std::endl;
+
+    ImportResult import = measureMeshImport(700 * options.scale);
+    std::cout << "mesh import (" << import.triangles << " triangles, " << import.threads << " threads): obj "
+              << import.objMegabytesPerSecond << " MB/s (" << import.objMs << " ms), binary ply "
+              << import.plyMegabytesPerSecond << " MB/s (" << import.plyMs << " ms)" << std::endl;
+    if (!checkMixedPolygonImport()) {
+        std::cout << "ERROR: MIXED TRIANGLE / QUAD PLY DID NOT IMPORT ON EVERY THREAD COUNT" << std::endl;
+        return -1;
+    }
+
+    MathResult math = measureMath(1000000 * options.scale, 250000 * options.scale);
+    std::cout << "math (" << math.backend << "): " << math.points << " points scalar " << math.pointsScalarMs << " ms, simd "
+              << math.pointsSimdMs << " ms | " << math.matrices << " matrices scalar " << math.matricesScalarMs << " ms, simd "
+              << math.matricesSimdMs << " ms, max error " << std::max(math.pointsMaxError, math.matricesMaxError) << std::endl;
+    if (!(math.pointsMaxError <= kMathTolerance && math.matricesMaxError <= kMathTolerance)) {
+        std::cout << "ERROR: SIMD MATH DOES NOT MATCH THE SCALAR REFERENCE" << std::endl;
+        return -1;
+    }
+
+    HierarchyResult hierarchy = measureHierarchy(500000 * options.scale, 16);
+    std::cout << "transform hierarchy (" << hierarchy.nodes << " nodes): full update " << hierarchy.fullMs << " ms ("
+              << hierarchy.threads << " threads), " << hierarchy.animated << " animated nodes " << hierarchy.animatedUs
+              << " us (" << hierarchy.animatedUpdated << " matrices)" << std::endl;
+
+    RasterResult raster = measureOcclusionRaster(5000 * options.scale, 100000 * options.scale);
+    std::cout << "occlusion raster (" << raster.width << "x" << raster.height << ", " << raster.threads << " threads): "
+              << raster.triangles << " triangles in " << raster.rasterMs << " ms (" << raster.trianglesPerSecond / 1e6
+              << " M triangles/s), " << raster.boxes << " boxes tested in " << raster.testMs << " ms, "
+              << raster.occluded << " occluded" << std::endl;
+
+    if (GpuCuller::Supported() && !checkGpuCullerUpdates()) {
+        std::cout << "ERROR: GPU CULLER MISSED OBJECTS MOVED WITH UpdateObject" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::unique_ptr<BenchScene>> scenes;
+    scenes.push_back(std::make_unique<TrianglesScene>(100000 * options.scale));
+    scenes.push_back(std::make_unique<MeshesScene>(1000 * options.scale));
+    scenes.push_back(std::make_unique<DrawCallsScene>(10000 * options.scale));
+    scenes.push_back(std::make_unique<ShaderSwitchesScene>(1000 * options.scale));
+    scenes.push_back(std::make_unique<GridSoupScene>(250 * options.scale));
+    scenes.push_back(std::make_unique<GridIndexedScene>(250 * options.scale, GridIndexedScene::Float));
+    scenes.push_back(std::make_unique<GridIndexedScene>(250 * options.scale, GridIndexedScene::Packed));
+    scenes.push_back(std::make_unique<GridIndexedScene>(250 * options.scale, GridIndexedScene::Quantized));
+    scenes.push_back(std::make_unique<GridIndexedScene>(250 * options.scale, GridIndexedScene::Cached));
+    scenes.push_back(std::make_unique<RendererQueueScene>(10000 * options.scale, false));
+    scenes.push_back(std::make_unique<RendererQueueScene>(10000 * options.scale, true));
+    scenes.push_back(std::make_unique<ObjectsScene>(100000 * options.scale, ObjectsScene::Individual));
+    scenes.push_back(std::make_unique<ObjectsScene>(100000 * options.scale, ObjectsScene::Instanced));
+    scenes.push_back(std::make_unique<ObjectsScene>(400000 * options.scale, ObjectsScene::Culled));
+    if (GpuCuller::Supported()) {
+        scenes.push_back(std::make_unique<ObjectsScene>(400000 * options.scale, ObjectsScene::GpuCulled));
+        scenes.push_back(std::make_unique<ObjectsScene>(400000 * options.scale, ObjectsScene::Occluded));
+    }
+    scenes.push_back(std::make_unique<ObjectsScene>(400000 * options.scale, ObjectsScene::CpuOccluded));
+    scenes.push_back(std::make_unique<LodScene>(1000 * options.scale, LodScene::Full));
+    scenes.push_back(std::make_unique<LodScene>(1000 * options.scale, LodScene::Selected));
+    scenes.push_back(std::make_unique<MeshletScene>(128 * options.scale, MeshletScene::Whole));
+    scenes.push_back(std::make_unique<MeshletScene>(128 * options.scale, MeshletScene::MultiDraw));
+    if (MeshletCuller::SupportsIndirect()) {
+        scenes.push_back(std::make_unique<MeshletScene>(128 * options.scale, MeshletScene::Indirect));
+    }
+    scenes.push_back(std::make_unique<DynamicGeometryScene>(100000 * options.scale, DynamicGeometryScene::SubData));
+    scenes.push_back(std::make_unique<DynamicGeometryScene>(100000 * options.scale, DynamicGeometryScene::Orphan));
+    scenes.push_back(std::make_unique<DynamicGeometryScene>(100000 * options.scale, DynamicGeometryScene::Persistent));
+    scenes.push_back(std::make_unique<StreamingScene>(250, 8 * options.scale, StreamingScene::Sync));
+    scenes.push_back(std::make_unique<StreamingScene>(250, 8 * options.scale, StreamingScene::Streamed));
+
+    std::vector<SceneResult> results;
+    for (auto& scene : scenes) {
+        if (!options.scene.empty() && options.scene != scene->Name()) {
+            continue;
+        }
+        results.push_back(runScene(*scene, options, framebuffer));
+        Summary cpu = summarize(results.back().cpuMs);
+        Summary gpu = summarize(results.back().gpuMs);
+        std::cout << scene->Name() << " (N=" << scene->count << "): cpu p50 " << cpu.p50 << " ms, p99 " << cpu.p99
+                  << " ms | gpu p50 " << gpu.p50 << " ms, p99 " << gpu.p99 << " ms" << std::endl;
+    }
+
+    FILE* out = std::fopen(options.output.c_str(), "w");
+    if (!out) {
+        std::cout << "ERROR: COULD NOT OPEN " << options.output << std::endl;
+        return -1;
+    }
+    writeJson(out, options, startup, import, math, hierarchy, raster, results);
+    std::fclose(out);
+    std::cout << "wrote " << options.output << std::endl;
+    return 0;
+}
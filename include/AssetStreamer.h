@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "GltfLoader.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "RingBuffer.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+Streams meshes, glTF scenes and textures in while the render loop keeps running.
+
+    AssetStreamer streamer;
+    streamer.Create();
+    AssetStreamer::Handle rock = streamer.Request("rock.mmsh");
+    ...every frame, on the context thread:
+    streamer.Update();
+    if (Mesh* mesh = streamer.GetMesh(rock)) renderer.Submit(*mesh, program);
+
+A pool of worker threads maps and decodes the files (MeshFile, MeshImporter + MeshOptimizer, GltfLoader, PPM),
+without touching GL. Update() then moves the decoded bytes to the GPU through a staging RingBuffer:
+at most `bytesPerFrame` are copied into the ring per call and glCopyBufferSubData / glTexSubImage2D (from the ring
+as GL_PIXEL_UNPACK_BUFFER) move them into the final buffers and textures, so a level streaming in costs every frame
+the same bounded amount instead of one long stall. After an asset's last copy a fence is inserted, the asset only
+turns Ready (and GetMesh / GetTexture stop returning null) once the GPU has passed that fence, so the first draw
+never waits on a transfer.
+Everything GL happens on the thread calling Update(), which works the same for the window and the headless context.
+
+Formats by extension: .mmsh / .obj / .ply (one Mesh), .glb / .gltf (one Mesh per primitive, see GetScene),
+.ppm (binary P6, RGB8 texture with mipmaps).
+*/
+class AssetStreamer {
+    public:
+        typedef uint32_t Handle;            //0 = no asset
+
+        enum class State { Queued, Uploading, Ready, Failed };
+
+        struct Options {
+            int threads = 0;                        //decode workers, 0 = one per hardware thread but the render thread
+            std::size_t bytesPerFrame = 4 << 20;    //staged per Update(), the upload cost of a frame
+            bool optimize = true;                   //run the MeshOptimizer passes on OBJ / PLY meshes
+        };
+
+        struct Stats {
+            std::size_t requested = 0, ready = 0, failed = 0;
+            std::size_t bytesUploaded = 0;
+            std::size_t maxFrameBytes = 0;          //most bytes staged by a single Update()
+            double maxUpdateMs = 0.0;               //slowest Update(), the spike streaming adds to a frame
+            double decodeMs = 0.0;                  //summed over all workers
+        };
+
+        AssetStreamer() = default;
+        ~AssetStreamer();
+        AssetStreamer(const AssetStreamer&) = delete;
+        AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+        //needs the context current, creates the staging ring and starts the workers
+        bool Create(const Options& options);
+        bool Create() { return Create(Options()); }
+        //stops the workers (a decode that is running is finished first) and frees every asset's GL objects
+        void Destroy();
+
+        //queues `path` for decoding, 0 and an ERROR line for an unknown extension
+        Handle Request(const std::string& path);
+        //drops the asset and its GL objects, one that is still in flight goes as soon as it lands
+        void Release(Handle handle);
+
+        //once per frame on the context thread: finished fences, decoded assets, the frame's uploads
+        void Update();
+        //Update() until nothing is queued or uploading anymore, for loading screens and headless runs
+        void Finish();
+
+        State GetState(Handle handle) const;
+        //null / 0 until the asset is Ready
+        Mesh* GetMesh(Handle handle, std::size_t index = 0) const;
+        std::vector<Mesh*> GetMeshes(Handle handle) const;
+        GLuint GetTexture(Handle handle) const;
+        //nodes and bounds of a Ready glTF asset, its GetMeshes() line up with scene->primitives (see GltfLoader::Instantiate),
+        //the primitives' data pointers are no longer valid
+        const GltfScene* GetScene(Handle handle) const;
+
+        std::size_t Pending() const { return pending_; }
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        enum class Kind { Mesh, Scene, Texture };
+
+        //one staged copy into a mesh buffer
+        struct Copy {
+            const unsigned char* source;
+            std::size_t bytes;
+            GLuint buffer;
+        };
+
+        struct Asset {
+            Handle handle = 0;
+            Kind kind = Kind::Mesh;
+            std::string path;
+            State state = State::Queued;
+            bool released = false;
+
+            //written by the worker, read on the context thread once the asset is out of the decoded list
+            bool decoded = false;
+            double decodeMs = 0.0;
+            MappedFile file;
+            MeshFile meshFile;
+            MeshImporter::Result imported;
+            std::vector<uint16_t> shortIndices;
+            GltfScene scene;
+            std::vector<PackedMeshData> parts;
+            int width = 0, height = 0;
+            const unsigned char* pixels = nullptr;
+
+            //context thread
+            std::vector<std::unique_ptr<Mesh>> meshes;
+            GLuint texture = 0;
+            std::vector<Copy> copies;
+            std::size_t nextCopy = 0, copyOffset = 0;
+            int nextRow = 0;
+            GLsync fence = nullptr;
+        };
+
+        void work();
+        static bool decode(Asset& asset, const Options& options);
+        bool beginUpload(Asset& asset);
+        void finishUpload(Asset& asset);
+        void land(Asset& asset, bool ready);
+        void destroy(Asset& asset);
+        Asset* find(Handle handle) const;
+
+        Options options_;
+        RingBuffer staging_;
+        std::unordered_map<Handle, std::unique_ptr<Asset>> assets_;
+        Handle nextHandle_ = 1;
+        std::size_t pending_ = 0;
+        Stats stats_;
+
+        //context thread only
+        std::deque<Asset*> uploads_;        //decoded, in upload order
+        std::vector<Asset*> fenced_;        //every copy issued, waiting for the GPU
+
+        //shared with the workers
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::deque<Asset*> queue_;
+        std::vector<Asset*> decoded_;
+        bool stopping_ = false;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+/*
+Offscreen render target, RGBA8 color + 24 bit depth renderbuffers.
+Used by the headless mode instead of the default framebuffer of a window.
+*/
+class Framebuffer {
+    public:
+        Framebuffer() = default;
+        ~Framebuffer();
+
+        Framebuffer(const Framebuffer&) = delete;
+        Framebuffer& operator=(const Framebuffer&) = delete;
+
+        bool Create(int width, int height);
+        void Destroy();
+
+        //bind for drawing and set the viewport to cover the whole target
+        void Bind() const;
+
+        //reads the color attachment back into `pixels` (RGBA, bottom row first)
+        void ReadPixels(std::vector<unsigned char>& pixels) const;
+
+        //writes the pixels as a binary PPM, flipped so the top row comes first
+        bool WritePPM(const std::string& path, const std::vector<unsigned char>& pixels) const;
+
+        int Width() const { return width_; }
+        int Height() const { return height_; }
+        GLuint Handle() const { return FBO_; }
+
+    private:
+        GLuint FBO_ = 0, colorRBO_ = 0, depthRBO_ = 0;
+        int width_ = 0, height_ = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "SimdMath.h"
+#include "JobPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class Object3D;
+
+/*
+Frustum culling on the CPU, before anything reaches the Renderer.
+
+    FrustumCuller culler;
+    culler.Create();
+    ...every frame:
+    Frustum frustum = Frustum::FromMatrix(projection * view);
+    for (uint32_t index : culler.Cull(frustum, objects)) renderer.Submit(objects[index]);
+
+Cull(objects) turns every Object3D's mesh bounds into a world space box (center / extents, SoA) and tests the boxes
+against the six planes 4 or 8 at a time (SimdMath::CullBoxes). The work is cut into chunks of Options::chunkSize
+that the calling thread and the JobPool's workers pick up as they go (JobPool::Filter), so the visible list is in
+object order whatever thread finished first. Callers keeping their own bounds in SoA (see TransformHierarchy) use
+CullBoxes / CullSpheres directly.
+Without Create() everything runs on the calling thread.
+*/
+class FrustumCuller {
+    public:
+        struct Options {
+            int threads = 0;                    //workers besides the calling thread, 0 = one per hardware thread but the caller's
+            std::size_t chunkSize = 4096;       //objects per job, less than two chunks of work stay on the calling thread
+        };
+
+        struct Stats {
+            std::size_t tested = 0;
+            std::size_t visible = 0;
+            std::size_t chunks = 0;
+            int threads = 0;                    //threads that took part, the caller included
+            double cullMs = 0.0;                //bounds and plane tests, wall time on the calling thread
+        };
+
+        FrustumCuller() = default;
+        ~FrustumCuller();
+        FrustumCuller(const FrustumCuller&) = delete;
+        FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+        bool Create(const Options& options);
+        bool Create() { return Create(Options()); }
+        void Destroy();
+
+        //indices into `objects` of everything at least partly inside, valid until the next call
+        const std::vector<uint32_t>& Cull(const Frustum& frustum, const std::vector<Object3D>& objects);
+        //SoA world bounds, boxes as center + half extents
+        const std::vector<uint32_t>& CullBoxes(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                               const float* extentX, const float* extentY, const float* extentZ, std::size_t count);
+        const std::vector<uint32_t>& CullSpheres(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                                 const float* radius, std::size_t count);
+
+        const std::vector<uint32_t>& Visible() const { return visible_; }
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        //filters [0, total) in chunks of Options::chunkSize through the pool and fills in the stats
+        void run(std::size_t total, const std::function<std::size_t(std::size_t begin, std::size_t end, uint32_t* out)>& chunk);
+
+        Options options_;
+        JobPool pool_;
+        std::vector<uint32_t> visible_;
+        std::vector<float> bounds_;         //center x / y / z, extent x / y / z, `count` each
+        Stats stats_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+Entry points beyond the GL 3.3 core that glad was generated for.
+Loaded after gladLoadGLLoader with the same loader, same naming scheme as glad:
+a GLEXT_<extension> flag, a glext_<function> pointer and a gl<Function> macro.
+Always check the flag before calling, the pointers are null when the driver lacks the feature.
+*/
+
+//--------------------------------------------------ARB_get_program_binary (core in 4.1)--------------------------------------------------
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+extern int GLEXT_ARB_get_program_binary;
+extern PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+
+//--------------------------------------------------KHR_parallel_shader_compile (or the ARB twin)--------------------------------------------------
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+extern int GLEXT_KHR_parallel_shader_compile;
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+
+//--------------------------------------------------ARB_buffer_storage (core in 4.4)--------------------------------------------------
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+extern int GLEXT_ARB_buffer_storage;
+extern PFNGLBUFFERSTORAGEPROC glext_glBufferStorage;
+#define glBufferStorage glext_glBufferStorage
+
+//--------------------------------------------------ARB_compute_shader, ARB_shader_storage_buffer_object, ARB_multi_draw_indirect (core in 4.3)--------------------------------------------------
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+extern int GLEXT_ARB_compute_shader;
+extern int GLEXT_ARB_shader_storage_buffer_object;
+extern int GLEXT_ARB_multi_draw_indirect;
+extern PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+#define glDispatchCompute glext_glDispatchCompute
+#define glMemoryBarrier glext_glMemoryBarrier
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+
+//--------------------------------------------------ARB_shader_image_load_store (core in 4.2)--------------------------------------------------
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+
+extern int GLEXT_ARB_shader_image_load_store;
+extern PFNGLBINDIMAGETEXTUREPROC glext_glBindImageTexture;
+#define glBindImageTexture glext_glBindImageTexture
+
+//loads every entry point above, call once the context is current and glad is loaded
+void loadGLExtensions(GLADloadproc load);
+
+//true if the context version is at least major.minor
+bool hasGLVersion(int major, int minor);
+
+//true if the context advertises the extension (GL_EXTENSIONS through glGetStringi)
+bool hasGLExtension(const char* name);
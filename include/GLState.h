@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+/*
+Shadow copy of the GL binding/pipeline state of the current context.
+Every subsystem binds through here instead of calling gl* directly, a call that would not change
+anything is skipped. Counters track issued vs elided calls per category so the savings can be measured.
+
+One instance per thread (each thread has its own current context). If code outside the cache touches
+the same state, call Invalidate() afterwards. Delete objects through the Delete* helpers so a recycled
+GL name is never mistaken for the still-bound old object.
+*/
+class GLState {
+    public:
+        enum class Category {
+            Program,
+            VertexArray,
+            Buffer,
+            Texture,
+            Capability,         //glEnable/glDisable
+            BlendFunc,
+            DepthFunc,
+            DepthMask,
+            CullFace,
+            Framebuffer,
+            Viewport,
+            CategoryCount
+        };
+
+        struct Counters {
+            std::size_t issued[(int)Category::CategoryCount] = {};
+            std::size_t elided[(int)Category::CategoryCount] = {};
+            std::size_t TotalIssued() const;
+            std::size_t TotalElided() const;
+        };
+
+        //the cache of the calling thread's context
+        static GLState& Get();
+
+        //forget everything, the next call of every kind goes to the driver
+        void Invalidate();
+
+        //all return true if the GL call was actually issued
+        bool UseProgram(GLuint program);
+        bool BindVertexArray(GLuint VAO);
+        bool BindBuffer(GLenum target, GLuint buffer);
+        //indexed bindings (uniform / shader storage blocks) are not cached, but the call binds the generic target too
+        bool BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+        bool BindTexture(GLuint unit, GLenum target, GLuint texture);
+        bool BindFramebuffer(GLenum target, GLuint framebuffer);
+        bool Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        bool SetBlend(bool enabled);
+        bool BlendFunc(GLenum source, GLenum destination);
+        bool SetDepthTest(bool enabled);
+        bool DepthFunc(GLenum function);
+        bool DepthMask(bool write);
+        bool SetCullFace(bool enabled);
+        bool CullFace(GLenum face);
+
+        //delete and drop from the cache if bound
+        void DeleteProgram(GLuint program);
+        void DeleteVertexArray(GLuint VAO);
+        void DeleteBuffer(GLuint buffer);
+        void DeleteTexture(GLuint texture);
+        void DeleteFramebuffer(GLuint framebuffer);
+
+        GLuint CurrentProgram() const { return program_; }
+        GLuint CurrentVertexArray() const { return VAO_; }
+
+        const Counters& GetCounters() const { return counters_; }
+        void ResetCounters() { counters_ = Counters(); }
+
+        static const char* CategoryName(Category category);
+
+    private:
+        GLState() { Invalidate(); }
+
+        static const GLuint kUnknown = 0xFFFFFFFF;
+        static const int kBufferTargets = 10;
+        static const int kTextureUnits = 32;
+        static const int kTextureTargets = 4;
+        enum Tristate { Off = 0, On = 1, Unknown = 2 };
+
+        bool issue(Category category, bool changed);
+        bool setCapability(GLenum capability, Tristate& cached, bool enabled);
+        static int bufferTargetIndex(GLenum target);
+        static int textureTargetIndex(GLenum target);
+
+        GLuint program_, VAO_;
+        GLuint buffers_[kBufferTargets];
+        GLuint textures_[kTextureUnits][kTextureTargets];
+        GLuint activeUnit_;
+        GLuint drawFramebuffer_, readFramebuffer_;
+        GLint viewport_[4];
+        Tristate blend_, depthTest_, cullFace_, depthMask_;
+        GLenum blendSource_, blendDestination_, depthFunc_, cullMode_;
+        Counters counters_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+//a glTF node, flattened: nodes come parents first, `parent` indexes this same list
+struct GltfNode {
+    std::string name;
+    int parent = -1;
+    int mesh = -1;                  //glTF mesh, see GltfScene::primitives
+    float local[16];                //column major, relative to the parent
+    float world[16];
+};
+
+//one drawable glTF primitive, `data` points into the mapped file or into GltfScene's converted buffers
+struct GltfPrimitive {
+    int mesh = 0;                   //glTF mesh it belongs to
+    PackedMeshData data;
+    bool converted = false;         //false: every stream and the indices come straight from the file's buffers
+};
+
+/*
+glTF 2.0 scene (.glb, or .gltf with external .bin buffers), loaded in two steps so it can happen behind the render loop:
+
+    GltfScene scene;
+    std::thread loader([&] { GltfLoader::Load(path, scene); });        //any thread, no GL
+    ...
+    GltfLoader::Upload(scene, program, meshes, objects);                //context thread, buffer uploads only
+
+Load maps the file and works out a VertexLayout for every triangle primitive. Where the accessors already sit in the
+file the way a VertexLayout would put them (one bufferView per stream, at most 4, attributes in offset order with
+the layout's 4 byte padding, POSITION / NORMAL / TANGENT / TEXCOORD_0/1 / COLOR_0 in float or (normalized) 8/16 bit
+integers) the bufferViews become the vertex streams unchanged and Upload hands them to GL straight from the mapping.
+Anything else (sparse accessors, unused interleaved attributes, 8 bit or missing indices) is converted into float
+vertices + 16/32 bit indices.
+Node matrices and TRS are resolved into world matrices, Upload makes one Object3D per node and primitive.
+Materials are not read yet (Object3D texture 0), skins and morph targets are ignored.
+*/
+struct GltfScene {
+    std::vector<GltfNode> nodes;
+    std::vector<GltfPrimitive> primitives;
+    float boundsMin[3] = {}, boundsMax[3] = {};     //world space, over every node that draws something
+
+    struct Stats {
+        std::size_t zeroCopyPrimitives = 0, convertedPrimitives = 0, skippedPrimitives = 0;
+        std::size_t zeroCopyBytes = 0, convertedBytes = 0;     //vertex + index data handed to Upload
+        double loadMs = 0.0;
+    } stats;
+
+    //what `primitives` point into, has to stay alive until Upload
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<std::vector<unsigned char>> convertedBuffers;
+};
+
+namespace GltfLoader {
+
+    //parses `path` into `scene` without touching GL, safe on any thread; false and an ERROR line on failure
+    bool Load(const std::string& path, GltfScene& scene);
+
+    //one Mesh per primitive (appended to `meshes`) and one Object3D per node and primitive (appended to `objects`),
+    //`root` (column major, optional) goes on top of every world matrix; the scene can be destroyed afterwards
+    void Upload(const GltfScene& scene, GLuint program, std::vector<std::unique_ptr<Mesh>>& meshes,
+                std::vector<Object3D>& objects, const float* root = nullptr);
+
+    //the Object3D half of Upload, for meshes that were created elsewhere (AssetStreamer), one per scene.primitives
+    void Instantiate(const GltfScene& scene, GLuint program, const std::vector<Mesh*>& primitiveMeshes,
+                     std::vector<Object3D>& objects, const float* root = nullptr);
+
+}
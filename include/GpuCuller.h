@@ -0,0 +1,166 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "SimdMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+class Object3D;
+
+/*
+GPU driven culling: the objects live in GPU buffers, a compute shader tests them against the frustum and writes
+the survivors' matrices and instance counts, glMultiDrawElementsIndirect draws from what it wrote.
+The CPU never touches a single object per frame, so a frame costs the same for 1k and 1M objects.
+
+    if (GpuCuller::Supported() && gpuCuller.Create()) {
+        gpuCuller.SetObjects(objects);      //once, or when the set changes
+        ...every frame:
+        gpuCuller.Cull(frustum);
+        gpuCuller.Draw();
+    } else {
+        //FrustumCuller + Renderer
+    }
+
+Objects are batched like the Renderer does (mesh + program + texture), each batch owns one indirect command and
+a slice of the instance buffer as big as the batch. Per frame the commands are reset from a template by a
+buffer copy, the compute shader (one invocation per object) transforms the mesh bounds by the model matrix,
+tests the box against the six planes and appends model * dequantization to its batch with an atomicAdd
+on the command's instanceCount. Draw() binds each batch's VAO and material once and issues its commands,
+the instance attributes (3-6, as in the Renderer) start at the command's baseInstance.
+
+With Options::occlusion the objects are also tested against a depth pyramid (Hi-Z), in two phases so nothing pops
+when the camera moves or an occluder goes away:
+
+    gpuCuller.Cull(projection * view);                  //phase 1: in the frustum and visible last frame
+    gpuCuller.Draw();
+    if (gpuCuller.CullOccluded(framebuffer, width, height)) {
+        gpuCuller.Draw();                               //phase 2: what phase 1 missed
+    }
+
+Phase 1 draws what was visible last frame without any occlusion test, those are the likely occluders. CullOccluded()
+copies the depth buffer phase 1 left, reduces it to a pyramid where every texel keeps the farthest depth of the 2x2
+texels below it (level 0 is half the framebuffer), and tests every object in the frustum against it: the projected
+box picks the level where it spans at most 2x2 texels, and the object is occluded if its nearest depth is behind
+the farthest of those four. The test rewrites the per-object visibility for the next frame's phase 1 and appends the
+objects phase 1 did not draw but which turned out visible, so they show up this frame instead of one frame late.
+Phase 2 writes its instances after those of phase 1 in each batch's range and uses its own commands, nothing the
+phase 1 draws still read gets overwritten. The test assumes the default depth range and a viewport covering the
+framebuffer, the framebuffer must not be multisampled.
+
+Needs GL 4.3 (compute shaders, SSBOs, multi draw indirect, image load / store), Supported() says whether the current
+context has it; on a 3.3 context fall back to FrustumCuller. Mesa's llvmpipe runs it, so it can be tested headless.
+Opaque objects only: instances of a batch come out in whatever order the GPU appended them.
+*/
+class GpuCuller {
+    public:
+        struct Options {
+            bool occlusion = false;             //two phase Hi-Z culling, see above
+        };
+
+        struct Stats {
+            std::size_t objects = 0;
+            std::size_t batches = 0;
+            std::size_t commands = 0;
+            std::size_t drawCalls = 0;          //glMultiDrawElementsIndirect calls of the last Draw()
+            std::size_t dispatches = 0;         //compute dispatches of the last Cull() / CullOccluded(), pyramid levels included
+            std::size_t pyramidLevels = 0;
+            double uploadMs = 0.0;              //last SetObjects()
+        };
+
+        //what the GPU counted in the last frame, see ReadOcclusionStats()
+        struct OcclusionStats {
+            std::size_t tested = 0;
+            std::size_t frustumCulled = 0;
+            std::size_t occluded = 0;           //in the frustum but behind the pyramid, drawn in neither phase
+            std::size_t firstPhase = 0;         //drawn because they were visible last frame
+            std::size_t secondPhase = 0;        //drawn after passing this frame's pyramid
+            std::size_t occludedTriangles = 0;  //triangles the occluded objects would have drawn, 32 bit counter on the GPU
+        };
+
+        GpuCuller() = default;
+        ~GpuCuller();
+        GpuCuller(const GpuCuller&) = delete;
+        GpuCuller& operator=(const GpuCuller&) = delete;
+
+        //true if the current context can run the compute path
+        static bool Supported();
+
+        //compiles the culling shaders, false and an ERROR line if the context lacks 4.3 or the compile fails
+        bool Create(const Options& options);
+        bool Create() { return Create(Options()); }
+        void Destroy();
+
+        //uploads matrices, bounds and batches of every object, O(objects), only when the set changes
+        bool SetObjects(const std::vector<Object3D>& objects);
+        //rewrites an object's matrix after it moved, mesh and material have to be the ones it was uploaded with
+        void UpdateObject(std::size_t index, const Object3D& object);
+
+        //resets the commands and dispatches the culling shader, frustum only
+        void Cull(const Frustum& frustum);
+        //same for the frustum of the matrix, with Options::occlusion only what was visible last frame (phase 1)
+        void Cull(const Mat4& viewProjection);
+        //phase 2, builds the pyramid from the depth of `framebuffer` (0 = the window's) and culls against it,
+        //false if there is nothing to draw: occlusion is off or the last cull was Cull(frustum)
+        bool CullOccluded(GLuint framebuffer, int width, int height);
+        //draws what the last Cull() / CullOccluded() kept
+        void Draw();
+
+        //reads the instance counts back, waits for the GPU, for tests and benchmarks only
+        std::size_t CountVisible() const;
+        //reads the counters of the last frame back, waits for the GPU, for tests and benchmarks only
+        OcclusionStats ReadOcclusionStats() const;
+
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        //std430 layouts, see the shader in GpuCuller.cpp
+        struct GpuObject {
+            float model[16];
+            uint32_t batch, pad[3];
+        };
+        struct GpuBatch {
+            float dequantization[16];
+            float boundsMin[4], boundsMax[4];
+            uint32_t command, pad[3];
+        };
+        struct GpuCommand {
+            GLuint count, instanceCount, firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        struct Batch {
+            Mesh* mesh;
+            GLuint program, texture;
+            uint32_t firstCommand, commandCount;
+        };
+
+        void freeBuffers();
+        void dispatch(const Frustum& frustum, int phase);
+        void buildPyramid(GLuint framebuffer, int width, int height);
+
+        static const GLuint kInstanceAttribute = 3;
+        static const GLuint kWorkGroupSize = 64;
+        static const GLuint kPyramidGroupSize = 8;
+        static const GLuint kPyramidUnit = 1;           //texture unit of the depth copy / pyramid, 0 is the materials'
+
+        Options options_;
+        GLuint program_ = 0, pyramidProgram_ = 0;
+        GLint planesLocation_ = -1, countLocation_ = -1, phaseLocation_ = -1, commandOffsetLocation_ = -1;
+        GLint viewProjectionLocation_ = -1, screenSizeLocation_ = -1, levelsLocation_ = -1, pyramidLocation_ = -1;
+        GLint fromDepthLocation_ = -1, depthLocation_ = -1, sourceSizeLocation_ = -1, targetSizeLocation_ = -1;
+        GLuint objects_ = 0, batchBuffer_ = 0, commands_ = 0, commandTemplate_ = 0, instances_ = 0;
+        GLuint visibility_ = 0, counters_ = 0;          //occlusion only: visible last frame per object, occluded / triangles
+        GLuint depthTexture_ = 0, pyramid_ = 0;
+        int pyramidWidth_ = 0, pyramidHeight_ = 0;      //of the framebuffer the pyramid was made for
+        std::vector<int> levelSizes_;                   //width, height per level
+        std::size_t objectCount_ = 0;
+        std::vector<Batch> batches_;
+        std::size_t commandCount_ = 0;                  //per phase, the buffers hold two sets
+        std::size_t drawOffset_ = 0;                    //first command of the phase Draw() issues
+        Mat4 viewProjection_;
+        bool secondPhasePending_ = false;
+        Stats stats_;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+/*
+Offscreen OpenGL context for machines without a display (build farm, batch jobs).
+Uses EGL with the Mesa surfaceless platform when available, so no X server or GPU is needed,
+with LIBGL_ALWAYS_SOFTWARE=1 the context runs on llvmpipe.
+Nothing is presented, render into a Framebuffer and read the pixels back instead.
+*/
+class HeadlessContext {
+    public:
+        HeadlessContext() = default;
+        ~HeadlessContext();
+
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+        //creates a core profile context of the given version, makes it current and loads GLAD
+        bool Create(int major = 3, int minor = 3);
+        void Destroy();
+
+    private:
+        //EGL handles are opaque pointers, kept as void* so egl.h (and X11 through it) stays out of this header
+        void* display_ = nullptr;
+        void* context_ = nullptr;
+        void* surface_ = nullptr;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+A fixed set of worker threads for the data parallel loops of the culling and transform code.
+
+    JobPool pool;
+    pool.Create(0);
+    ...
+    pool.Run(bands, [&](std::size_t band) { fillBand(band); });
+    pool.Filter(objects.size(), 4096, [&](std::size_t begin, std::size_t end, uint32_t* out) {
+        std::size_t written = 0;
+        for (std::size_t i = begin; i < end; ++i) { out[written] = (uint32_t)i; written += keep(i); }
+        return written;
+    }, visible);
+
+Run() hands job(0..count-1) to the calling thread and the workers, whoever is free takes the next index, and returns
+once every job is done; the caller always works too, so a pool without workers (or a single job) runs inline.
+Filter() cuts [0, total) into chunks that each write what they keep at the start of their own range of the output,
+then packs the chunks front to back, so the result is in index order whatever thread finished first and nothing is
+locked. One Run() / Filter() at a time, from one thread.
+*/
+class JobPool {
+    public:
+        JobPool() = default;
+        ~JobPool();
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        //`threads` workers besides the calling thread, 0 or less = one per hardware thread but the caller's
+        bool Create(int threads);
+        void Destroy();
+
+        //runs job(0..count-1), returns the threads that took part, the caller included
+        int Run(std::size_t count, const std::function<void(std::size_t)>& job);
+        //chunk(begin, end, out) writes the indices it keeps to out and returns how many, `out` ends up holding all of
+        //them in order; returns the threads that took part
+        int Filter(std::size_t total, std::size_t chunkSize, const std::function<std::size_t(std::size_t, std::size_t, uint32_t*)>& chunk,
+                   std::vector<uint32_t>& out);
+
+        //workers, the calling thread not counted
+        int Workers() const { return (int)workers_.size(); }
+
+    private:
+        void drain();
+        void work();
+
+        std::vector<std::size_t> chunkKept_;
+
+        //shared with the workers
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable wake_, done_;
+        const std::function<void(std::size_t)>* job_ = nullptr;
+        std::size_t jobCount_ = 0;
+        std::atomic<std::size_t> nextJob_{ 0 };
+        std::size_t busy_ = 0;
+        uint64_t generation_ = 0;
+        bool stopping_ = false;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+Read-only view of a whole file. mmap'ed on POSIX, so opening costs nothing and pages come in as they are touched
+(sequential read-ahead is requested), read into memory in one go where there is no mmap (Windows for now).
+Data() stays valid until Close() or destruction.
+*/
+class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        //false for missing or empty files
+        bool Open(const std::string& path);
+        void Close();
+
+        const unsigned char* Data() const { return data_; }
+        std::size_t Size() const { return size_; }
+        bool IsOpen() const { return data_ != nullptr; }
+
+    private:
+        const unsigned char* data_ = nullptr;
+        std::size_t size_ = 0;
+};
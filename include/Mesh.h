@@ -1,16 +1,154 @@
 #pragma once
 
 #include <glad/glad.h>
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
+#include <cstdint>
 #include <vector>
 
+class MeshFile;
+
+//a range of the index buffer drawing the mesh at one level of detail, 0 is the full mesh
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;            //object space deviation from LOD 0
+};
+
+//vertex streams and indices that are already in their GPU form (binary cache, glTF buffers), uploaded as they are;
+//the pointers only have to stay valid until the Mesh is constructed, null ones only allocate the buffers
+//(AssetStreamer fills them later through VertexBuffer() / ElementBuffer())
+struct PackedMeshData {
+    VertexLayout layout;
+    const void* streams[VertexLayout::kMaxStreams] = {};
+    std::size_t streamBytes[VertexLayout::kMaxStreams] = {};
+    std::size_t vertexCount = 0;
+    const void* indices = nullptr;
+    std::size_t indexBytes = 0;
+    std::size_t indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;     //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    float boundsMin[3] = {}, boundsMax[3] = {};
+    PositionQuantization dequantization;
+    QuantizationError errors;
+    std::vector<MeshLod> lods;              //empty = a single LOD over all indices
+    std::vector<MeshOptimizer::Meshlet> meshlets;   //empty = not clustered
+};
+
+/*
+Indexed triangle mesh. Vertices come in as floats (pos + color, 6 floats, unless the VertexLayout says otherwise)
+and are stored on the GPU in the layout's formats, one VBO per stream.
+The soup constructors take a triangle soup, merge identical vertices into an index buffer (EBO)
+and pick 16 bit indices when every vertex fits, 32 bit otherwise.
+With `optimize` the triangles are then reordered for the post-transform cache and for overdraw,
+and the vertices for fetch locality; CacheStatsBefore/After report the simulated ACMR/ATVR.
+
+With a quantized layout (VertexLayout::Quantized) positions are stored relative to the mesh bounds,
+Dequantization() maps them back and has to be applied before the model matrix (the Renderer does that
+for Object3Ds), QuantizationErrors() reports the worst error introduced per attribute kind.
+
+The soup is only read, never copied; already indexed data can be moved in and is optimized in place.
+Without `keepCpuCopy` the vertices and indices are released once they are uploaded, the mesh then only lives in VRAM
+(HostBytes() drops to 0). Meshes own GL objects, so they can be moved but not copied, anything holding a Mesh*
+(Object3D, the Renderer's batches) has to be updated after a move.
+
+Meshes can be saved to and loaded from the binary cache (MeshFile), loading skips dedup, optimization and packing,
+the mapped streams go to the GPU as they are and no CPU copy is kept. PackedMeshData does the same for any other
+source whose buffers are already in a VertexLayout (glTF, see GltfLoader).
+
+GenerateLods() simplifies the CPU copy (MeshOptimizer::Simplify) into a chain of coarser index lists that share the
+vertices, appended behind LOD 0 in the same element buffer; Lods() has their ranges and object space errors, the
+binary cache stores them along with the mesh. Draw() and IndexCount() are always LOD 0, the Renderer picks a level per
+Object3D from its screen space error (Renderer::SetLodSelection).
+
+BuildMeshlets() reorders the triangles of LOD 0 into meshlets (MeshOptimizer::BuildMeshlets), clusters of ~64 vertices
+with bounds and a normal cone that MeshletCuller culls and draws range by range; they are cached with the mesh too.
+*/
 class Mesh {
-    public: 
-        Mesh(std::vector<float> vertices, std::size_t size);
+    public:
+        //`size` is the size of `vertices` in bytes, as for glBufferData
+        Mesh(const float* vertices, std::size_t size, bool optimize = true, bool keepCpuCopy = true,
+             const VertexLayout& layout = VertexLayout::PositionColor());
+        Mesh(const std::vector<float>& vertices, std::size_t size, bool optimize = true, bool keepCpuCopy = true,
+             const VertexLayout& layout = VertexLayout::PositionColor());
+
+        //already deduplicated vertices + indices, taken over without a copy
+        Mesh(std::vector<float>&& vertices, std::vector<unsigned int>&& indices, bool optimize = true, bool keepCpuCopy = true,
+             const VertexLayout& layout = VertexLayout::PositionColor());
+
+        //uploads an open binary cache file straight from its mapping, `file` can be closed afterwards
+        explicit Mesh(const MeshFile& file);
+        explicit Mesh(const PackedMeshData& data);
+
         ~Mesh();
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+        Mesh(Mesh&& other) noexcept;
+        Mesh& operator=(Mesh&& other) noexcept;
+
+        struct LodOptions {
+            int maxLods = 4;                    //LOD 0 included
+            float ratio = 0.5f;                 //target triangles of each level relative to the one before
+            float minReduction = 0.1f;          //the chain ends at the first level that drops fewer triangles than this share
+            MeshOptimizer::SimplifyOptions simplify;    //its maxError bounds every level against LOD 0
+        };
+
+        //replaces any earlier chain, needs the CPU copy (0 and an ERROR line without one); returns the levels built
+        int GenerateLods(const LodOptions& options);
+        int GenerateLods() { return GenerateLods(LodOptions()); }
+
+        //needs the CPU copy (0 and an ERROR line without one), LOD 0 keeps its triangles in a new order, other
+        //levels are untouched; returns the number of meshlets
+        std::size_t BuildMeshlets(std::size_t maxVertices = 64, std::size_t maxTriangles = 124);
+
         void Draw();
 
+        GLuint VertexArray() const { return VAO_; }
+        GLsizei IndexCount() const { return indexCount_; }     //LOD 0
+        std::size_t IndexBufferCount() const { return indexBufferCount_; }     //every LOD
+        GLenum IndexType() const { return indexType_; }     //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        GLuint VertexBuffer(int stream) const { return VBOs_[stream]; }
+        GLuint ElementBuffer() const { return EBO_; }
+        std::size_t VertexCount() const { return vertexCount_; }
+        const VertexLayout& Layout() const { return layout_; }
+        const float* BoundsMin() const { return boundsMin_; }
+        const float* BoundsMax() const { return boundsMax_; }
+        const PositionQuantization& Dequantization() const { return positionQuantization_; }
+        const QuantizationError& QuantizationErrors() const { return quantizationError_; }
+        std::size_t FloatsPerVertex() const { return layout_.SourceFloats(); }   //of the CPU copy
+        const std::vector<MeshLod>& Lods() const { return lods_; }
+        const std::vector<MeshOptimizer::Meshlet>& Meshlets() const { return meshlets_; }
+        const MeshOptimizer::VertexCacheStats& CacheStatsBefore() const { return cacheStatsBefore_; }
+        const MeshOptimizer::VertexCacheStats& CacheStatsAfter() const { return cacheStatsAfter_; }
+
+        //float source vertices, empty once the CPU copy has been dropped
+        bool HasCpuCopy() const { return !vertices.empty(); }
+        const std::vector<float>& Vertices() const { return vertices; }
+        const std::vector<unsigned int>& Indices() const { return indices; }
+
+        //system memory still held by the mesh, and what was uploaded to the VBO + EBO
+        std::size_t HostBytes() const { return vertices.capacity() * sizeof(float) + indices.capacity() * sizeof(unsigned int); }
+        std::size_t DeviceBytes() const { return vertexBytes_ + indexBytes_; }
+
     private:
-        unsigned int VAO_, VBO_;
+        void build(bool optimize, bool keepCpuCopy);
+        void upload(const PackedMeshData& data);
+        void uploadIndices(bool narrowInPlace);
+        void release();
+
+        unsigned int VAO_ = 0, EBO_ = 0;
+        unsigned int VBOs_[VertexLayout::kMaxStreams] = {};
+        VertexLayout layout_;
+        GLsizei indexCount_ = 0;
+        std::size_t indexBufferCount_ = 0;
+        GLenum indexType_ = GL_UNSIGNED_INT;
+        std::size_t vertexCount_ = 0;
+        std::size_t vertexBytes_ = 0, indexBytes_ = 0;
+        float boundsMin_[3] = {}, boundsMax_[3] = {};
+        PositionQuantization positionQuantization_;
+        QuantizationError quantizationError_;
+        std::vector<MeshLod> lods_;
+        std::vector<MeshOptimizer::Meshlet> meshlets_;
+        MeshOptimizer::VertexCacheStats cacheStatsBefore_, cacheStatsAfter_;
         std::vector<float> vertices;
         std::vector<unsigned int> indices;
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "VertexLayout.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Mesh;
+struct MeshLod;
+struct PackedMeshData;
+namespace MeshOptimizer { struct Meshlet; }
+
+/*
+Binary mesh container (.mmsh), the GPU ready form of a Mesh, loaded without parsing.
+
+    MeshFileHeader          fixed size: counts, vertex layout, bounds, dequantization, error bounds, section table
+    section blobs           each starts on a 64 byte boundary: vertex stream 0..3, indices, LOD table, meshlets
+
+Blobs hold exactly what goes into the VBOs / EBO (packed formats, 16 or 32 bit indices), so loading maps the
+file and hands the section pointers straight to glBufferData/glBufferStorage, the page cache is the only copy.
+Bump kMeshFileVersion whenever the header changes, old files are then rejected and get rebuilt.
+All values are little endian, the layout of the host (the cache is a build artifact, not an interchange format).
+*/
+static const uint32_t kMeshFileVersion = 1;
+static const int kMeshFileMaxSections = 16;
+
+enum class MeshFileSection : uint32_t {
+    Stream0 = 0,        //Stream0 + n = vertex stream n
+    Indices = 4,
+    Lods = 5,           //MeshLod[]
+    Meshlets = 6,       //MeshOptimizer::Meshlet[], optional
+};
+
+struct MeshFileSectionEntry {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;    //from the start of the file
+    uint64_t bytes;
+};
+
+struct MeshFileAttribute {
+    uint8_t semantic, format, components, normalized, stream;
+    uint8_t reserved[3];
+};
+
+struct MeshFileHeader {
+    char magic[4];                  //"MMSH"
+    uint32_t version;
+    uint64_t fileBytes;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t indexType;             //GL_UNSIGNED_SHORT / GL_UNSIGNED_INT
+    uint32_t attributeCount;
+    MeshFileAttribute attributes[VertexLayout::kMaxAttributes];
+    float boundsMin[3], boundsMax[3];
+    float dequantizationOffset[3], dequantizationScale[3];
+    uint32_t quantized;
+    float errors[4];                //QuantizationError: position, normal, color, texCoord
+    uint32_t sectionCount;
+    MeshFileSectionEntry sections[kMeshFileMaxSections];
+};
+
+//a read-only view of a .mmsh file, memory mapped, pointers stay valid until Close()
+class MeshFile {
+    public:
+        MeshFile() = default;
+        ~MeshFile();
+        MeshFile(const MeshFile&) = delete;
+        MeshFile& operator=(const MeshFile&) = delete;
+
+        //maps and validates the file, false (and nothing mapped) if it is missing, truncated or from another version
+        bool Open(const std::string& path);
+        void Close();
+
+        //writes what the GPU holds for `mesh` (read back from its buffers), through a temporary file + rename
+        static bool Write(const std::string& path, const Mesh& mesh);
+
+        const MeshFileHeader& Header() const { return *header_; }
+        const VertexLayout& Layout() const { return layout_; }
+        PositionQuantization Dequantization() const;
+        QuantizationError Errors() const;
+
+        //null if the section is not in the file
+        const void* Section(MeshFileSection type, std::size_t* bytes = nullptr) const;
+        const void* Stream(int stream, std::size_t* bytes = nullptr) const;
+        const MeshLod* Lods(std::size_t* count) const;
+        const MeshOptimizer::Meshlet* Meshlets(std::size_t* count) const;
+
+        //everything Mesh needs, pointing into the mapping (no GL, so any thread can do it)
+        void PackedData(PackedMeshData& data) const;
+
+        std::size_t FileBytes() const { return size_; }
+        bool IsOpen() const { return header_ != nullptr; }
+
+    private:
+        bool validate();
+
+        MappedFile file_;
+        const unsigned char* data_ = nullptr;
+        std::size_t size_ = 0;
+        const MeshFileHeader* header_ = nullptr;
+        VertexLayout layout_;
+};
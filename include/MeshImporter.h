@@ -0,0 +1,56 @@
+#pragma once
+
+#include "VertexLayout.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+OBJ and PLY (ascii, binary little / big endian) import into Mesh-ready data.
+The file is mapped (MappedFile) and cut into chunks at line boundaries that are parsed in parallel, numbers go
+through std::from_chars, so nothing is copied or allocated per token. The chunks are then stitched together:
+OBJ corners (position / uv / normal index triples) are deduplicated into unique vertices, PLY vertices are unique already.
+
+    MeshImporter::Result result;
+    if (MeshImporter::Load("scan.ply", result)) {
+        Mesh mesh(std::move(result.vertices), std::move(result.indices), true, false, result.layout);
+    }
+
+Vertices are interleaved floats in result.layout's source order: Position, then Normal, TexCoord0 and Color
+when the file has them (all Float, pass VertexLayout::Quantized(result.layout) to the Mesh to pack them).
+Polygons are triangulated as fans, OBJ negative (relative) indices are resolved, groups / materials / lines are skipped.
+*/
+namespace MeshImporter {
+
+    struct Options {
+        int threads = 0;                    //0 = one per hardware thread
+        std::size_t minChunkBytes = 1 << 20;    //files are not split finer than this, small files are parsed on the calling thread
+    };
+
+    struct Stats {
+        std::size_t fileBytes = 0;
+        std::size_t vertices = 0;           //unique, after deduplication
+        std::size_t triangles = 0;
+        int threads = 0;                    //threads actually used
+        double parseMs = 0.0;               //chunked parallel part
+        double mergeMs = 0.0;               //stitching, deduplication and interleaving
+        double totalMs = 0.0;               //open to result, mapping included
+
+        double MegabytesPerSecond() const { return totalMs > 0.0 ? fileBytes / (totalMs * 1000.0) : 0.0; }
+    };
+
+    struct Result {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        VertexLayout layout;
+        Stats stats;
+    };
+
+    //picks the format from the extension (.obj / .ply, any case); false and an ERROR line on failure
+    bool Load(const std::string& path, Result& result, const Options& options = Options());
+
+    //parse files that are already in memory, `name` only shows up in error messages
+    bool ParseOBJ(const char* data, std::size_t size, Result& result, const Options& options = Options(), const std::string& name = "obj");
+    bool ParsePLY(const char* data, std::size_t size, Result& result, const Options& options = Options(), const std::string& name = "ply");
+
+}
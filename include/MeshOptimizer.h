@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+CPU-side geometry passes run when a Mesh is built.
+Vertices are interleaved float records of `stride` floats (pos + color is 6), the position is always the first 3 floats.
+Indices are triangle lists.
+
+Typical order: DeduplicateVertices -> OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch,
+AnalyzeVertexCache before and after shows what the passes bought.
+Simplify builds the coarser index lists of a LOD chain over the same vertices (see Mesh::GenerateLods),
+BuildMeshlets cuts a mesh into clusters that can be culled one by one (see Mesh::BuildMeshlets, MeshletCuller).
+*/
+namespace MeshOptimizer {
+
+    //merges bit-identical vertex records of a triangle soup into a unique vertex list + index list,
+    //first occurrence wins so the vertex order stays stable; returns the number of unique vertices
+    std::size_t DeduplicateVertices(const float* vertices, std::size_t vertexCount, std::size_t stride,
+                                    std::vector<float>& uniqueVertices, std::vector<unsigned int>& indices);
+
+    //post-transform cache behaviour of an index buffer, simulated as a FIFO of `cacheSize` entries
+    struct VertexCacheStats {
+        std::size_t transformedVertices = 0;    //cache misses
+        float acmr = 0.0f;                      //average cache miss ratio: misses / triangles, 0.5 is ideal for big grids, 3 is the worst
+        float atvr = 0.0f;                      //average transformed vertex ratio: misses / vertices, 1 is ideal
+    };
+    VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, std::size_t vertexCount, unsigned int cacheSize = 16);
+
+    //reorders triangles for the post-transform cache (Tipsify, Sander et al. 2007), linear time;
+    //`clusters` (optional) receives the first triangle of every run that started from a dead end, OptimizeOverdraw uses them
+    void OptimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount,
+                             unsigned int cacheSize = 16, std::vector<std::size_t>* clusters = nullptr);
+
+    //reorders the clusters of a cache optimized index buffer so outward facing ones are drawn first, which cuts overdraw
+    //from most viewpoints; clusters are split further where the cache efficiency stays within `threshold` (1.05 = 5% worse ACMR)
+    void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, std::size_t stride,
+                          const std::vector<std::size_t>& clusters, float threshold = 1.05f, unsigned int cacheSize = 16);
+
+    //reorders vertices by first use in the index buffer so fetches walk memory linearly, drops unreferenced vertices;
+    //rewrites the indices and returns the new vertex count
+    std::size_t OptimizeVertexFetch(std::vector<float>& vertices, std::size_t stride, std::vector<unsigned int>& indices);
+
+    struct SimplifyOptions {
+        float maxError = FLT_MAX;               //object space distance, no collapse that would go beyond it is made
+        bool lockBorder = true;                 //open edges stay put, otherwise border vertices only slide along the border
+        std::vector<float> attributeWeights;    //per float after the position, scales its squared difference into squared distance, missing = 0
+    };
+
+    //quadric error edge collapse (Garland & Heckbert 1997) down to `targetIndexCount` indices or `maxError`, whichever
+    //comes first; vertices only ever collapse onto one of their neighbours, so `vertices` stay untouched and the result
+    //indexes them directly. Vertices sharing their position with another one (attribute seams) never move, neither do
+    //non-manifold ones. Collapses that would flip a triangle are skipped.
+    //Writes the remaining triangles to `destination` and returns the largest error of a collapse made
+    float Simplify(const std::vector<float>& vertices, std::size_t stride, const std::vector<unsigned int>& indices,
+                   std::size_t targetIndexCount, const SimplifyOptions& options, std::vector<unsigned int>& destination);
+
+    //a cluster of triangles, a contiguous run of the index buffer with object space bounds; stored as is in the binary cache
+    struct Meshlet {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t vertexCount;           //unique vertices it references
+        float center[3];
+        float radius;
+        float coneAxis[3];              //average facing of its (counter clockwise) triangles
+        float coneCutoff;               //sine of the cone's half angle, 1 = spread too wide to ever face away as a whole
+    };
+
+    //reorders the triangles of `indices` into meshlets of at most `maxVertices` unique vertices and `maxTriangles`
+    //triangles and fills `meshlets` with their ranges, bounding spheres and normal cones. A meshlet grows from the
+    //first triangle not taken yet through the neighbours of its vertices, fewest new vertices first, then nearest to
+    //its center, so it stays compact; it ends when full or when no neighbour fits
+    void BuildMeshlets(std::vector<unsigned int>& indices, const std::vector<float>& vertices, std::size_t stride,
+                       std::vector<Meshlet>& meshlets, std::size_t maxVertices = 64, std::size_t maxTriangles = 124);
+
+}
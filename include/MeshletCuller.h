@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "SimdMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+class Object3D;
+
+/*
+Cluster culling for dense meshes, objects whose mesh was cut into meshlets (Mesh::BuildMeshlets) are culled and
+drawn meshlet by meshlet instead of as a whole.
+
+    MeshletCuller meshlets;
+    meshlets.Create();
+    ...every frame:
+    meshlets.BeginFrame(Frustum::FromMatrix(projection * view), cameraPosition);
+    for (const Object3D& statue : statues) meshlets.Submit(statue);
+    meshlets.Draw();
+
+Submit() drops the meshlets whose bounding sphere is outside the frustum and those whose normal cone points away from
+the camera, where every triangle would have been back face culled anyway. The cone test runs in object space, so
+it is skipped for objects that are not scaled uniformly. A mesh without meshlets is kept whole.
+Draw() issues the ranges that are left with each object's matrix as instance attribute 3-6, like the Renderer's
+batches, so the same instanced programs work. With ARB_multi_draw_indirect every run of objects sharing mesh and
+material is one glMultiDrawElementsIndirect whose commands pick their matrix through baseInstance, on plain 3.3
+every object is one glMultiDrawElements over its ranges. A quantized mesh's dequantization is folded into the matrix.
+*/
+class MeshletCuller {
+    public:
+        struct Options {
+            bool indirect = true;               //multi draw indirect where the context has it
+            bool coneCulling = true;
+        };
+
+        struct Stats {
+            std::size_t objects = 0;
+            std::size_t meshlets = 0;           //tested
+            std::size_t frustumCulled = 0;
+            std::size_t backfacing = 0;         //dropped by their normal cone
+            std::size_t ranges = 0;             //index ranges kept, whole meshes included
+            std::size_t triangles = 0;          //in the kept ranges
+            std::size_t drawCalls = 0;          //of the last Draw()
+            bool indirect = false;
+            double cullMs = 0.0;                //every Submit() since BeginFrame()
+        };
+
+        MeshletCuller() = default;
+        ~MeshletCuller();
+        MeshletCuller(const MeshletCuller&) = delete;
+        MeshletCuller& operator=(const MeshletCuller&) = delete;
+
+        //whether the context can take the indirect path (4.3 multi draw indirect), Create() falls back to 3.3 otherwise
+        static bool SupportsIndirect();
+
+        //creates the instance (and command) buffer, needs the context
+        bool Create(const Options& options);
+        bool Create() { return Create(Options()); }
+        void Destroy();
+
+        //clears what was submitted, meshlets are tested against `frustum` and faced from `cameraPosition` (world space)
+        void BeginFrame(const Frustum& frustum, const Vec3& cameraPosition);
+        //culls the object's meshlets, returns how many ranges are kept
+        std::size_t Submit(const Object3D& object);
+        //draws everything kept since BeginFrame()
+        void Draw();
+
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        static const GLuint kInstanceAttribute = 3;     //mat4 takes 4 locations, 3-6
+
+        //DrawElementsIndirectCommand
+        struct Command {
+            GLuint count, instanceCount, firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+        //one submitted object with ranges left, its matrix is the entry's index in `matrices_`
+        struct Entry {
+            Mesh* mesh;
+            GLuint program, texture;
+            std::size_t firstRange, rangeCount;
+        };
+
+        Options options_;
+        bool indirect_ = false;
+        GLuint instances_ = 0, commands_ = 0;
+        Frustum frustum_;
+        Vec3 camera_;
+        std::vector<Entry> entries_;
+        std::vector<float> matrices_;
+        std::vector<GLsizei> counts_;
+        std::vector<const void*> offsets_;
+        std::vector<Command> commandData_;
+        Stats stats_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+
+class Mesh;
+
+/*
+Something placed in the scene: a shared Mesh, a material (program + optional texture) and a model matrix.
+The Mesh is not owned, any number of Object3Ds can point at the same one and it must outlive them.
+Renderer::Submit(Object3D) batches every object sharing mesh + material into one glDrawElementsInstanced,
+so the program has to read the model matrix per instance as `layout(location = 3) in mat4`
+(see shaders/instanced_vertex_shader.glsl).
+*/
+class Object3D {
+    public:
+        Object3D(Mesh* mesh, GLuint program, GLuint texture = 0);
+
+        //column major, like glUniformMatrix4fv with transpose = GL_FALSE
+        void SetTransform(const float matrix[16]);
+        const float* Transform() const { return transform_; }
+
+        //shortcuts that only touch their part of the matrix
+        void SetPosition(float x, float y, float z);
+        void SetScale(float x, float y, float z);
+
+        Mesh* GetMesh() const { return mesh_; }
+        GLuint Program() const { return program_; }
+        GLuint Texture() const { return texture_; }
+
+    private:
+        Mesh* mesh_;
+        GLuint program_;
+        GLuint texture_;
+        float transform_[16];
+};
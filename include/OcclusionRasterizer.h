@@ -0,0 +1,139 @@
+#pragma once
+
+#include "SimdMath.h"
+#include "JobPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class Mesh;
+class Object3D;
+
+/*
+Occlusion culling on the CPU: a few designated occluders are rasterized into a small depth buffer (256x128 by
+default) and object bounds are tested against it before anything is submitted. Needs no GPU feature at all, so it
+works on 3.3 class hardware and headless machines where GpuCuller's Hi-Z path is unavailable.
+
+    OcclusionRasterizer occlusion;
+    occlusion.Create();
+    ...every frame:
+    occlusion.BeginFrame(projection * view);
+    for (const Object3D& wall : walls) occlusion.AddOccluder(wall);
+    occlusion.Rasterize();
+    for (uint32_t index : occlusion.Cull(objects, culler.Cull(frustum, objects))) renderer.Submit(objects[index]);
+
+Occluders are read from their mesh's CPU copy (Mesh::Vertices() / Indices(), positions are the first three floats of
+every vertex), so they should be low poly stand-ins that keep one, a mesh without a CPU copy is refused.
+Rasterize() runs in three steps, each spread over the calling thread and the JobPool's workers: the occluders' vertices go
+to screen space, the triangles are set up (edge and depth planes, back faces and triangles crossing the near plane
+dropped, which only ever loses occlusion), then every band of Options::tileSize rows fills its rows from the
+triangles touching it, 4 or 8 pixels at a time (SimdMath's wide helpers), keeping the nearest depth. Bands never share
+pixels, so nothing is locked. Each band finally stores the farthest depth of each of its tiles.
+
+Testing a box projects its corners, takes the nearest depth and the pixel rect it covers and walks the tiles of that
+rect: a tile whose farthest depth is in front of the box hides its part, any other tile is checked pixel by pixel.
+The object is occluded if no pixel of the rect is behind or at its nearest point. Boxes crossing the near plane are
+always visible. Depth is window depth (0 near, 1 far) of GL clip space, like the GPU's.
+*/
+class OcclusionRasterizer {
+    public:
+        struct Options {
+            int width = 256;
+            int height = 128;
+            int tileSize = 8;                   //tiles are tileSize x tileSize pixels, a band is a row of tiles
+            int threads = 0;                    //workers besides the calling thread, 0 = one per hardware thread but the caller's
+            std::size_t setupChunkSize = 4096;  //triangles per setup job
+            bool backfaceCulling = true;        //occluders are closed meshes, counter clockwise front faces
+            std::size_t testChunkSize = 1024;   //objects per job in Cull()
+        };
+
+        struct Stats {
+            std::size_t occluders = 0;
+            std::size_t triangles = 0;          //occluder triangles submitted
+            std::size_t rasterized = 0;         //left after back face, near plane and off screen rejection
+            std::size_t tested = 0;
+            std::size_t occluded = 0;
+            int threads = 0;                    //threads that took part, the caller included
+            double transformMs = 0.0;
+            double setupMs = 0.0;
+            double rasterMs = 0.0;              //bands filled and tile depths updated
+            double testMs = 0.0;                //last Cull()
+        };
+
+        OcclusionRasterizer() = default;
+        ~OcclusionRasterizer();
+        OcclusionRasterizer(const OcclusionRasterizer&) = delete;
+        OcclusionRasterizer& operator=(const OcclusionRasterizer&) = delete;
+
+        //width and height have to be multiples of tileSize, tileSize a multiple of 8, false and an ERROR line otherwise
+        bool Create(const Options& options);
+        bool Create() { return Create(Options()); }
+        void Destroy();
+
+        //clears the depth buffer and the occluder list, boxes are projected with `viewProjection`
+        void BeginFrame(const Mat4& viewProjection);
+
+        //queues the object's mesh with its matrix, false if the mesh has no CPU copy
+        bool AddOccluder(const Object3D& object);
+        //any indexed triangle list, `positions` strided by `stride` floats, both have to stay valid until Rasterize() returns
+        void AddOccluder(const float* positions, std::size_t stride, std::size_t vertexCount, const unsigned int* indices,
+                         std::size_t indexCount, const Mat4& model);
+
+        //draws every queued occluder
+        void Rasterize();
+
+        //world space box, false if the rasterized occluders hide all of it
+        bool IsVisible(const AABB& box) const;
+        //the entries of `candidates` (indices into `objects`, e.g. FrustumCuller's result) whose world bounds are visible,
+        //in order, valid until the next call
+        const std::vector<uint32_t>& Cull(const std::vector<Object3D>& objects, const std::vector<uint32_t>& candidates);
+
+        //window depth per pixel, bottom row first, `Width() * Height()` floats
+        const float* Depth() const { return depth_.data(); }
+        int Width() const { return options_.width; }
+        int Height() const { return options_.height; }
+
+        const std::vector<uint32_t>& Visible() const { return visible_; }
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        struct Occluder {
+            const float* positions;
+            std::size_t stride, vertexCount;
+            const unsigned int* indices;
+            std::size_t indexCount;
+            Mat4 model;
+            std::size_t firstVertex;        //into the screen space vertices
+            std::size_t firstTriangle;
+        };
+        //a run of one occluder's triangles set up by one job
+        struct SetupJob {
+            std::size_t occluder, begin, end;
+        };
+
+        //edge functions e = a * x + b * y + c, positive inside, depth = a * x + b * y + c, at pixel centers
+        struct Triangle {
+            float edgeA[3], edgeB[3], edgeC[3];
+            float depthA, depthB, depthC;
+            int minX, maxX, minY, maxY;     //inclusive pixel bounds, minY > maxY = rejected
+        };
+
+        void transform(const Occluder& occluder);
+        void setup(const SetupJob& job);
+        void fillBand(int band);
+
+        //runs job(0..count-1) through the pool, records the threads that took part
+        void run(std::size_t count, const std::function<void(std::size_t)>& job);
+
+        Options options_;
+        JobPool pool_;
+        Mat4 viewProjection_;
+        std::vector<Occluder> occluders_;
+        std::vector<SetupJob> setupJobs_;
+        std::vector<float> screenX_, screenY_, screenZ_;    //pixels and window depth, depth < 0 = in front of the near plane
+        std::vector<Triangle> triangles_;
+        std::vector<float> depth_, tileDepth_;      //nearest per pixel, farthest per tile
+        std::vector<uint32_t> visible_;
+        Stats stats_;
+};
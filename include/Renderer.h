@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "RingBuffer.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Mesh;
+class Object3D;
+
+/*
+Draw command queue.
+Everything drawn in a frame is submitted as a DrawCommand, Flush() sorts the queue by a packed 64 bit key
+and issues it, the binds go through GLState, which skips glUseProgram/glBindVertexArray/glBindTexture when already bound.
+
+Key layout, most significant first:
+    opaque:       pass(4) | program(12) | texture(12) | VAO(12) | depth(24)  -> state changes grouped, front to back inside a group
+    transparent:  pass(4) | inverted depth(24) | program(12) | texture(12) | VAO(12)  -> back to front, state only breaks ties
+Program/texture/VAO ids are remapped to dense 12 bit slots so any GL name fits.
+
+Object3Ds are not queued one by one: all objects sharing mesh + material (+ pass) collect their model matrices
+in one batch, Flush() writes every batch into a triple buffered RingBuffer and queues each batch as one
+instanced command (glDrawElementsInstanced), the matrices feed vertex attributes 3-6 with divisor 1.
+A quantized mesh's dequantization is folded into each of its instance matrices.
+With LOD selection on, each object draws the coarsest level of its mesh (Mesh::GenerateLods) whose error stays
+below a pixel budget on screen, objects of the same mesh at different levels become separate batches.
+*/
+class Renderer {
+    public:
+        enum Pass : uint8_t {
+            Opaque = 0,
+            Transparent = 1,
+            Overlay = 2,
+        };
+
+        struct DrawCommand {
+            Pass pass = Opaque;
+            GLuint program = 0;
+            GLuint VAO = 0;
+            GLuint texture = 0;             //bound to unit 0 as GL_TEXTURE_2D, 0 = no material texture
+            float depth = 0.0f;             //0 = near, 1 = far
+            GLenum mode = GL_TRIANGLES;
+            GLsizei count = 0;              //index count, or vertex count when indexType is 0
+            GLenum indexType = 0;           //GL_UNSIGNED_SHORT / GL_UNSIGNED_INT, 0 = glDrawArrays
+            std::size_t first = 0;          //byte offset into the EBO, or first vertex for glDrawArrays
+            GLsizei instanceCount = 0;      //0 = not instanced
+            std::size_t instanceOffset = 0; //byte offset of the first model matrix in the instance buffer
+        };
+
+        struct Stats {
+            std::size_t commands = 0;
+            std::size_t drawCalls = 0;
+            std::size_t instances = 0, instancedDraws = 0;
+            std::size_t programBinds = 0, programBindsElided = 0;
+            std::size_t vaoBinds = 0, vaoBindsElided = 0;
+            std::size_t textureBinds = 0, textureBindsElided = 0;
+            std::size_t triangles = 0;          //of the instanced batches, after LOD selection
+            std::size_t reducedInstances = 0;   //objects drawn below LOD 0
+        };
+
+        Renderer() = default;
+        ~Renderer();
+
+        //clears the queue, binds go through GLState so state bound last frame is still known
+        void BeginFrame();
+
+        void Submit(const DrawCommand& command);
+
+        //indexed draw of a whole mesh
+        void Submit(Mesh& mesh, GLuint program, GLuint texture = 0, float depth = 0.0f, Pass pass = Opaque);
+
+        //batched with every other object sharing its mesh and material, instances of a batch are drawn
+        //in submission order, so a transparent batch is only sorted against other commands, not internally
+        void Submit(const Object3D& object, float depth = 0.0f, Pass pass = Opaque);
+
+        //sorts (unless disabled) and issues everything submitted since BeginFrame
+        void Flush();
+
+        //releases the instance ring buffer, needs the context, so call it before the context goes away
+        void Clear();
+
+        //screen space error LOD selection for Object3Ds: a level's object space error, scaled by the object's largest
+        //axis scale and projected at the distance of the nearest point of its bounding sphere, has to stay within
+        //`maxPixelError`; `pixelsPerUnit` is viewport height / (2 * tan(fovY / 2)). Off (always LOD 0) until set
+        void SetLodSelection(const float cameraPosition[3], float pixelsPerUnit, float maxPixelError = 1.0f);
+        void DisableLodSelection() { lodSelection_ = false; }
+
+        //draw in submission order, to measure what the sort buys
+        void SetSorting(bool enabled) { sorting_ = enabled; }
+
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        uint64_t makeKey(const DrawCommand& command);
+        uint32_t slot(std::unordered_map<GLuint, uint32_t>& slots, GLuint name);
+        void sortQueue();
+        void execute(const DrawCommand& command);
+        bool queueBatches();
+        uint32_t selectLod(const Object3D& object) const;
+
+        static const GLuint kInstanceAttribute = 3;     //mat4 takes 4 locations, 3-6
+
+        struct BatchKey {
+            Mesh* mesh;
+            GLuint program, texture;
+            Pass pass;
+            uint32_t lod;
+            bool operator==(const BatchKey& other) const {
+                return mesh == other.mesh && program == other.program && texture == other.texture && pass == other.pass &&
+                       lod == other.lod;
+            }
+        };
+        struct BatchKeyHash {
+            std::size_t operator()(const BatchKey& key) const;
+        };
+        struct Batch {
+            BatchKey key;
+            float depth;                    //nearest instance
+            bool used;                      //anything submitted since BeginFrame
+            std::vector<float> transforms;  //16 floats per instance
+        };
+
+        std::vector<DrawCommand> commands_;
+        std::vector<uint64_t> keys_;
+        std::vector<uint32_t> order_, scratchOrder_;
+        std::vector<uint64_t> scratchKeys_;
+        std::unordered_map<GLuint, uint32_t> programSlots_, textureSlots_, vaoSlots_;
+        std::vector<Batch> batches_;
+        std::unordered_map<BatchKey, std::size_t, BatchKeyHash> batchSlots_;
+        RingBuffer instances_;
+        bool sorting_ = true;
+        bool lodSelection_ = false;
+        float lodCamera_[3] = {};
+        float lodPixelsPerUnit_ = 0.0f, lodMaxPixelError_ = 1.0f;
+        Stats stats_;
+};
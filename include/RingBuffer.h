@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+/*
+Ring allocator for data rewritten every frame (instance matrices, per-frame uniforms, dynamic geometry).
+One GL buffer split into `frames` regions (triple buffered by default), each frame writes into the next region
+while the GPU may still read the previous ones, a fence per region makes BeginFrame wait only if the GPU
+is more than `frames` frames behind.
+
+With ARB_buffer_storage the buffer is mapped once, persistent + coherent, writes go straight to GL memory
+and Flush() does nothing. Without it there is a single region that is orphaned every frame
+(glMapBufferRange with GL_MAP_INVALIDATE_BUFFER_BIT) and unmapped again in Flush(), the driver does the renaming.
+
+Per frame:
+    BeginFrame();
+    Allocation a = Allocate(bytes, alignment); memcpy(a.data, ...);     //as often as needed
+    Flush();                                                           //before the draws that read a.offset
+    ...draws...
+    EndFrame();
+The buffer is only ever bound to GL_COPY_WRITE_BUFFER by the ring itself, bind Buffer() to whatever target the
+draw needs (GL_ARRAY_BUFFER, glBindBufferRange(GL_UNIFORM_BUFFER, ...) with GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT).
+*/
+class RingBuffer {
+    public:
+        struct Allocation {
+            void* data = nullptr;       //null if the frame's region is full
+            GLintptr offset = 0;        //byte offset into Buffer()
+        };
+
+        struct Stats {
+            std::size_t frames = 0;
+            std::size_t bytes = 0;          //allocated over all frames
+            std::size_t overflows = 0;      //allocations that did not fit
+            std::size_t fenceWaits = 0;     //BeginFrame had to block on the GPU
+            double waitMs = 0.0;
+        };
+
+        RingBuffer() = default;
+        ~RingBuffer();
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        //`allowPersistent` = false forces the orphaning path, to compare the two
+        bool Create(std::size_t bytesPerFrame, int frames = 3, bool allowPersistent = true);
+        void Destroy();
+
+        void BeginFrame();
+        //`alignment` doesn't have to be a power of two, e.g. the vertex stride so offset / stride is a valid first vertex
+        Allocation Allocate(std::size_t size, std::size_t alignment = 16);
+        void Flush();
+        void EndFrame();
+
+        GLuint Buffer() const { return buffer_; }
+        bool Persistent() const { return persistent_; }
+        std::size_t FrameCapacity() const { return frameSize_; }
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        GLuint buffer_ = 0;
+        std::size_t frameSize_ = 0;
+        int frames_ = 0;
+        int frame_ = 0;
+        std::size_t head_ = 0;              //bytes used in the current region
+        unsigned char* mapped_ = nullptr;   //persistent: the whole buffer, orphaning: the current mapping
+        std::size_t mappedStart_ = 0;       //orphaning: buffer offset of the current mapping
+        bool persistent_ = false;
+        std::vector<GLsync> fences_;
+        Stats stats_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Owns every shader program, loads GLSL from disk and compiles/links it.
+Linked programs are stored as driver binaries (glGetProgramBinary) in the cache directory,
+keyed by a hash of the sources and the driver strings, so the next launch skips compile + link
+and only calls glProgramBinary. A binary the driver rejects (e.g. after a driver update) is rebuilt from source.
+
+Compiles can also be asynchronous: RequestProgram* submits compile + link and returns right away,
+Update() (once per frame) polls GL_COMPLETION_STATUS_KHR and finishes the programs the driver is done with.
+Until then GetOrFallback() hands out a tiny built-in program so the render loop never waits on the compiler.
+Without KHR_parallel_shader_compile a status query would block, so Update() only finishes
+one program per call to spread the hitch over several frames.
+*/
+class ShaderManager {
+    public:
+        //an empty cache directory disables the binary cache, needs a current context
+        explicit ShaderManager(std::string cacheDirectory = "shader_cache");
+        ~ShaderManager();
+
+        ShaderManager(const ShaderManager&) = delete;
+        ShaderManager& operator=(const ShaderManager&) = delete;
+
+        //blocking: returns the program id, 0 on failure; loading the same name twice returns the existing program
+        GLuint LoadProgram(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath);
+        GLuint LoadProgramFromSource(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource);
+
+        //non-blocking: submits the compile and returns false only if the files can't be read
+        bool RequestProgram(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath);
+        void RequestProgramFromSource(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource);
+
+        //finishes the requests the driver has completed, call once per frame
+        void Update();
+
+        //blocks until every request is finished
+        void WaitAll();
+
+        bool IsReady(const std::string& name) const { return programs_.count(name) != 0; }
+        std::size_t PendingCount() const { return pending_.size(); }
+
+        //0 if no program with that name is ready (still compiling, failed or never requested)
+        GLuint Get(const std::string& name) const;
+
+        //the named program once it is ready, the built-in fallback until then
+        GLuint GetOrFallback(const std::string& name);
+
+        void Clear();
+
+        struct Stats {
+            int cacheHits = 0;
+            int cacheMisses = 0;
+            int failed = 0;
+            double loadMs = 0.0;        //main thread time spent submitting and finishing programs, cache lookups included
+        };
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        struct PendingProgram {
+            std::string name;
+            uint64_t key = 0;
+            GLuint program = 0, vertexShader = 0, fragmentShader = 0;
+        };
+
+        PendingProgram submit(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource);
+        bool isComplete(const PendingProgram& pending) const;
+        GLuint finish(PendingProgram& pending);
+        GLuint tryCache(const std::string& name, uint64_t& key, const std::string& vertexSource, const std::string& fragmentSource);
+        GLuint loadBinary(uint64_t key);
+        void storeBinary(uint64_t key, GLuint program);
+        uint64_t cacheKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+        std::string cachePath(uint64_t key) const;
+        void addTime(std::chrono::steady_clock::time_point start);
+
+        std::string cacheDirectory_;
+        std::string driverString_;
+        bool binaryCacheEnabled_ = false;
+        std::unordered_map<std::string, GLuint> programs_;
+        std::vector<PendingProgram> pending_;
+        GLuint fallbackProgram_ = 0;
+        Stats stats_;
+};
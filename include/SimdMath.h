@@ -0,0 +1,737 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/*
+Header-only math: Vec3, Vec4, Mat4, Quat, AABB, Frustum, plus SoA batch functions (SimdMath::) for transforming
+many points, multiplying many matrices or frustum testing many bounds at once.
+
+Column major everywhere, like GL and Object3D: m[column * 4 + row], Data() goes straight into glUniformMatrix4fv
+with transpose = GL_FALSE. Vectors are columns, `a * b` applies b first.
+
+The implementation is picked at compile time:
+    AVX2 + FMA      when the compiler targets it (cmake -DMENACE_AVX2=ON, or -mavx2 -mfma / /arch:AVX2)
+    SSE2            any other x86-64 build
+    scalar          everything else, or forced with MENACE_SIMD_SCALAR
+SimdMath::Backend() says which one a binary got. Vec4 / Mat4 / Quat arithmetic uses 4 wide registers, the batch
+functions process 4 (SSE2) or 8 (AVX2) elements per iteration. SimdMath::Scalar:: has plain loop versions of every
+batch function, as the reference results and the baseline for the benchmark.
+
+SoA means one array per component: points are x[], y[], z[]; N matrices are 16 arrays of N floats, array k holding
+element m[k] of every matrix; boxes are center x / y / z and extent x / y / z arrays. That is the layout the batch
+paths can load without shuffling. CullBoxes / CullSpheres test 4 or 8 bounds against all six frustum planes at once.
+*/
+
+#if !defined(MENACE_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MENACE_SIMD_SSE 1
+#include <emmintrin.h>
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define MENACE_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+//--------------------------------------------------VEC3----------------------------------------------------------------------
+
+//plain 12 byte vector, matches vertex data; math on it is scalar, wide math goes through Vec4 or the batch functions
+struct Vec3 {
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    Vec3() = default;
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+    explicit Vec3(const float* v) : x(v[0]), y(v[1]), z(v[2]) {}
+
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+
+    Vec3& operator+=(const Vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+    Vec3& operator-=(const Vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+    Vec3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3 operator-(const Vec3& v) { return Vec3(-v.x, -v.y, -v.z); }
+inline Vec3 operator*(const Vec3& v, float s) { return Vec3(v.x * s, v.y * s, v.z * s); }
+inline Vec3 operator*(float s, const Vec3& v) { return v * s; }
+inline Vec3 operator*(const Vec3& a, const Vec3& b) { return Vec3(a.x * b.x, a.y * b.y, a.z * b.z); }
+inline Vec3 operator/(const Vec3& v, float s) { return v * (1.0f / s); }
+
+inline float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3& a, const Vec3& b) { return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline float Length(const Vec3& v) { return std::sqrt(Dot(v, v)); }
+inline Vec3 Min(const Vec3& a, const Vec3& b) { return Vec3(std::fmin(a.x, b.x), std::fmin(a.y, b.y), std::fmin(a.z, b.z)); }
+inline Vec3 Max(const Vec3& a, const Vec3& b) { return Vec3(std::fmax(a.x, b.x), std::fmax(a.y, b.y), std::fmax(a.z, b.z)); }
+inline Vec3 Abs(const Vec3& v) { return Vec3(std::fabs(v.x), std::fabs(v.y), std::fabs(v.z)); }
+
+//zero length stays zero
+inline Vec3 Normalize(const Vec3& v)
+{
+    float length = Length(v);
+    return length > 0.0f ? v / length : v;
+}
+
+//--------------------------------------------------VEC4----------------------------------------------------------------------
+
+struct alignas(16) Vec4 {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+
+    Vec4() = default;
+    constexpr Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+    Vec3 XYZ() const { return Vec3(x, y, z); }
+
+#if MENACE_SIMD_SSE
+    explicit Vec4(__m128 v) { _mm_store_ps(&x, v); }
+    __m128 Load() const { return _mm_load_ps(&x); }
+#endif
+};
+
+#if MENACE_SIMD_SSE
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(_mm_add_ps(a.Load(), b.Load())); }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(_mm_sub_ps(a.Load(), b.Load())); }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return Vec4(_mm_mul_ps(a.Load(), b.Load())); }
+inline Vec4 operator*(const Vec4& v, float s) { return Vec4(_mm_mul_ps(v.Load(), _mm_set1_ps(s))); }
+
+inline float Dot(const Vec4& a, const Vec4& b)
+{
+    //horizontal add without SSE3: swap pairs, then halves
+    __m128 product = _mm_mul_ps(a.Load(), b.Load());
+    __m128 sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(sum);
+}
+#else
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return Vec4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+inline Vec4 operator*(const Vec4& v, float s) { return Vec4(v.x * s, v.y * s, v.z * s, v.w * s); }
+inline float Dot(const Vec4& a, const Vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+#endif
+
+inline Vec4 operator*(float s, const Vec4& v) { return v * s; }
+
+//--------------------------------------------------QUAT----------------------------------------------------------------------
+
+//unit quaternion rotation, xyz = axis * sin(angle / 2), w = cos(angle / 2) (glTF order)
+struct alignas(16) Quat {
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+
+    Quat() = default;
+    constexpr Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+    static Quat AxisAngle(const Vec3& axis, float radians)
+    {
+        Vec3 n = Normalize(axis) * std::sin(radians * 0.5f);
+        return Quat(n.x, n.y, n.z, std::cos(radians * 0.5f));
+    }
+
+    Quat Conjugate() const { return Quat(-x, -y, -z, w); }
+};
+
+#if MENACE_SIMD_SSE
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+    //w = aw bw - ax bx - ay by - az bz, xyz = aw b + bw a + a x b, written as four broadcasts with sign flips
+    __m128 qa = _mm_load_ps(&a.x);
+    __m128 qb = _mm_load_ps(&b.x);
+    __m128 aw = _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 ax = _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 ay = _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 az = _mm_shuffle_ps(qa, qa, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 r = _mm_mul_ps(aw, qb);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(ax, _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(0, 1, 2, 3))), _mm_set_ps(-1.0f, 1.0f, -1.0f, 1.0f)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(ay, _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(1, 0, 3, 2))), _mm_set_ps(-1.0f, -1.0f, 1.0f, 1.0f)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(az, _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(2, 3, 0, 1))), _mm_set_ps(-1.0f, 1.0f, 1.0f, -1.0f)));
+    Quat q;
+    _mm_store_ps(&q.x, r);
+    return q;
+}
+#else
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+    return Quat(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+#endif
+
+inline Quat Normalize(const Quat& q)
+{
+    float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return length > 0.0f ? Quat(q.x / length, q.y / length, q.z / length, q.w / length) : Quat();
+}
+
+//v' = v + 2w (q x v) + 2 q x (q x v)
+inline Vec3 Rotate(const Quat& q, const Vec3& v)
+{
+    Vec3 axis(q.x, q.y, q.z);
+    Vec3 t = Cross(axis, v) * 2.0f;
+    return v + t * q.w + Cross(axis, t);
+}
+
+//shortest path, falls back to a normalized lerp when the two are nearly the same
+inline Quat Slerp(const Quat& a, Quat b, float t)
+{
+    float cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    if (cosine < 0.0f) {
+        b = Quat(-b.x, -b.y, -b.z, -b.w);
+        cosine = -cosine;
+    }
+    float wa = 1.0f - t, wb = t;
+    if (cosine < 0.9995f) {
+        float angle = std::acos(cosine);
+        float sine = std::sin(angle);
+        wa = std::sin((1.0f - t) * angle) / sine;
+        wb = std::sin(t * angle) / sine;
+    }
+    return Normalize(Quat(a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb));
+}
+
+//--------------------------------------------------MAT4----------------------------------------------------------------------
+
+struct alignas(16) Mat4 {
+    float m[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+
+    Mat4() = default;
+    explicit Mat4(const float* columnMajor)
+    {
+        for (int i = 0; i < 16; ++i) {
+            m[i] = columnMajor[i];
+        }
+    }
+
+    static Mat4 Identity() { return Mat4(); }
+
+    static Mat4 Translation(const Vec3& t)
+    {
+        Mat4 r;
+        r.m[12] = t.x; r.m[13] = t.y; r.m[14] = t.z;
+        return r;
+    }
+
+    static Mat4 Scale(const Vec3& s)
+    {
+        Mat4 r;
+        r.m[0] = s.x; r.m[5] = s.y; r.m[10] = s.z;
+        return r;
+    }
+
+    static Mat4 Rotation(const Quat& q)
+    {
+        Mat4 r;
+        float x = q.x, y = q.y, z = q.z, w = q.w;
+        r.m[0] = 1 - 2 * (y * y + z * z); r.m[1] = 2 * (x * y + z * w);     r.m[2] = 2 * (x * z - y * w);
+        r.m[4] = 2 * (x * y - z * w);     r.m[5] = 1 - 2 * (x * x + z * z); r.m[6] = 2 * (y * z + x * w);
+        r.m[8] = 2 * (x * z + y * w);     r.m[9] = 2 * (y * z - x * w);     r.m[10] = 1 - 2 * (x * x + y * y);
+        return r;
+    }
+
+    //translation * rotation * scale, without the two matrix products
+    static Mat4 TRS(const Vec3& t, const Quat& q, const Vec3& s)
+    {
+        Mat4 r = Rotation(q);
+        for (int row = 0; row < 3; ++row) {
+            r.m[row] *= s.x;
+            r.m[4 + row] *= s.y;
+            r.m[8 + row] *= s.z;
+        }
+        r.m[12] = t.x; r.m[13] = t.y; r.m[14] = t.z;
+        return r;
+    }
+
+    //GL clip space (z in [-w, w]), right handed, looking down -z
+    static Mat4 Perspective(float fovY, float aspect, float nearPlane, float farPlane)
+    {
+        Mat4 r;
+        float f = 1.0f / std::tan(fovY * 0.5f);
+        r.m[0] = f / aspect;
+        r.m[5] = f;
+        r.m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+        r.m[11] = -1.0f;
+        r.m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+        r.m[15] = 0.0f;
+        return r;
+    }
+
+    static Mat4 LookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+    {
+        Vec3 f = Normalize(target - eye);
+        Vec3 s = Normalize(Cross(f, up));
+        Vec3 u = Cross(s, f);
+        Mat4 r;
+        r.m[0] = s.x; r.m[4] = s.y; r.m[8] = s.z;
+        r.m[1] = u.x; r.m[5] = u.y; r.m[9] = u.z;
+        r.m[2] = -f.x; r.m[6] = -f.y; r.m[10] = -f.z;
+        r.m[12] = -Dot(s, eye);
+        r.m[13] = -Dot(u, eye);
+        r.m[14] = Dot(f, eye);
+        return r;
+    }
+
+    const float* Data() const { return m; }
+    Vec4 Column(int c) const { return Vec4(m[c * 4], m[c * 4 + 1], m[c * 4 + 2], m[c * 4 + 3]); }
+    Vec3 GetTranslation() const { return Vec3(m[12], m[13], m[14]); }
+};
+
+#if MENACE_SIMD_AVX2
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    //two result columns per register: each lane half gets a's columns, weighted by its own column of b
+    __m256 a0 = _mm256_broadcast_ps((const __m128*)&a.m[0]);
+    __m256 a1 = _mm256_broadcast_ps((const __m128*)&a.m[4]);
+    __m256 a2 = _mm256_broadcast_ps((const __m128*)&a.m[8]);
+    __m256 a3 = _mm256_broadcast_ps((const __m128*)&a.m[12]);
+    Mat4 r;
+    //Mat4 only promises 16 byte alignment, unaligned 8 wide loads / stores cost nothing extra on AVX2 hardware
+    for (int c = 0; c < 16; c += 8) {
+        __m256 columns = _mm256_loadu_ps(&b.m[c]);
+        __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(columns, 0x00));
+        sum = _mm256_fmadd_ps(a1, _mm256_permute_ps(columns, 0x55), sum);
+        sum = _mm256_fmadd_ps(a2, _mm256_permute_ps(columns, 0xAA), sum);
+        sum = _mm256_fmadd_ps(a3, _mm256_permute_ps(columns, 0xFF), sum);
+        _mm256_storeu_ps(&r.m[c], sum);
+    }
+    return r;
+}
+#elif MENACE_SIMD_SSE
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    __m128 a0 = _mm_load_ps(&a.m[0]);
+    __m128 a1 = _mm_load_ps(&a.m[4]);
+    __m128 a2 = _mm_load_ps(&a.m[8]);
+    __m128 a3 = _mm_load_ps(&a.m[12]);
+    Mat4 r;
+    for (int c = 0; c < 16; c += 4) {
+        __m128 column = _mm_load_ps(&b.m[c]);
+        __m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_store_ps(&r.m[c], sum);
+    }
+    return r;
+}
+#else
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    Mat4 r;
+    for (int c = 0; c < 4; ++c) {
+        for (int row = 0; row < 4; ++row) {
+            r.m[c * 4 + row] = a.m[row] * b.m[c * 4] + a.m[4 + row] * b.m[c * 4 + 1] +
+                               a.m[8 + row] * b.m[c * 4 + 2] + a.m[12 + row] * b.m[c * 4 + 3];
+        }
+    }
+    return r;
+}
+#endif
+
+#if MENACE_SIMD_SSE
+inline Vec4 operator*(const Mat4& a, const Vec4& v)
+{
+    __m128 vector = v.Load();
+    __m128 sum = _mm_mul_ps(_mm_load_ps(&a.m[0]), _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(0, 0, 0, 0)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&a.m[4]), _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(1, 1, 1, 1))));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&a.m[8]), _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(2, 2, 2, 2))));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&a.m[12]), _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(3, 3, 3, 3))));
+    return Vec4(sum);
+}
+#else
+inline Vec4 operator*(const Mat4& a, const Vec4& v)
+{
+    Vec4 r;
+    for (int row = 0; row < 4; ++row) {
+        r[row] = a.m[row] * v.x + a.m[4 + row] * v.y + a.m[8 + row] * v.z + a.m[12 + row] * v.w;
+    }
+    return r;
+}
+#endif
+
+inline Vec3 TransformPoint(const Mat4& a, const Vec3& p) { return (a * Vec4(p, 1.0f)).XYZ(); }
+inline Vec3 TransformVector(const Mat4& a, const Vec3& v) { return (a * Vec4(v, 0.0f)).XYZ(); }
+
+inline Mat4 Transpose(const Mat4& a)
+{
+    Mat4 r;
+    for (int c = 0; c < 4; ++c) {
+        for (int row = 0; row < 4; ++row) {
+            r.m[row * 4 + c] = a.m[c * 4 + row];
+        }
+    }
+    return r;
+}
+
+//general inverse through cofactors, a singular matrix gives the identity
+inline Mat4 Inverse(const Mat4& a)
+{
+    const float* m = a.m;
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+    float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant == 0.0f) {
+        return Mat4();
+    }
+    Mat4 r;
+    for (int i = 0; i < 16; ++i) {
+        r.m[i] = inv[i] / determinant;
+    }
+    return r;
+}
+
+//--------------------------------------------------AABB----------------------------------------------------------------------
+
+struct AABB {
+    Vec3 min, max;
+
+    AABB() = default;
+    AABB(const Vec3& min, const Vec3& max) : min(min), max(max) {}
+
+    //min > max, so the first Expand() sets both
+    static AABB Empty()
+    {
+        float inf = std::numeric_limits<float>::infinity();
+        return AABB(Vec3(inf, inf, inf), Vec3(-inf, -inf, -inf));
+    }
+
+    bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    Vec3 Center() const { return (min + max) * 0.5f; }
+    Vec3 Extents() const { return (max - min) * 0.5f; }
+
+    void Expand(const Vec3& p) { min = Min(min, p); max = Max(max, p); }
+    void Expand(const AABB& box) { min = Min(min, box.min); max = Max(max, box.max); }
+};
+
+//the box around the transformed box: center moves with the matrix, extents go through |matrix| (Arvo)
+inline AABB Transform(const Mat4& a, const AABB& box)
+{
+    Vec3 center = TransformPoint(a, box.Center());
+    Vec3 e = box.Extents();
+    Vec3 extents(std::fabs(a.m[0]) * e.x + std::fabs(a.m[4]) * e.y + std::fabs(a.m[8]) * e.z,
+                 std::fabs(a.m[1]) * e.x + std::fabs(a.m[5]) * e.y + std::fabs(a.m[9]) * e.z,
+                 std::fabs(a.m[2]) * e.x + std::fabs(a.m[6]) * e.y + std::fabs(a.m[10]) * e.z);
+    return AABB(center - extents, center + extents);
+}
+
+//--------------------------------------------------FRUSTUM----------------------------------------------------------------------
+
+//six planes (left, right, bottom, top, near, far) as xyz = inward normal, w = distance, inside where dot(n, p) + w >= 0
+struct Frustum {
+    Vec4 planes[6];
+
+    //from a view-projection matrix in GL clip space (Gribb / Hartmann), planes are normalized
+    static Frustum FromMatrix(const Mat4& viewProjection)
+    {
+        const float* m = viewProjection.m;
+        Vec4 row[4];
+        for (int r = 0; r < 4; ++r) {
+            row[r] = Vec4(m[r], m[4 + r], m[8 + r], m[12 + r]);
+        }
+        Frustum frustum;
+        frustum.planes[0] = row[3] + row[0];
+        frustum.planes[1] = row[3] - row[0];
+        frustum.planes[2] = row[3] + row[1];
+        frustum.planes[3] = row[3] - row[1];
+        frustum.planes[4] = row[3] + row[2];
+        frustum.planes[5] = row[3] - row[2];
+        for (Vec4& plane : frustum.planes) {
+            float length = Length(plane.XYZ());
+            if (length > 0.0f) {
+                plane = plane * (1.0f / length);
+            }
+        }
+        return frustum;
+    }
+
+    //conservative: false only if the box is completely outside one plane
+    bool Intersects(const AABB& box) const
+    {
+        Vec3 center = box.Center();
+        Vec3 extents = box.Extents();
+        for (const Vec4& plane : planes) {
+            Vec3 normal = plane.XYZ();
+            if (Dot(normal, center) + plane.w < -Dot(Abs(normal), extents)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Intersects(const Vec3& center, float radius) const
+    {
+        for (const Vec4& plane : planes) {
+            if (Dot(plane.XYZ(), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+//--------------------------------------------------BATCH----------------------------------------------------------------------
+
+namespace SimdMath {
+
+    inline const char* Backend()
+    {
+#if MENACE_SIMD_AVX2
+        return "avx2";
+#elif MENACE_SIMD_SSE
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+    //the plain loops the wide paths are checked and benchmarked against
+    namespace Scalar {
+
+        inline void TransformPoints(const Mat4& a, const float* x, const float* y, const float* z, std::size_t count,
+                                    float* outX, float* outY, float* outZ)
+        {
+            const float* m = a.m;
+            for (std::size_t i = 0; i < count; ++i) {
+                float px = x[i], py = y[i], pz = z[i];
+                outX[i] = m[0] * px + m[4] * py + m[8] * pz + m[12];
+                outY[i] = m[1] * px + m[5] * py + m[9] * pz + m[13];
+                outZ[i] = m[2] * px + m[6] * py + m[10] * pz + m[14];
+            }
+        }
+
+        inline void MultiplyMatrices(const float* const a[16], const float* const b[16], float* const out[16], std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                float r[16];
+                for (int c = 0; c < 4; ++c) {
+                    for (int row = 0; row < 4; ++row) {
+                        r[c * 4 + row] = a[row][i] * b[c * 4][i] + a[4 + row][i] * b[c * 4 + 1][i] +
+                                         a[8 + row][i] * b[c * 4 + 2][i] + a[12 + row][i] * b[c * 4 + 3][i];
+                    }
+                }
+                for (int k = 0; k < 16; ++k) {
+                    out[k][i] = r[k];
+                }
+            }
+        }
+
+        inline std::size_t CullBoxes(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                     const float* extentX, const float* extentY, const float* extentZ, std::size_t count,
+                                     uint32_t* visible, uint32_t firstIndex = 0)
+        {
+            std::size_t written = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                bool inside = true;
+                for (const Vec4& plane : frustum.planes) {
+                    float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+                    float radius = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+                    inside = inside && distance + radius >= 0.0f;
+                }
+                visible[written] = firstIndex + (uint32_t)i;
+                written += inside;
+            }
+            return written;
+        }
+
+        inline std::size_t CullSpheres(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                       const float* radius, std::size_t count, uint32_t* visible, uint32_t firstIndex = 0)
+        {
+            std::size_t written = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                bool inside = true;
+                for (const Vec4& plane : frustum.planes) {
+                    inside = inside && plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w + radius[i] >= 0.0f;
+                }
+                visible[written] = firstIndex + (uint32_t)i;
+                written += inside;
+            }
+            return written;
+        }
+
+    }
+
+#if MENACE_SIMD_AVX2
+    typedef __m256 Wide;
+    static const std::size_t kWidth = 8;
+    inline Wide wideLoad(const float* p) { return _mm256_loadu_ps(p); }
+    inline void wideStore(float* p, Wide v) { _mm256_storeu_ps(p, v); }
+    inline Wide wideSet(float v) { return _mm256_set1_ps(v); }
+    inline Wide wideMul(Wide a, Wide b) { return _mm256_mul_ps(a, b); }
+    inline Wide wideMulAdd(Wide a, Wide b, Wide c) { return _mm256_fmadd_ps(a, b, c); }
+    inline Wide wideAbs(Wide v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+    inline Wide wideOr(Wide a, Wide b) { return _mm256_or_ps(a, b); }
+    inline Wide wideZero() { return _mm256_setzero_ps(); }
+    inline Wide wideLess(Wide a, Wide b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline int wideMask(Wide v) { return _mm256_movemask_ps(v); }
+    inline Wide wideAdd(Wide a, Wide b) { return _mm256_add_ps(a, b); }
+    inline Wide wideMin(Wide a, Wide b) { return _mm256_min_ps(a, b); }
+    inline Wide wideMax(Wide a, Wide b) { return _mm256_max_ps(a, b); }
+    inline Wide wideSelect(Wide mask, Wide a, Wide b) { return _mm256_blendv_ps(b, a, mask); }   //mask ? a : b
+    inline Wide wideRamp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+#elif MENACE_SIMD_SSE
+    typedef __m128 Wide;
+    static const std::size_t kWidth = 4;
+    inline Wide wideLoad(const float* p) { return _mm_loadu_ps(p); }
+    inline void wideStore(float* p, Wide v) { _mm_storeu_ps(p, v); }
+    inline Wide wideSet(float v) { return _mm_set1_ps(v); }
+    inline Wide wideMul(Wide a, Wide b) { return _mm_mul_ps(a, b); }
+    inline Wide wideMulAdd(Wide a, Wide b, Wide c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    inline Wide wideAbs(Wide v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+    inline Wide wideOr(Wide a, Wide b) { return _mm_or_ps(a, b); }
+    inline Wide wideZero() { return _mm_setzero_ps(); }
+    inline Wide wideLess(Wide a, Wide b) { return _mm_cmplt_ps(a, b); }
+    inline int wideMask(Wide v) { return _mm_movemask_ps(v); }
+    inline Wide wideAdd(Wide a, Wide b) { return _mm_add_ps(a, b); }
+    inline Wide wideMin(Wide a, Wide b) { return _mm_min_ps(a, b); }
+    inline Wide wideMax(Wide a, Wide b) { return _mm_max_ps(a, b); }
+    inline Wide wideSelect(Wide mask, Wide a, Wide b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    inline Wide wideRamp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+#endif
+
+    //out = a * (x, y, z, 1) for `count` points in SoA form, the outputs may be the inputs
+    inline void TransformPoints(const Mat4& a, const float* x, const float* y, const float* z, std::size_t count,
+                                float* outX, float* outY, float* outZ)
+    {
+        std::size_t i = 0;
+#if MENACE_SIMD_SSE
+        const float* m = a.m;
+        Wide m0 = wideSet(m[0]), m1 = wideSet(m[1]), m2 = wideSet(m[2]);
+        Wide m4 = wideSet(m[4]), m5 = wideSet(m[5]), m6 = wideSet(m[6]);
+        Wide m8 = wideSet(m[8]), m9 = wideSet(m[9]), m10 = wideSet(m[10]);
+        Wide m12 = wideSet(m[12]), m13 = wideSet(m[13]), m14 = wideSet(m[14]);
+        for (; i + kWidth <= count; i += kWidth) {
+            Wide px = wideLoad(x + i), py = wideLoad(y + i), pz = wideLoad(z + i);
+            wideStore(outX + i, wideMulAdd(m8, pz, wideMulAdd(m4, py, wideMulAdd(m0, px, m12))));
+            wideStore(outY + i, wideMulAdd(m9, pz, wideMulAdd(m5, py, wideMulAdd(m1, px, m13))));
+            wideStore(outZ + i, wideMulAdd(m10, pz, wideMulAdd(m6, py, wideMulAdd(m2, px, m14))));
+        }
+#endif
+        Scalar::TransformPoints(a, x + i, y + i, z + i, count - i, outX + i, outY + i, outZ + i);
+    }
+
+    //out[i] = a[i] * b[i] for `count` matrices in SoA form (16 arrays each), `out` must not alias the inputs
+    inline void MultiplyMatrices(const float* const a[16], const float* const b[16], float* const out[16], std::size_t count)
+    {
+        std::size_t i = 0;
+#if MENACE_SIMD_SSE
+        for (; i + kWidth <= count; i += kWidth) {
+            Wide left[16];
+            for (int k = 0; k < 16; ++k) {
+                left[k] = wideLoad(a[k] + i);
+            }
+            for (int c = 0; c < 4; ++c) {
+                Wide b0 = wideLoad(b[c * 4] + i), b1 = wideLoad(b[c * 4 + 1] + i);
+                Wide b2 = wideLoad(b[c * 4 + 2] + i), b3 = wideLoad(b[c * 4 + 3] + i);
+                for (int row = 0; row < 4; ++row) {
+                    Wide sum = wideMul(left[row], b0);
+                    sum = wideMulAdd(left[4 + row], b1, sum);
+                    sum = wideMulAdd(left[8 + row], b2, sum);
+                    sum = wideMulAdd(left[12 + row], b3, sum);
+                    wideStore(out[c * 4 + row] + i, sum);
+                }
+            }
+        }
+#endif
+        if (i < count) {
+            const float* tailA[16];
+            const float* tailB[16];
+            float* tailOut[16];
+            for (int k = 0; k < 16; ++k) {
+                tailA[k] = a[k] + i;
+                tailB[k] = b[k] + i;
+                tailOut[k] = out[k] + i;
+            }
+            Scalar::MultiplyMatrices(tailA, tailB, tailOut, count - i);
+        }
+    }
+
+    //writes the indices (+ firstIndex) of the boxes that are not completely outside a plane to `visible`, in order,
+    //returns how many; `visible` needs room for `count` (every slot may be written, only the returned ones count)
+    inline std::size_t CullBoxes(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                 const float* extentX, const float* extentY, const float* extentZ, std::size_t count,
+                                 uint32_t* visible, uint32_t firstIndex = 0)
+    {
+        std::size_t i = 0, written = 0;
+#if MENACE_SIMD_SSE
+        Wide normal[6][3], absolute[6][3], distance[6];
+        for (int p = 0; p < 6; ++p) {
+            for (int c = 0; c < 3; ++c) {
+                normal[p][c] = wideSet(frustum.planes[p][c]);
+                absolute[p][c] = wideAbs(normal[p][c]);
+            }
+            distance[p] = wideSet(frustum.planes[p].w);
+        }
+        for (; i + kWidth <= count; i += kWidth) {
+            Wide cx = wideLoad(centerX + i), cy = wideLoad(centerY + i), cz = wideLoad(centerZ + i);
+            Wide ex = wideLoad(extentX + i), ey = wideLoad(extentY + i), ez = wideLoad(extentZ + i);
+            Wide outside = wideZero();
+            for (int p = 0; p < 6; ++p) {
+                //center distance + projected extent < 0: the whole box is behind the plane
+                Wide reach = wideMulAdd(normal[p][2], cz, wideMulAdd(normal[p][1], cy, wideMulAdd(normal[p][0], cx, distance[p])));
+                reach = wideMulAdd(absolute[p][2], ez, wideMulAdd(absolute[p][1], ey, wideMulAdd(absolute[p][0], ex, reach)));
+                outside = wideOr(outside, wideLess(reach, wideZero()));
+            }
+            int mask = wideMask(outside);
+            for (std::size_t lane = 0; lane < kWidth; ++lane) {
+                visible[written] = firstIndex + (uint32_t)(i + lane);
+                written += ((mask >> lane) & 1) ^ 1;
+            }
+        }
+#endif
+        return written + Scalar::CullBoxes(frustum, centerX + i, centerY + i, centerZ + i, extentX + i, extentY + i, extentZ + i,
+                                           count - i, visible + written, firstIndex + (uint32_t)i);
+    }
+
+    //CullBoxes for bounding spheres
+    inline std::size_t CullSpheres(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+                                   const float* radius, std::size_t count, uint32_t* visible, uint32_t firstIndex = 0)
+    {
+        std::size_t i = 0, written = 0;
+#if MENACE_SIMD_SSE
+        Wide normal[6][3], distance[6];
+        for (int p = 0; p < 6; ++p) {
+            for (int c = 0; c < 3; ++c) {
+                normal[p][c] = wideSet(frustum.planes[p][c]);
+            }
+            distance[p] = wideSet(frustum.planes[p].w);
+        }
+        for (; i + kWidth <= count; i += kWidth) {
+            Wide cx = wideLoad(centerX + i), cy = wideLoad(centerY + i), cz = wideLoad(centerZ + i);
+            Wide r = wideLoad(radius + i);
+            Wide outside = wideZero();
+            for (int p = 0; p < 6; ++p) {
+                Wide reach = wideMulAdd(normal[p][2], cz, wideMulAdd(normal[p][1], cy, wideMulAdd(normal[p][0], cx, distance[p])));
+                outside = wideOr(outside, wideLess(reach, wideMul(r, wideSet(-1.0f))));
+            }
+            int mask = wideMask(outside);
+            for (std::size_t lane = 0; lane < kWidth; ++lane) {
+                visible[written] = firstIndex + (uint32_t)(i + lane);
+                written += ((mask >> lane) & 1) ^ 1;
+            }
+        }
+#endif
+        return written + Scalar::CullSpheres(frustum, centerX + i, centerY + i, centerZ + i, radius + i, count - i,
+                                             visible + written, firstIndex + (uint32_t)i);
+    }
+
+}
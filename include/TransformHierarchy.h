@@ -0,0 +1,125 @@
+#pragma once
+
+#include "SimdMath.h"
+#include "JobPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+Parent / child transforms for large scenes, stored flat instead of as a tree of objects.
+
+    TransformHierarchy hierarchy;
+    TransformHierarchy::Handle car = hierarchy.Add();
+    TransformHierarchy::Handle wheel = hierarchy.Add(car);
+    hierarchy.SetTranslation(wheel, Vec3(1.0f, 0.0f, 0.0f));
+    ...every frame:
+    hierarchy.SetRotation(car, turn);
+    hierarchy.Update();
+    object.SetTransform(hierarchy.World(wheel).Data());
+
+Every per-node field is its own array (translation, rotation, scale, local matrix, world matrix, parent, subtree size)
+indexed by slot, and the slots are kept in depth-first order: a parent always comes before its children and
+a node's subtree is the contiguous slot range [slot, slot + subtree size).
+Setters only write the local part and queue the node. Update() sorts the queued slots, merges their subtree ranges
+and walks just those ranges front to back, world = parent world * local, so a frame that animates a handful of nodes
+touches those nodes' subtrees and nothing else, however large the scene is. When the ranges add up to more than
+Options::minParallelNodes, independent subtrees are split across a JobPool, started by the first such Update().
+
+Add / Remove / SetParent only record the change, the next Update() re-sorts the arrays once (O(nodes)).
+Handles stay valid until their node is removed, slots (Slot(), WorldMatrices()) only until the next structural change.
+World matrices are what the last Update() computed.
+*/
+class TransformHierarchy {
+    public:
+        typedef uint32_t Handle;            //0 = no node, as a parent: a root
+
+        struct Options {
+            int threads = 0;                            //0 = one per hardware thread
+            std::size_t minParallelNodes = 1 << 16;     //dirty nodes below this are updated on the calling thread
+        };
+
+        struct Stats {
+            std::size_t nodes = 0;
+            std::size_t updatedNodes = 0;       //world matrices recomputed by the last Update()
+            std::size_t dirtyRanges = 0;        //merged subtree ranges of the last Update()
+            int threads = 0;                    //threads the last Update() used
+            double updateMs = 0.0;              //last Update(), reorder included
+            double reorderMs = 0.0;             //last re-sort after a structural change
+        };
+
+        TransformHierarchy() = default;
+        explicit TransformHierarchy(const Options& options) : options_(options) {}
+
+        //`parent` has to exist, the new node starts at identity
+        Handle Add(Handle parent = 0);
+        //removes the node together with its whole subtree
+        void Remove(Handle handle);
+        //false and an ERROR line if `parent` is `handle` itself or below it
+        bool SetParent(Handle handle, Handle parent);
+        bool Valid(Handle handle) const;
+
+        //local transform relative to the parent, world = parent world * translation * rotation * scale
+        void SetLocal(Handle handle, const Vec3& translation, const Quat& rotation, const Vec3& scale);
+        void SetTranslation(Handle handle, const Vec3& translation);
+        void SetRotation(Handle handle, const Quat& rotation);
+        void SetScale(Handle handle, const Vec3& scale);
+        //for matrices that are not TRS (glTF node.matrix), the node's translation / rotation / scale are then stale
+        void SetLocalMatrix(Handle handle, const Mat4& local);
+
+        const Vec3& GetTranslation(Handle handle) const { return translation_[slot_[handle]]; }
+        const Quat& GetRotation(Handle handle) const { return rotation_[slot_[handle]]; }
+        const Vec3& GetScale(Handle handle) const { return scale_[slot_[handle]]; }
+        Handle GetParent(Handle handle) const;
+
+        //re-sorts after structural changes, then recomputes the queued subtrees
+        void Update();
+
+        const Mat4& World(Handle handle) const { return world_[slot_[handle]]; }
+        const Mat4& Local(Handle handle) const { return local_[slot_[handle]]; }
+
+        //depth-first order, only stable until the next Add / Remove / SetParent + Update()
+        std::size_t Size() const { return world_.size(); }
+        uint32_t Slot(Handle handle) const { return slot_[handle]; }
+        Handle HandleAt(uint32_t slot) const { return handle_[slot]; }
+        const std::vector<Mat4>& WorldMatrices() const { return world_; }
+
+        const Stats& GetStats() const { return stats_; }
+
+    private:
+        enum : uint8_t { kQueued = 1, kLocalDirty = 2, kRemoved = 4 };
+
+        struct Range {
+            uint32_t begin, end;
+        };
+
+        void queue(uint32_t slot, bool localDirty);
+        void reorder();
+        void updateRange(uint32_t begin, uint32_t end);
+        void updateNode(uint32_t slot);
+
+        Options options_;
+
+        //by slot
+        std::vector<Handle> handle_;
+        std::vector<int32_t> parent_;           //slot of the parent, -1 for roots
+        std::vector<uint32_t> subtree_;         //nodes in the subtree, the node included
+        std::vector<uint8_t> flags_;
+        std::vector<Vec3> translation_;
+        std::vector<Quat> rotation_;
+        std::vector<Vec3> scale_;
+        std::vector<Mat4> local_;
+        std::vector<Mat4> world_;
+
+        //by handle
+        std::vector<uint32_t> slot_ = std::vector<uint32_t>(1, kNoSlot);
+        std::vector<Handle> freeHandles_;
+
+        std::vector<Handle> queued_;            //handles, slots move when reordering
+        bool structureDirty_ = false;
+        std::unique_ptr<JobPool> pool_;         //only once an update was large enough
+        Stats stats_;
+
+        static constexpr uint32_t kNoSlot = 0xFFFFFFFFu;
+};
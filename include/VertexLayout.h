@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//what an attribute means, fixes its shader location (see VertexLayout::Location)
+enum class VertexSemantic : uint8_t {
+    Position,
+    Color,
+    Normal,
+    TexCoord0,
+    TexCoord1,
+    Tangent,
+};
+
+//how one component is stored in the vertex buffer
+enum class VertexFormat : uint8_t {
+    Float,          //32 bit float
+    Half,           //16 bit float
+    UByte,          //8 bit, unorm8 when normalized (colors)
+    Byte,           //8 bit, snorm8 when normalized
+    UShort,         //16 bit, unorm16 when normalized
+    Short,          //16 bit, snorm16 when normalized
+    Int2101010,     //GL_INT_2_10_10_10_REV, xyz snorm10 + w snorm2 in one 32 bit word (normals, tangents)
+    Octahedral16,   //unit vector folded onto an octahedron, 2 x snorm16, the shader decodes it (see below)
+};
+
+struct VertexAttribute {
+    VertexSemantic semantic;
+    VertexFormat format;
+    uint8_t components;     //floats taken from the source vertex, 1-4
+    bool normalized;
+    uint8_t stream;         //vertex buffer the attribute lives in, 0 = main stream
+    uint32_t offset;        //bytes from the start of the vertex inside its stream
+};
+
+//per mesh remap of the positions into the range of a normalized integer format, position = stored * scale + offset
+struct PositionQuantization {
+    float offset[3] = { 0.0f, 0.0f, 0.0f };
+    float scale[3] = { 1.0f, 1.0f, 1.0f };
+    bool enabled = false;
+
+    //column major scale + translate, to be applied before the model matrix
+    void Matrix(float matrix[16]) const;
+};
+
+//largest difference between the float source and what the GPU decodes, per kind of attribute
+struct QuantizationError {
+    float position = 0.0f;      //object space units, after dequantization
+    float normal = 0.0f;        //degrees, normals and tangents
+    float color = 0.0f;
+    float texCoord = 0.0f;
+};
+
+/*
+Describes how a Mesh's vertices are stored on the GPU.
+Meshes are built from float vertices where every attribute takes `components` floats, in the order added
+(Position must come first, the optimizers read it there). Pack() converts that into the GPU formats,
+one interleaved buffer per stream, and Apply() sets up glVertexAttribPointer for them.
+
+    VertexLayout layout;
+    layout.Add(VertexSemantic::Position, VertexFormat::Half, 3)
+          .Add(VertexSemantic::Normal, VertexFormat::Int2101010, 3, true, 1)     //second stream
+          .Add(VertexSemantic::Color, VertexFormat::UByte, 4, true, 1);
+
+Every attribute is padded to 4 bytes so it stays aligned for fetch, e.g. half3 takes 8.
+Putting positions alone in stream 0 lets depth-only passes fetch just those.
+
+Quantized() derives the compact import-time layout from a float one: unorm16 positions (with a per mesh
+PositionQuantization to undo in the vertex shader, the Renderer folds it into instance matrices),
+octahedral or 10_10_10_2 normals, RGBA8 colors and half UVs. Octahedral normals decode with
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n = normalize(n);
+*/
+class VertexLayout {
+    public:
+        static const int kMaxAttributes = 8;
+        static const int kMaxStreams = 4;
+
+        VertexLayout& Add(VertexSemantic semantic, VertexFormat format, int components, bool normalized = false, int stream = 0);
+
+        //float3 position + float3 color, 24 bytes, what Mesh always used
+        static VertexLayout PositionColor();
+        //half3 position + unorm8 rgba color, 12 bytes, same source data as PositionColor
+        static VertexLayout PositionColorPacked();
+        //same semantics and streams as `source`, every attribute in its compact format
+        static VertexLayout Quantized(const VertexLayout& source, bool octahedralNormals = true);
+
+        int AttributeCount() const { return count_; }
+        const VertexAttribute& Attribute(int index) const { return attributes_[index]; }
+        int StreamCount() const { return streams_; }
+        std::size_t Stride(int stream) const { return strides_[stream]; }
+        std::size_t VertexBytes() const;        //all streams together
+        std::size_t SourceFloats() const { return sourceFloats_; }
+
+        //single stream of plain floats in source order, the source vertices can be uploaded as they are
+        bool MatchesSource() const;
+
+        //the remap that spreads positions inside [min, max] over the full range of the position format,
+        //disabled unless the position is a normalized integer
+        PositionQuantization QuantizePositions(const float min[3], const float max[3]) const;
+
+        //converts `vertexCount` source vertices into one buffer per stream
+        void Pack(const float* source, std::size_t vertexCount, std::vector<uint8_t> streams[kMaxStreams],
+                  const PositionQuantization* positions = nullptr) const;
+        //the inverse, back to source floats as the GPU would see them
+        void Unpack(const std::vector<uint8_t> streams[kMaxStreams], std::size_t vertexCount, float* destination,
+                    const PositionQuantization* positions = nullptr) const;
+        QuantizationError MeasureError(const float* source, std::size_t vertexCount, const std::vector<uint8_t> streams[kMaxStreams],
+                                       const PositionQuantization* positions = nullptr) const;
+
+        //glVertexAttribPointer + glEnableVertexAttribArray for every attribute, buffers[s] holds stream s, the VAO must be bound
+        void Apply(const GLuint* buffers) const;
+
+        //Position 0, Color 1, Normal 2, TexCoord0 7, TexCoord1 8, Tangent 9 (3-6 is the instance matrix)
+        static GLuint Location(VertexSemantic semantic);
+        static std::size_t FormatSize(VertexFormat format, int components);
+        static GLenum GLType(VertexFormat format);
+
+    private:
+        VertexAttribute attributes_[kMaxAttributes] = {};
+        int count_ = 0;
+        int streams_ = 0;
+        std::size_t strides_[kMaxStreams] = {};
+        std::size_t sourceFloats_ = 0;
+};
+
+//float <-> IEEE half, round to nearest even, overflow goes to infinity
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
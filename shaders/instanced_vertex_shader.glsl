@@ -0,0 +1,13 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+//per instance model matrix, filled by the Renderer, takes locations 3 to 6
+layout(location = 3) in mat4 aModel;
+
+out vec3 vColor;
+
+void main()
+{
+    vColor = aColor;
+    gl_Position = aModel * vec4(aPos, 1.0);
+}
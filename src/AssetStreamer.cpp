@@ -0,0 +1,530 @@
+#include "AssetStreamer.h"
+#include "GLState.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+    std::string extensionOf(const std::string& path)
+    {
+        std::size_t dot = path.find_last_of('.');
+        std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return extension;
+    }
+
+    //binary PPM (P6, maxval 255) as Framebuffer::WritePPM writes it, `pixels` points at the first RGB byte
+    bool parsePPM(const unsigned char* data, std::size_t size, int& width, int& height, const unsigned char*& pixels)
+    {
+        std::size_t p = 0;
+        auto next = [&](long long& value) {
+            //whitespace and # comments between the tokens
+            while (p < size && (std::isspace(data[p]) || data[p] == '#')) {
+                if (data[p] == '#') {
+                    while (p < size && data[p] != '\n') ++p;
+                } else {
+                    ++p;
+                }
+            }
+            value = 0;
+            std::size_t start = p;
+            while (p < size && std::isdigit(data[p]) && p - start < 9) {
+                value = value * 10 + (data[p++] - '0');
+            }
+            return p > start;
+        };
+        long long w, h, maxValue;
+        if (size < 2 || data[0] != 'P' || data[1] != '6') {
+            return false;
+        }
+        p = 2;
+        if (!next(w) || !next(h) || !next(maxValue) || maxValue != 255 || w <= 0 || h <= 0 || p >= size || !std::isspace(data[p])) {
+            return false;
+        }
+        ++p;
+        if ((std::size_t)(w * h * 3) > size - p) {
+            return false;
+        }
+        width = (int)w;
+        height = (int)h;
+        pixels = data + p;
+        return true;
+    }
+
+}
+
+AssetStreamer::~AssetStreamer() {
+    Destroy();
+}
+
+bool AssetStreamer::Create(const Options& options) {
+    Destroy();
+    options_ = options;
+    if (!staging_.Create(options_.bytesPerFrame)) {
+        return false;
+    }
+    int threads = options_.threads;
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    stopping_ = false;
+    for (int t = 0; t < threads; ++t) {
+        workers_.emplace_back(&AssetStreamer::work, this);
+    }
+    return true;
+}
+
+void AssetStreamer::Destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    for (auto& entry : assets_) {
+        destroy(*entry.second);
+    }
+    assets_.clear();
+    uploads_.clear();
+    fenced_.clear();
+    decoded_.clear();
+    pending_ = 0;
+    staging_.Destroy();
+}
+
+AssetStreamer::Handle AssetStreamer::Request(const std::string& path) {
+    std::string extension = extensionOf(path);
+    Kind kind;
+    if (extension == ".mmsh" || extension == ".obj" || extension == ".ply") {
+        kind = Kind::Mesh;
+    } else if (extension == ".glb" || extension == ".gltf") {
+        kind = Kind::Scene;
+    } else if (extension == ".ppm") {
+        kind = Kind::Texture;
+    } else {
+        std::cout << "ERROR: ASSET STREAMER UNSUPPORTED FILE: " << path << std::endl;
+        return 0;
+    }
+
+    std::unique_ptr<Asset> asset = std::make_unique<Asset>();
+    asset->handle = nextHandle_++;
+    asset->kind = kind;
+    asset->path = path;
+    Asset* queued = asset.get();
+    assets_[asset->handle] = std::move(asset);
+    pending_++;
+    stats_.requested++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(queued);
+    }
+    wake_.notify_one();
+    return queued->handle;
+}
+
+void AssetStreamer::Release(Handle handle) {
+    Asset* asset = find(handle);
+    if (!asset) {
+        return;
+    }
+    if (asset->state == State::Ready || asset->state == State::Failed) {
+        destroy(*asset);
+        assets_.erase(handle);
+        return;
+    }
+    //not picked up by a worker yet: drop it right away
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto queued = std::find(queue_.begin(), queue_.end(), asset);
+        if (queued != queue_.end()) {
+            queue_.erase(queued);
+            pending_--;
+            assets_.erase(handle);
+            return;
+        }
+    }
+    asset->released = true;
+}
+
+void AssetStreamer::work() {
+    while (true) {
+        Asset* asset;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            asset = queue_.front();
+            queue_.pop_front();
+        }
+        asset->decoded = decode(*asset, options_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded_.push_back(asset);
+    }
+}
+
+//worker thread, no GL: everything ends up as PackedMeshData (or pixels) pointing into memory the asset owns
+bool AssetStreamer::decode(Asset& asset, const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+    std::string extension = extensionOf(asset.path);
+    bool ok = false;
+
+    if (extension == ".mmsh") {
+        ok = asset.meshFile.Open(asset.path);
+        if (ok) {
+            asset.parts.emplace_back();
+            asset.meshFile.PackedData(asset.parts.back());
+        }
+    } else if (extension == ".obj" || extension == ".ply") {
+        //the pool already spreads whole files over the cores
+        MeshImporter::Options importOptions;
+        importOptions.threads = 1;
+        MeshImporter::Result& result = asset.imported;
+        ok = MeshImporter::Load(asset.path, result, importOptions);
+        std::size_t stride = result.layout.SourceFloats();
+        std::size_t vertexCount = ok ? result.vertices.size() / stride : 0;
+        ok = ok && vertexCount > 0 && !result.indices.empty();
+        if (ok) {
+            //the same passes Mesh runs, here they happen off the render thread
+            if (options.optimize) {
+                std::vector<std::size_t> clusters;
+                MeshOptimizer::OptimizeVertexCache(result.indices, vertexCount, 16, &clusters);
+                MeshOptimizer::OptimizeOverdraw(result.indices, result.vertices, stride, clusters);
+                vertexCount = MeshOptimizer::OptimizeVertexFetch(result.vertices, stride, result.indices);
+            }
+
+            PackedMeshData data;
+            data.layout = result.layout;
+            data.streams[0] = result.vertices.data();
+            data.streamBytes[0] = vertexCount * stride * sizeof(float);
+            data.vertexCount = vertexCount;
+            data.indexCount = result.indices.size();
+            if (vertexCount <= 0xFFFF) {
+                asset.shortIndices.assign(result.indices.begin(), result.indices.end());
+                data.indices = asset.shortIndices.data();
+                data.indexBytes = asset.shortIndices.size() * sizeof(uint16_t);
+                data.indexType = GL_UNSIGNED_SHORT;
+            } else {
+                data.indices = result.indices.data();
+                data.indexBytes = result.indices.size() * sizeof(unsigned int);
+                data.indexType = GL_UNSIGNED_INT;
+            }
+            for (int c = 0; c < 3; ++c) {
+                data.boundsMin[c] = data.boundsMax[c] = result.vertices[c];
+            }
+            for (std::size_t v = 1; v < vertexCount; ++v) {
+                const float* position = &result.vertices[v * stride];
+                for (int c = 0; c < 3; ++c) {
+                    data.boundsMin[c] = std::min(data.boundsMin[c], position[c]);
+                    data.boundsMax[c] = std::max(data.boundsMax[c], position[c]);
+                }
+            }
+            asset.parts.push_back(data);
+        }
+    } else if (extension == ".glb" || extension == ".gltf") {
+        ok = GltfLoader::Load(asset.path, asset.scene);
+        for (const GltfPrimitive& primitive : asset.scene.primitives) {
+            asset.parts.push_back(primitive.data);
+        }
+    } else if (extension == ".ppm") {
+        ok = asset.file.Open(asset.path) && parsePPM(asset.file.Data(), asset.file.Size(), asset.width, asset.height, asset.pixels);
+        if (asset.file.IsOpen() && !ok) {
+            std::cout << "ERROR: UNSUPPORTED PPM: " << asset.path << std::endl;
+        }
+    }
+
+    asset.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+//creates the (empty) GL objects and lists what has to be copied into them
+bool AssetStreamer::beginUpload(Asset& asset) {
+    asset.state = State::Uploading;
+    GLState& state = GLState::Get();
+
+    if (asset.kind == Kind::Texture) {
+        glGenTextures(1, &asset.texture);
+        state.BindTexture(0, GL_TEXTURE_2D, asset.texture);
+        //with an unpack buffer bound the null would be read as an offset into it
+        state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, asset.width, asset.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return true;
+    }
+
+    for (const PackedMeshData& part : asset.parts) {
+        for (int stream = 0; stream < part.layout.StreamCount(); ++stream) {
+            if (part.streamBytes[stream] == 0) {
+                return false;
+            }
+        }
+        if (part.indexBytes == 0) {
+            return false;
+        }
+
+        //same buffers as a direct upload, only without contents yet
+        PackedMeshData empty = part;
+        for (const void*& stream : empty.streams) {
+            stream = nullptr;
+        }
+        empty.indices = nullptr;
+        asset.meshes.push_back(std::make_unique<Mesh>(empty));
+        const Mesh& mesh = *asset.meshes.back();
+
+        for (int stream = 0; stream < part.layout.StreamCount(); ++stream) {
+            asset.copies.push_back({ (const unsigned char*)part.streams[stream], part.streamBytes[stream], mesh.VertexBuffer(stream) });
+        }
+        asset.copies.push_back({ (const unsigned char*)part.indices, part.indexBytes, mesh.ElementBuffer() });
+    }
+    return true;
+}
+
+//every copy is issued: fence it and let go of the decoded data
+void AssetStreamer::finishUpload(Asset& asset) {
+    if (asset.kind == Kind::Texture) {
+        GLState::Get().BindTexture(0, GL_TEXTURE_2D, asset.texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    asset.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fenced_.push_back(&asset);
+
+    asset.parts.clear();
+    std::vector<Copy>().swap(asset.copies);
+    asset.imported = MeshImporter::Result();
+    std::vector<uint16_t>().swap(asset.shortIndices);
+    asset.meshFile.Close();
+    asset.file.Close();
+    asset.pixels = nullptr;
+    //nodes and bounds stay for GetScene
+    asset.scene.files.clear();
+    asset.scene.convertedBuffers.clear();
+}
+
+//the asset is done one way or the other, `asset` is gone afterwards if it was released meanwhile
+void AssetStreamer::land(Asset& asset, bool ready) {
+    pending_--;
+    if (asset.released) {
+        Handle handle = asset.handle;
+        destroy(asset);
+        assets_.erase(handle);
+        return;
+    }
+    if (ready) {
+        asset.state = State::Ready;
+        stats_.ready++;
+    } else {
+        destroy(asset);
+        asset.state = State::Failed;
+        stats_.failed++;
+    }
+}
+
+void AssetStreamer::destroy(Asset& asset) {
+    if (asset.fence) {
+        glDeleteSync(asset.fence);
+        asset.fence = nullptr;
+    }
+    GLState::Get().DeleteTexture(asset.texture);
+    asset.texture = 0;
+    asset.meshes.clear();
+}
+
+void AssetStreamer::Update() {
+    auto start = std::chrono::steady_clock::now();
+
+    //uploads the GPU has finished
+    for (std::size_t i = 0; i < fenced_.size();) {
+        Asset* asset = fenced_[i];
+        GLenum result = glClientWaitSync(asset->fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            ++i;
+            continue;
+        }
+        glDeleteSync(asset->fence);
+        asset->fence = nullptr;
+        fenced_[i] = fenced_.back();
+        fenced_.pop_back();
+        land(*asset, result != GL_WAIT_FAILED);
+    }
+
+    //what the workers are done with
+    std::vector<Asset*> decoded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded.swap(decoded_);
+    }
+    for (Asset* asset : decoded) {
+        stats_.decodeMs += asset->decodeMs;
+        if (asset->decoded && !asset->released) {
+            uploads_.push_back(asset);
+            continue;
+        }
+        if (!asset->decoded) {
+            std::cout << "ERROR: ASSET STREAMER COULD NOT LOAD: " << asset->path << std::endl;
+        }
+        land(*asset, false);
+    }
+
+    //this frame's share: copy into the staging ring until the budget is used up
+    struct Staged {
+        GLintptr offset;
+        std::size_t bytes;
+        GLuint buffer;
+        std::size_t destination;
+        const Asset* texture;       //rows [row, row + rows) of a texture instead of a buffer copy
+        int row, rows;
+    };
+    std::vector<Staged> staged;
+    std::vector<Asset*> completed;
+    std::size_t budget = staging_.FrameCapacity();
+    std::size_t used = 0;
+    staging_.BeginFrame();
+
+    while (!uploads_.empty() && used < budget) {
+        Asset* asset = uploads_.front();
+        if (asset->released || (asset->state == State::Queued && !beginUpload(*asset))) {
+            uploads_.pop_front();
+            land(*asset, false);
+            continue;
+        }
+
+        bool done;
+        if (asset->kind == Kind::Texture) {
+            std::size_t rowBytes = (std::size_t)asset->width * 3;
+            int rows = (int)std::min<std::size_t>((budget - used) / rowBytes, (std::size_t)(asset->height - asset->nextRow));
+            if (rows == 0) {
+                if (used > 0) {
+                    break;
+                }
+                std::cout << "ERROR: ASSET STREAMER TEXTURE ROW LARGER THAN THE UPLOAD BUDGET: " << asset->path << std::endl;
+                uploads_.pop_front();
+                land(*asset, false);
+                continue;
+            }
+            std::size_t bytes = rows * rowBytes;
+            RingBuffer::Allocation allocation = staging_.Allocate(bytes, 1);
+            if (!allocation.data) {
+                break;
+            }
+            std::memcpy(allocation.data, asset->pixels + asset->nextRow * rowBytes, bytes);
+            staged.push_back({ allocation.offset, bytes, 0, 0, asset, asset->nextRow, rows });
+            asset->nextRow += rows;
+            used += bytes;
+            done = asset->nextRow == asset->height;
+        } else {
+            const Copy& copy = asset->copies[asset->nextCopy];
+            std::size_t bytes = std::min(copy.bytes - asset->copyOffset, budget - used);
+            RingBuffer::Allocation allocation = staging_.Allocate(bytes, 1);
+            if (!allocation.data) {
+                break;
+            }
+            std::memcpy(allocation.data, copy.source + asset->copyOffset, bytes);
+            staged.push_back({ allocation.offset, bytes, copy.buffer, asset->copyOffset, nullptr, 0, 0 });
+            asset->copyOffset += bytes;
+            used += bytes;
+            if (asset->copyOffset == copy.bytes) {
+                asset->nextCopy++;
+                asset->copyOffset = 0;
+            }
+            done = asset->nextCopy == asset->copies.size();
+        }
+        if (done) {
+            uploads_.pop_front();
+            completed.push_back(asset);
+        }
+    }
+    staging_.Flush();
+
+    //the GPU moves the staged bytes into place, the ring's fence keeps the region until it has
+    if (!staged.empty()) {
+        GLState& state = GLState::Get();
+        state.BindBuffer(GL_COPY_READ_BUFFER, staging_.Buffer());
+        for (const Staged& copy : staged) {
+            if (copy.texture) {
+                state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_.Buffer());
+                state.BindTexture(0, GL_TEXTURE_2D, copy.texture->texture);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, copy.row, copy.texture->width, copy.rows, GL_RGB, GL_UNSIGNED_BYTE,
+                                (const void*)copy.offset);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            } else {
+                state.BindBuffer(GL_COPY_WRITE_BUFFER, copy.buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, copy.offset, (GLintptr)copy.destination,
+                                    (GLsizeiptr)copy.bytes);
+            }
+        }
+        state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    for (Asset* asset : completed) {
+        finishUpload(*asset);
+    }
+    staging_.EndFrame();
+    if (!completed.empty()) {
+        //so the fences signal without waiting for a swap or a readback
+        glFlush();
+    }
+
+    stats_.bytesUploaded += used;
+    stats_.maxFrameBytes = std::max(stats_.maxFrameBytes, used);
+    stats_.maxUpdateMs = std::max(stats_.maxUpdateMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void AssetStreamer::Finish() {
+    while (pending_ > 0) {
+        Update();
+        if (pending_ > 0 && uploads_.empty()) {
+            //waiting on workers or fences, nothing to stage
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+AssetStreamer::Asset* AssetStreamer::find(Handle handle) const {
+    auto asset = assets_.find(handle);
+    return asset == assets_.end() ? nullptr : asset->second.get();
+}
+
+AssetStreamer::State AssetStreamer::GetState(Handle handle) const {
+    Asset* asset = find(handle);
+    return asset ? asset->state : State::Failed;
+}
+
+Mesh* AssetStreamer::GetMesh(Handle handle, std::size_t index) const {
+    Asset* asset = find(handle);
+    if (!asset || asset->state != State::Ready || index >= asset->meshes.size()) {
+        return nullptr;
+    }
+    return asset->meshes[index].get();
+}
+
+std::vector<Mesh*> AssetStreamer::GetMeshes(Handle handle) const {
+    std::vector<Mesh*> meshes;
+    Asset* asset = find(handle);
+    if (asset && asset->state == State::Ready) {
+        for (const std::unique_ptr<Mesh>& mesh : asset->meshes) {
+            meshes.push_back(mesh.get());
+        }
+    }
+    return meshes;
+}
+
+GLuint AssetStreamer::GetTexture(Handle handle) const {
+    Asset* asset = find(handle);
+    return asset && asset->state == State::Ready ? asset->texture : 0;
+}
+
+const GltfScene* AssetStreamer::GetScene(Handle handle) const {
+    Asset* asset = find(handle);
+    return asset && asset->state == State::Ready && asset->kind == Kind::Scene ? &asset->scene : nullptr;
+}
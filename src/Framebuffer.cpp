@@ -0,0 +1,82 @@
+#include "Framebuffer.h"
+#include "GLState.h"
+#include <cstdio>
+#include <iostream>
+
+Framebuffer::~Framebuffer() {
+    Destroy();
+}
+
+bool Framebuffer::Create(int width, int height) {
+    Destroy();
+    width_ = width;
+    height_ = height;
+
+    glGenRenderbuffers(1, &colorRBO_);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depthRBO_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &FBO_);
+    GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO_);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR: FRAMEBUFFER INCOMPLETE" << std::endl;
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void Framebuffer::Destroy() {
+    GLState::Get().DeleteFramebuffer(FBO_);
+    if (colorRBO_) {
+        glDeleteRenderbuffers(1, &colorRBO_);
+    }
+    if (depthRBO_) {
+        glDeleteRenderbuffers(1, &depthRBO_);
+    }
+    FBO_ = colorRBO_ = depthRBO_ = 0;
+}
+
+void Framebuffer::Bind() const {
+    GLState& state = GLState::Get();
+    state.BindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    state.Viewport(0, 0, width_, height_);
+}
+
+void Framebuffer::ReadPixels(std::vector<unsigned char>& pixels) const {
+    pixels.resize((std::size_t)width_ * height_ * 4);
+    GLState::Get().BindFramebuffer(GL_READ_FRAMEBUFFER, FBO_);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    //rows are tightly packed, default alignment of 4 is fine for RGBA8
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+bool Framebuffer::WritePPM(const std::string& path, const std::vector<unsigned char>& pixels) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR: COULD NOT OPEN " << path << std::endl;
+        return false;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", width_, height_);
+
+    //GL returns the bottom row first, PPM wants the top row first, also drop alpha
+    std::vector<unsigned char> row((std::size_t)width_ * 3);
+    for (int y = height_ - 1; y >= 0; --y) {
+        const unsigned char* src = pixels.data() + (std::size_t)y * width_ * 4;
+        for (int x = 0; x < width_; ++x) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    std::fclose(file);
+    return true;
+}
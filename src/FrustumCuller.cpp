@@ -0,0 +1,74 @@
+#include "FrustumCuller.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include <algorithm>
+#include <chrono>
+
+FrustumCuller::~FrustumCuller() {
+    Destroy();
+}
+
+bool FrustumCuller::Create(const Options& options) {
+    Destroy();
+    options_ = options;
+    return pool_.Create(options_.threads);
+}
+
+void FrustumCuller::Destroy() {
+    pool_.Destroy();
+}
+
+const std::vector<uint32_t>& FrustumCuller::Cull(const Frustum& frustum, const std::vector<Object3D>& objects) {
+    std::size_t count = objects.size();
+    bounds_.resize(count * 6);
+    float* centerX = bounds_.data();
+    float* centerY = centerX + count;
+    float* centerZ = centerY + count;
+    float* extentX = centerZ + count;
+    float* extentY = extentX + count;
+    float* extentZ = extentY + count;
+    std::function<std::size_t(std::size_t, std::size_t, uint32_t*)> chunk = [&](std::size_t begin, std::size_t end, uint32_t* out) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const Mesh* mesh = objects[i].GetMesh();
+            AABB box = Transform(Mat4(objects[i].Transform()), AABB(Vec3(mesh->BoundsMin()), Vec3(mesh->BoundsMax())));
+            Vec3 center = box.Center(), extents = box.Extents();
+            centerX[i] = center.x; centerY[i] = center.y; centerZ[i] = center.z;
+            extentX[i] = extents.x; extentY[i] = extents.y; extentZ[i] = extents.z;
+        }
+        return SimdMath::CullBoxes(frustum, centerX + begin, centerY + begin, centerZ + begin, extentX + begin, extentY + begin,
+                                   extentZ + begin, end - begin, out, (uint32_t)begin);
+    };
+    run(count, chunk);
+    return visible_;
+}
+
+const std::vector<uint32_t>& FrustumCuller::CullBoxes(const Frustum& frustum, const float* centerX, const float* centerY,
+                                                      const float* centerZ, const float* extentX, const float* extentY,
+                                                      const float* extentZ, std::size_t count) {
+    std::function<std::size_t(std::size_t, std::size_t, uint32_t*)> chunk = [&](std::size_t begin, std::size_t end, uint32_t* out) {
+        return SimdMath::CullBoxes(frustum, centerX + begin, centerY + begin, centerZ + begin, extentX + begin, extentY + begin,
+                                   extentZ + begin, end - begin, out, (uint32_t)begin);
+    };
+    run(count, chunk);
+    return visible_;
+}
+
+const std::vector<uint32_t>& FrustumCuller::CullSpheres(const Frustum& frustum, const float* centerX, const float* centerY,
+                                                        const float* centerZ, const float* radius, std::size_t count) {
+    std::function<std::size_t(std::size_t, std::size_t, uint32_t*)> chunk = [&](std::size_t begin, std::size_t end, uint32_t* out) {
+        return SimdMath::CullSpheres(frustum, centerX + begin, centerY + begin, centerZ + begin, radius + begin, end - begin,
+                                     out, (uint32_t)begin);
+    };
+    run(count, chunk);
+    return visible_;
+}
+
+void FrustumCuller::run(std::size_t total, const std::function<std::size_t(std::size_t, std::size_t, uint32_t*)>& chunk) {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t chunkSize = std::max<std::size_t>(options_.chunkSize, 1);
+    stats_.threads = pool_.Filter(total, chunkSize, chunk, visible_);
+    stats_.tested = total;
+    stats_.visible = visible_.size();
+    stats_.chunks = (total + chunkSize - 1) / chunkSize;
+    stats_.cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,89 @@
+#include "GLExtensions.h"
+#include <cstring>
+
+int GLEXT_ARB_get_program_binary = 0;
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = NULL;
+
+int GLEXT_KHR_parallel_shader_compile = 0;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = NULL;
+
+int GLEXT_ARB_buffer_storage = 0;
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = NULL;
+
+int GLEXT_ARB_compute_shader = 0;
+int GLEXT_ARB_shader_storage_buffer_object = 0;
+int GLEXT_ARB_multi_draw_indirect = 0;
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = NULL;
+
+int GLEXT_ARB_shader_image_load_store = 0;
+PFNGLBINDIMAGETEXTUREPROC glext_glBindImageTexture = NULL;
+
+bool hasGLVersion(int major, int minor)
+{
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void loadGLExtensions(GLADloadproc load)
+{
+    //program binaries: core in 4.1, the ARB extension exposes the same unsuffixed entry points
+    GLEXT_ARB_get_program_binary = hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary");
+    if (GLEXT_ARB_get_program_binary) {
+        glext_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        glext_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+        GLEXT_ARB_get_program_binary = glext_glGetProgramBinary && glext_glProgramBinary && glext_glProgramParameteri;
+    }
+
+    //parallel compile: KHR and ARB share GL_COMPLETION_STATUS, only the thread count entry point is suffixed
+    if (hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    } else if (hasGLExtension("GL_ARB_parallel_shader_compile")) {
+        glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    }
+    GLEXT_KHR_parallel_shader_compile = glext_glMaxShaderCompilerThreadsKHR != NULL;
+
+    //immutable storage, needed for persistent mapping
+    if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) {
+        glext_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+    }
+    GLEXT_ARB_buffer_storage = glext_glBufferStorage != NULL;
+
+    //GPU driven culling, glMemoryBarrier comes with image load / store (4.2) which every compute capable driver has
+    bool core43 = hasGLVersion(4, 3);
+    if (core43 || hasGLExtension("GL_ARB_compute_shader")) {
+        glext_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+        glext_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+    }
+    GLEXT_ARB_compute_shader = glext_glDispatchCompute && glext_glMemoryBarrier;
+    GLEXT_ARB_shader_storage_buffer_object = core43 || hasGLExtension("GL_ARB_shader_storage_buffer_object");
+    if (core43 || hasGLExtension("GL_ARB_multi_draw_indirect")) {
+        glext_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    }
+    GLEXT_ARB_multi_draw_indirect = glext_glMultiDrawElementsIndirect != NULL;
+
+    //depth pyramids for occlusion culling are written level by level through image stores
+    if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_shader_image_load_store")) {
+        glext_glBindImageTexture = (PFNGLBINDIMAGETEXTUREPROC)load("glBindImageTexture");
+    }
+    GLEXT_ARB_shader_image_load_store = glext_glBindImageTexture != NULL;
+}
@@ -0,0 +1,317 @@
+#include "GLState.h"
+
+//buffer targets the cache knows about, anything else is passed straight through
+static const GLenum kBufferTargetList[] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_UNIFORM_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_TEXTURE_BUFFER,
+    0x8F3F,     //GL_DRAW_INDIRECT_BUFFER (4.0)
+    0x90D2,     //GL_SHADER_STORAGE_BUFFER (4.3)
+};
+
+static const GLenum kTextureTargetList[] = {
+    GL_TEXTURE_2D,
+    GL_TEXTURE_2D_ARRAY,
+    GL_TEXTURE_CUBE_MAP,
+    GL_TEXTURE_3D,
+};
+
+std::size_t GLState::Counters::TotalIssued() const {
+    std::size_t total = 0;
+    for (std::size_t count : issued) {
+        total += count;
+    }
+    return total;
+}
+
+std::size_t GLState::Counters::TotalElided() const {
+    std::size_t total = 0;
+    for (std::size_t count : elided) {
+        total += count;
+    }
+    return total;
+}
+
+GLState& GLState::Get() {
+    static thread_local GLState state;
+    return state;
+}
+
+void GLState::Invalidate() {
+    program_ = VAO_ = kUnknown;
+    for (GLuint& buffer : buffers_) {
+        buffer = kUnknown;
+    }
+    for (auto& unit : textures_) {
+        for (GLuint& texture : unit) {
+            texture = kUnknown;
+        }
+    }
+    activeUnit_ = kUnknown;
+    drawFramebuffer_ = readFramebuffer_ = kUnknown;
+    viewport_[0] = viewport_[1] = viewport_[2] = viewport_[3] = -1;
+    blend_ = depthTest_ = cullFace_ = depthMask_ = Unknown;
+    blendSource_ = blendDestination_ = depthFunc_ = cullMode_ = kUnknown;
+}
+
+bool GLState::issue(Category category, bool changed) {
+    if (changed) {
+        counters_.issued[(int)category]++;
+    } else {
+        counters_.elided[(int)category]++;
+    }
+    return changed;
+}
+
+bool GLState::UseProgram(GLuint program) {
+    if (!issue(Category::Program, program != program_)) {
+        return false;
+    }
+    glUseProgram(program);
+    program_ = program;
+    return true;
+}
+
+bool GLState::BindVertexArray(GLuint VAO) {
+    if (!issue(Category::VertexArray, VAO != VAO_)) {
+        return false;
+    }
+    glBindVertexArray(VAO);
+    VAO_ = VAO;
+    //the element buffer binding lives in the VAO, we don't know what the new one has
+    buffers_[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+    return true;
+}
+
+bool GLState::BindBuffer(GLenum target, GLuint buffer) {
+    int index = bufferTargetIndex(target);
+    if (index < 0) {
+        issue(Category::Buffer, true);
+        glBindBuffer(target, buffer);
+        return true;
+    }
+    if (!issue(Category::Buffer, buffers_[index] != buffer)) {
+        return false;
+    }
+    glBindBuffer(target, buffer);
+    buffers_[index] = buffer;
+    return true;
+}
+
+bool GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    issue(Category::Buffer, true);
+    glBindBufferBase(target, index, buffer);
+    int slot = bufferTargetIndex(target);
+    if (slot >= 0) {
+        buffers_[slot] = buffer;
+    }
+    return true;
+}
+
+bool GLState::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+    int index = textureTargetIndex(target);
+    if (index < 0 || unit >= (GLuint)kTextureUnits) {
+        issue(Category::Texture, true);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        activeUnit_ = unit;
+        return true;
+    }
+    if (!issue(Category::Texture, textures_[unit][index] != texture)) {
+        return false;
+    }
+    if (activeUnit_ != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit_ = unit;
+    }
+    glBindTexture(target, texture);
+    textures_[unit][index] = texture;
+    return true;
+}
+
+bool GLState::BindFramebuffer(GLenum target, GLuint framebuffer) {
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    bool changed = (draw && drawFramebuffer_ != framebuffer) || (read && readFramebuffer_ != framebuffer);
+    if (!issue(Category::Framebuffer, changed)) {
+        return false;
+    }
+    glBindFramebuffer(target, framebuffer);
+    if (draw) {
+        drawFramebuffer_ = framebuffer;
+    }
+    if (read) {
+        readFramebuffer_ = framebuffer;
+    }
+    return true;
+}
+
+bool GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    bool changed = viewport_[0] != x || viewport_[1] != y || viewport_[2] != width || viewport_[3] != height;
+    if (!issue(Category::Viewport, changed)) {
+        return false;
+    }
+    glViewport(x, y, width, height);
+    viewport_[0] = x;
+    viewport_[1] = y;
+    viewport_[2] = width;
+    viewport_[3] = height;
+    return true;
+}
+
+bool GLState::setCapability(GLenum capability, Tristate& cached, bool enabled) {
+    Tristate wanted = enabled ? On : Off;
+    if (!issue(Category::Capability, cached != wanted)) {
+        return false;
+    }
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+    cached = wanted;
+    return true;
+}
+
+bool GLState::SetBlend(bool enabled) {
+    return setCapability(GL_BLEND, blend_, enabled);
+}
+
+bool GLState::SetDepthTest(bool enabled) {
+    return setCapability(GL_DEPTH_TEST, depthTest_, enabled);
+}
+
+bool GLState::SetCullFace(bool enabled) {
+    return setCapability(GL_CULL_FACE, cullFace_, enabled);
+}
+
+bool GLState::BlendFunc(GLenum source, GLenum destination) {
+    if (!issue(Category::BlendFunc, source != blendSource_ || destination != blendDestination_)) {
+        return false;
+    }
+    glBlendFunc(source, destination);
+    blendSource_ = source;
+    blendDestination_ = destination;
+    return true;
+}
+
+bool GLState::DepthFunc(GLenum function) {
+    if (!issue(Category::DepthFunc, function != depthFunc_)) {
+        return false;
+    }
+    glDepthFunc(function);
+    depthFunc_ = function;
+    return true;
+}
+
+bool GLState::DepthMask(bool write) {
+    Tristate wanted = write ? On : Off;
+    if (!issue(Category::DepthMask, depthMask_ != wanted)) {
+        return false;
+    }
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+    depthMask_ = wanted;
+    return true;
+}
+
+bool GLState::CullFace(GLenum face) {
+    if (!issue(Category::CullFace, face != cullMode_)) {
+        return false;
+    }
+    glCullFace(face);
+    cullMode_ = face;
+    return true;
+}
+
+void GLState::DeleteProgram(GLuint program) {
+    if (!program) {
+        return;
+    }
+    glDeleteProgram(program);
+    //a deleted program stays in use until another one is bound, but its name may be recycled
+    if (program_ == program) {
+        program_ = kUnknown;
+    }
+}
+
+void GLState::DeleteVertexArray(GLuint VAO) {
+    if (!VAO) {
+        return;
+    }
+    glDeleteVertexArrays(1, &VAO);
+    if (VAO_ == VAO) {
+        //deleting the bound VAO reverts the binding to 0
+        VAO_ = 0;
+        buffers_[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = kUnknown;
+    }
+}
+
+void GLState::DeleteBuffer(GLuint buffer) {
+    if (!buffer) {
+        return;
+    }
+    glDeleteBuffers(1, &buffer);
+    for (GLuint& bound : buffers_) {
+        if (bound == buffer) {
+            bound = 0;
+        }
+    }
+}
+
+void GLState::DeleteTexture(GLuint texture) {
+    if (!texture) {
+        return;
+    }
+    glDeleteTextures(1, &texture);
+    for (auto& unit : textures_) {
+        for (GLuint& bound : unit) {
+            if (bound == texture) {
+                bound = 0;
+            }
+        }
+    }
+}
+
+void GLState::DeleteFramebuffer(GLuint framebuffer) {
+    if (!framebuffer) {
+        return;
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    if (drawFramebuffer_ == framebuffer) {
+        drawFramebuffer_ = 0;
+    }
+    if (readFramebuffer_ == framebuffer) {
+        readFramebuffer_ = 0;
+    }
+}
+
+int GLState::bufferTargetIndex(GLenum target) {
+    for (int i = 0; i < kBufferTargets; ++i) {
+        if (kBufferTargetList[i] == target) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int GLState::textureTargetIndex(GLenum target) {
+    for (int i = 0; i < kTextureTargets; ++i) {
+        if (kTextureTargetList[i] == target) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* GLState::CategoryName(Category category) {
+    static const char* names[(int)Category::CategoryCount] = {
+        "program", "vertex_array", "buffer", "texture", "capability", "blend_func",
+        "depth_func", "depth_mask", "cull_face", "framebuffer", "viewport"
+    };
+    return category < Category::CategoryCount ? names[(int)category] : "unknown";
+}
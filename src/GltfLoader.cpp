@@ -0,0 +1,821 @@
+#include "GltfLoader.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+//--------------------------------------------------JSON----------------------------------------------------------------------
+
+    //just enough JSON for glTF: the document is parsed into a tree once, lookups of missing keys return null
+    struct JsonValue {
+        enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> items;
+        std::vector<std::pair<std::string, JsonValue>> members;
+
+        const JsonValue& operator[](const char* key) const;
+        const JsonValue& operator[](std::size_t index) const { return index < items.size() ? items[index] : null(); }
+        const JsonValue& operator[](int index) const { return index < 0 ? null() : (*this)[(std::size_t)index]; }
+        std::size_t Size() const { return items.size(); }
+        bool IsNull() const { return type == Null; }
+        double AsNumber(double fallback = 0.0) const { return type == Number ? number : fallback; }
+        long long AsInteger(long long fallback = -1) const { return type == Number && std::fabs(number) < 9.0e15 ? (long long)number : fallback; }
+
+        static const JsonValue& null() {
+            static const JsonValue value;
+            return value;
+        }
+    };
+
+    const JsonValue& JsonValue::operator[](const char* key) const {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return member.second;
+            }
+        }
+        return null();
+    }
+
+    class JsonParser {
+        public:
+            JsonParser(const char* data, std::size_t size) : p_(data), end_(data + size) {}
+
+            bool Parse(JsonValue& value) {
+                return parseValue(value, 0) && (skipSpaces(), p_ == end_);
+            }
+
+        private:
+            static const int kMaxDepth = 64;
+
+            void skipSpaces() {
+                while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+                    ++p_;
+                }
+            }
+
+            bool literal(const char* word) {
+                std::size_t length = std::strlen(word);
+                if ((std::size_t)(end_ - p_) < length || std::memcmp(p_, word, length) != 0) {
+                    return false;
+                }
+                p_ += length;
+                return true;
+            }
+
+            bool parseValue(JsonValue& value, int depth) {
+                skipSpaces();
+                if (p_ >= end_ || depth > kMaxDepth) {
+                    return false;
+                }
+                switch (*p_) {
+                    case '{': return parseObject(value, depth);
+                    case '[': return parseArray(value, depth);
+                    case '"': value.type = JsonValue::String; return parseString(value.string);
+                    case 't': value.type = JsonValue::Bool; value.boolean = true; return literal("true");
+                    case 'f': value.type = JsonValue::Bool; value.boolean = false; return literal("false");
+                    case 'n': value.type = JsonValue::Null; return literal("null");
+                    default: break;
+                }
+                value.type = JsonValue::Number;
+                std::from_chars_result result = std::from_chars(p_, end_, value.number);
+                if (result.ec != std::errc()) {
+                    return false;
+                }
+                p_ = result.ptr;
+                return true;
+            }
+
+            bool parseObject(JsonValue& value, int depth) {
+                value.type = JsonValue::Object;
+                ++p_;
+                skipSpaces();
+                if (p_ < end_ && *p_ == '}') {
+                    ++p_;
+                    return true;
+                }
+                while (true) {
+                    skipSpaces();
+                    std::pair<std::string, JsonValue> member;
+                    if (p_ >= end_ || *p_ != '"' || !parseString(member.first)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (p_ >= end_ || *p_++ != ':' || !parseValue(member.second, depth + 1)) {
+                        return false;
+                    }
+                    value.members.push_back(std::move(member));
+                    skipSpaces();
+                    if (p_ < end_ && *p_ == ',') {
+                        ++p_;
+                    } else {
+                        return p_ < end_ && *p_++ == '}';
+                    }
+                }
+            }
+
+            bool parseArray(JsonValue& value, int depth) {
+                value.type = JsonValue::Array;
+                ++p_;
+                skipSpaces();
+                if (p_ < end_ && *p_ == ']') {
+                    ++p_;
+                    return true;
+                }
+                while (true) {
+                    value.items.emplace_back();
+                    if (!parseValue(value.items.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (p_ < end_ && *p_ == ',') {
+                        ++p_;
+                    } else {
+                        return p_ < end_ && *p_++ == ']';
+                    }
+                }
+            }
+
+            bool parseString(std::string& string) {
+                ++p_;
+                while (p_ < end_ && *p_ != '"') {
+                    char c = *p_++;
+                    if (c != '\\') {
+                        string += c;
+                        continue;
+                    }
+                    if (p_ >= end_) {
+                        return false;
+                    }
+                    c = *p_++;
+                    switch (c) {
+                        case 'b': string += '\b'; break;
+                        case 'f': string += '\f'; break;
+                        case 'n': string += '\n'; break;
+                        case 'r': string += '\r'; break;
+                        case 't': string += '\t'; break;
+                        case 'u': {
+                            //names and uris only, encode the code unit as utf-8 (surrogate pairs are kept as two)
+                            unsigned int code = 0;
+                            if (end_ - p_ < 4 || std::from_chars(p_, p_ + 4, code, 16).ptr != p_ + 4) {
+                                return false;
+                            }
+                            p_ += 4;
+                            if (code < 0x80) {
+                                string += (char)code;
+                            } else if (code < 0x800) {
+                                string += (char)(0xC0 | (code >> 6));
+                                string += (char)(0x80 | (code & 0x3F));
+                            } else {
+                                string += (char)(0xE0 | (code >> 12));
+                                string += (char)(0x80 | ((code >> 6) & 0x3F));
+                                string += (char)(0x80 | (code & 0x3F));
+                            }
+                            break;
+                        }
+                        default: string += c; break;
+                    }
+                }
+                if (p_ >= end_) {
+                    return false;
+                }
+                ++p_;
+                return true;
+            }
+
+            const char* p_;
+            const char* end_;
+    };
+
+//--------------------------------------------------ACCESSORS----------------------------------------------------------------------
+
+    struct Buffer {
+        const unsigned char* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    //an accessor resolved down to its bytes
+    struct Accessor {
+        const unsigned char* data = nullptr;    //first element
+        std::size_t count = 0;
+        std::size_t stride = 0;
+        std::size_t elementSize = 0;
+        std::size_t offset = 0;                 //accessor.byteOffset, inside the bufferView
+        std::size_t available = 0;              //bytes from `data` to the end of the buffer
+        int bufferView = -1;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+        const JsonValue* json = nullptr;
+    };
+
+    const int kByte = 5120, kUnsignedByte = 5121, kShort = 5122, kUnsignedShort = 5123, kUnsignedInt = 5125, kFloat = 5126;
+
+    std::size_t componentSize(int componentType)
+    {
+        switch (componentType) {
+            case kByte: case kUnsignedByte: return 1;
+            case kShort: case kUnsignedShort: return 2;
+            case kUnsignedInt: case kFloat: return 4;
+            default: return 0;
+        }
+    }
+
+    int componentCount(const std::string& type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    bool resolveAccessor(const JsonValue& gltf, long long index, const std::vector<Buffer>& buffers, Accessor& accessor)
+    {
+        const JsonValue& json = gltf["accessors"][(std::size_t)index];
+        if (index < 0 || json.IsNull() || !json["sparse"].IsNull()) {
+            return false;
+        }
+        accessor.json = &json;
+        accessor.componentType = (int)json["componentType"].AsInteger(0);
+        accessor.components = componentCount(json["type"].string);
+        accessor.count = (std::size_t)json["count"].AsInteger(0);
+        accessor.normalized = json["normalized"].boolean;
+        accessor.offset = (std::size_t)json["byteOffset"].AsInteger(0);
+        accessor.elementSize = componentSize(accessor.componentType) * accessor.components;
+        accessor.bufferView = (int)json["bufferView"].AsInteger(-1);
+        const JsonValue& view = gltf["bufferViews"][(std::size_t)accessor.bufferView];
+        if (accessor.elementSize == 0 || accessor.count == 0 || view.IsNull()) {
+            return false;
+        }
+        long long bufferIndex = view["buffer"].AsInteger(-1);
+        if (bufferIndex < 0 || (std::size_t)bufferIndex >= buffers.size()) {
+            return false;
+        }
+        const Buffer& buffer = buffers[(std::size_t)bufferIndex];
+        std::size_t viewOffset = (std::size_t)view["byteOffset"].AsInteger(0);
+        std::size_t viewLength = (std::size_t)view["byteLength"].AsInteger(0);
+        accessor.stride = (std::size_t)view["byteStride"].AsInteger(0);
+        if (accessor.stride == 0) {
+            accessor.stride = accessor.elementSize;
+        }
+        //written so nothing overflows on hostile counts
+        if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset || accessor.stride < accessor.elementSize ||
+            accessor.offset > viewLength || accessor.elementSize > viewLength - accessor.offset ||
+            accessor.count - 1 > (viewLength - accessor.offset - accessor.elementSize) / accessor.stride) {
+            return false;
+        }
+        accessor.data = buffer.data + viewOffset + accessor.offset;
+        accessor.available = buffer.size - viewOffset - accessor.offset;
+        return true;
+    }
+
+    //one component as the GPU would see it, normalized integers in [0, 1] / [-1, 1]
+    float readComponent(const Accessor& accessor, std::size_t element, int component)
+    {
+        const unsigned char* p = accessor.data + element * accessor.stride + component * componentSize(accessor.componentType);
+        bool normalized = accessor.normalized;
+        switch (accessor.componentType) {
+            case kByte: return normalized ? std::max(*(const int8_t*)p / 127.0f, -1.0f) : (float)*(const int8_t*)p;
+            case kUnsignedByte: return normalized ? *p / 255.0f : (float)*p;
+            case kShort: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+            case kUnsignedShort: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? v / 65535.0f : (float)v; }
+            case kUnsignedInt: { uint32_t v; std::memcpy(&v, p, 4); return (float)v; }
+            case kFloat: { float v; std::memcpy(&v, p, 4); return v; }
+            default: return 0.0f;
+        }
+    }
+
+    uint32_t readIndex(const Accessor& accessor, std::size_t element)
+    {
+        const unsigned char* p = accessor.data + element * accessor.stride;
+        switch (accessor.componentType) {
+            case kUnsignedByte: return *p;
+            case kUnsignedShort: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+            case kUnsignedInt: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+            default: return 0xFFFFFFFFu;
+        }
+    }
+
+    bool vertexFormat(int componentType, VertexFormat& format)
+    {
+        switch (componentType) {
+            case kByte: format = VertexFormat::Byte; return true;
+            case kUnsignedByte: format = VertexFormat::UByte; return true;
+            case kShort: format = VertexFormat::Short; return true;
+            case kUnsignedShort: format = VertexFormat::UShort; return true;
+            case kFloat: format = VertexFormat::Float; return true;
+            default: return false;
+        }
+    }
+
+//--------------------------------------------------PRIMITIVES----------------------------------------------------------------------
+
+    struct Attribute {
+        VertexSemantic semantic;
+        Accessor accessor;
+    };
+
+    //the file's bufferViews as vertex streams, false if any of them isn't laid out the way VertexLayout would
+    bool mapStreams(const std::vector<Attribute>& attributes, PackedMeshData& data)
+    {
+        //one stream per bufferView, the position's first
+        std::vector<std::vector<const Attribute*>> streams;
+        for (const Attribute& attribute : attributes) {
+            auto stream = std::find_if(streams.begin(), streams.end(), [&attribute](const std::vector<const Attribute*>& s) {
+                return s.front()->accessor.bufferView == attribute.accessor.bufferView;
+            });
+            if (stream == streams.end()) {
+                streams.push_back({ &attribute });
+            } else {
+                stream->push_back(&attribute);
+            }
+        }
+        if ((int)streams.size() > VertexLayout::kMaxStreams) {
+            return false;
+        }
+
+        VertexLayout layout;
+        for (std::size_t s = 0; s < streams.size(); ++s) {
+            std::vector<const Attribute*>& stream = streams[s];
+            std::sort(stream.begin(), stream.end(), [](const Attribute* a, const Attribute* b) { return a->accessor.offset < b->accessor.offset; });
+            const Accessor& first = stream.front()->accessor;
+            for (const Attribute* attribute : stream) {
+                const Accessor& accessor = attribute->accessor;
+                VertexFormat format;
+                if (!vertexFormat(accessor.componentType, format) || accessor.stride != first.stride) {
+                    return false;
+                }
+                layout.Add(attribute->semantic, format, accessor.components, accessor.normalized, (int)s);
+                if (layout.Attribute(layout.AttributeCount() - 1).offset != accessor.offset - first.offset) {
+                    return false;
+                }
+            }
+            //the stream is uploaded as a whole, the stride has to match and the last vertex has to be complete
+            std::size_t bytes = first.count * first.stride;
+            if (layout.Stride((int)s) != first.stride || bytes > first.available) {
+                return false;
+            }
+            data.streams[s] = first.data;
+            data.streamBytes[s] = bytes;
+        }
+        data.layout = layout;
+        return true;
+    }
+
+    //float vertices in a single stream, for primitives whose buffers can't be used as they are
+    void convertStreams(const std::vector<Attribute>& attributes, std::size_t vertexCount, PackedMeshData& data,
+                        std::vector<unsigned char>& storage)
+    {
+        VertexLayout layout;
+        for (const Attribute& attribute : attributes) {
+            layout.Add(attribute.semantic, VertexFormat::Float, attribute.accessor.components);
+        }
+        std::size_t stride = layout.SourceFloats();
+        storage.resize(vertexCount * stride * sizeof(float));
+        float* out = (float*)storage.data();
+        for (std::size_t v = 0; v < vertexCount; ++v) {
+            for (const Attribute& attribute : attributes) {
+                for (int c = 0; c < attribute.accessor.components; ++c) {
+                    *out++ = readComponent(attribute.accessor, v, c);
+                }
+            }
+        }
+        data.layout = layout;
+        for (int s = 0; s < VertexLayout::kMaxStreams; ++s) {
+            data.streams[s] = nullptr;
+            data.streamBytes[s] = 0;
+        }
+        data.streams[0] = storage.data();
+        data.streamBytes[0] = storage.size();
+    }
+
+    bool semanticFor(const std::string& name, VertexSemantic& semantic)
+    {
+        if (name == "POSITION") semantic = VertexSemantic::Position;
+        else if (name == "NORMAL") semantic = VertexSemantic::Normal;
+        else if (name == "TANGENT") semantic = VertexSemantic::Tangent;
+        else if (name == "TEXCOORD_0") semantic = VertexSemantic::TexCoord0;
+        else if (name == "TEXCOORD_1") semantic = VertexSemantic::TexCoord1;
+        else if (name == "COLOR_0") semantic = VertexSemantic::Color;
+        else return false;
+        return true;
+    }
+
+    //fills `primitive` for glTF mesh primitive `json`, false if it can't be drawn
+    bool loadPrimitive(const JsonValue& gltf, const JsonValue& json, const std::vector<Buffer>& buffers, GltfScene& scene,
+                       GltfPrimitive& primitive)
+    {
+        //triangles only, strips and fans are rare in exported files
+        if (json["mode"].AsInteger(4) != 4) {
+            return false;
+        }
+
+        std::vector<Attribute> attributes;
+        for (const auto& member : json["attributes"].members) {
+            Attribute attribute;
+            if (!semanticFor(member.first, attribute.semantic)) {
+                continue;
+            }
+            if (!resolveAccessor(gltf, member.second.AsInteger(), buffers, attribute.accessor)) {
+                return false;
+            }
+            attributes.push_back(attribute);
+        }
+        //position first, Mesh and the optimizers expect it there
+        std::stable_sort(attributes.begin(), attributes.end(), [](const Attribute& a, const Attribute& b) {
+            return a.semantic == VertexSemantic::Position && b.semantic != VertexSemantic::Position;
+        });
+        if (attributes.empty() || attributes.front().semantic != VertexSemantic::Position || attributes.front().accessor.components != 3) {
+            return false;
+        }
+        std::size_t vertexCount = attributes.front().accessor.count;
+        for (const Attribute& attribute : attributes) {
+            if (attribute.accessor.count != vertexCount) {
+                return false;
+            }
+        }
+
+        PackedMeshData& data = primitive.data;
+        data.vertexCount = vertexCount;
+        bool zeroCopy = mapStreams(attributes, data);
+        if (!zeroCopy) {
+            scene.convertedBuffers.emplace_back();
+            convertStreams(attributes, vertexCount, data, scene.convertedBuffers.back());
+        }
+
+        //indices: 16 and 32 bit ones are used as they are, after a range check
+        Accessor indices;
+        long long indexAccessor = json["indices"].AsInteger();
+        bool indexed = indexAccessor >= 0;
+        if (indexed && (!resolveAccessor(gltf, indexAccessor, buffers, indices) || indices.components != 1)) {
+            return false;
+        }
+        std::size_t indexCount = indexed ? indices.count : vertexCount;
+        if (indexed) {
+            for (std::size_t i = 0; i < indexCount; ++i) {
+                if (readIndex(indices, i) >= vertexCount) {
+                    return false;
+                }
+            }
+        }
+        bool directIndices = indexed && indices.stride == indices.elementSize &&
+                             (indices.componentType == kUnsignedShort || indices.componentType == kUnsignedInt);
+        if (directIndices) {
+            data.indices = indices.data;
+            data.indexBytes = indices.count * indices.elementSize;
+            data.indexType = indices.componentType == kUnsignedShort ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        } else {
+            //8 bit or missing indices, widen to the smallest type Mesh draws with
+            bool shortIndices = vertexCount <= 0xFFFF;
+            scene.convertedBuffers.emplace_back(indexCount * (shortIndices ? 2 : 4));
+            std::vector<unsigned char>& storage = scene.convertedBuffers.back();
+            for (std::size_t i = 0; i < indexCount; ++i) {
+                uint32_t index = indexed ? readIndex(indices, i) : (uint32_t)i;
+                if (shortIndices) {
+                    uint16_t value = (uint16_t)index;
+                    std::memcpy(&storage[i * 2], &value, 2);
+                } else {
+                    std::memcpy(&storage[i * 4], &index, 4);
+                }
+            }
+            data.indices = storage.data();
+            data.indexBytes = storage.size();
+            data.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        }
+        data.indexCount = indexCount;
+
+        //POSITION min / max are required for float positions, anything else is measured
+        const Accessor& positions = attributes.front().accessor;
+        const JsonValue& min = positions.json->operator[]("min");
+        const JsonValue& max = positions.json->operator[]("max");
+        if (positions.componentType == kFloat && min.Size() == 3 && max.Size() == 3) {
+            for (int c = 0; c < 3; ++c) {
+                data.boundsMin[c] = (float)min[c].AsNumber();
+                data.boundsMax[c] = (float)max[c].AsNumber();
+            }
+        } else {
+            for (int c = 0; c < 3; ++c) {
+                data.boundsMin[c] = data.boundsMax[c] = readComponent(positions, 0, c);
+            }
+            for (std::size_t v = 1; v < vertexCount; ++v) {
+                for (int c = 0; c < 3; ++c) {
+                    float value = readComponent(positions, v, c);
+                    data.boundsMin[c] = std::min(data.boundsMin[c], value);
+                    data.boundsMax[c] = std::max(data.boundsMax[c], value);
+                }
+            }
+        }
+
+        primitive.converted = !zeroCopy || !directIndices;
+        std::size_t vertexBytes = 0;
+        for (int s = 0; s < data.layout.StreamCount(); ++s) {
+            vertexBytes += data.streamBytes[s];
+        }
+        (zeroCopy ? scene.stats.zeroCopyBytes : scene.stats.convertedBytes) += vertexBytes;
+        (directIndices ? scene.stats.zeroCopyBytes : scene.stats.convertedBytes) += data.indexBytes;
+        return true;
+    }
+
+//--------------------------------------------------NODES----------------------------------------------------------------------
+
+    void identity(float matrix[16])
+    {
+        for (int i = 0; i < 16; ++i) {
+            matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        }
+    }
+
+    //column major result = a * b, result may not alias
+    void multiply(const float a[16], const float b[16], float result[16])
+    {
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; ++k) {
+                    sum += a[k * 4 + row] * b[column * 4 + k];
+                }
+                result[column * 4 + row] = sum;
+            }
+        }
+    }
+
+    //either "matrix" or translation * rotation * scale
+    void localMatrix(const JsonValue& node, float matrix[16])
+    {
+        const JsonValue& values = node["matrix"];
+        if (values.Size() == 16) {
+            for (int i = 0; i < 16; ++i) {
+                matrix[i] = (float)values[i].AsNumber();
+            }
+            return;
+        }
+        const JsonValue& t = node["translation"];
+        const JsonValue& r = node["rotation"];
+        const JsonValue& s = node["scale"];
+        float x = (float)r[0].AsNumber(0.0), y = (float)r[1].AsNumber(0.0), z = (float)r[2].AsNumber(0.0), w = (float)r[3].AsNumber(1.0);
+        float scale[3] = { (float)s[0].AsNumber(1.0), (float)s[1].AsNumber(1.0), (float)s[2].AsNumber(1.0) };
+        float rotation[9] = {
+            1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+            2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+            2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y),
+        };
+        identity(matrix);
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                matrix[column * 4 + row] = rotation[column * 3 + row] * scale[column];
+            }
+        }
+        for (int row = 0; row < 3; ++row) {
+            matrix[12 + row] = (float)t[row].AsNumber(0.0);
+        }
+    }
+
+    //depth first from the scene's roots, so every parent lands before its children
+    void flattenNodes(const JsonValue& gltf, GltfScene& scene)
+    {
+        const JsonValue& nodes = gltf["nodes"];
+        std::vector<long long> roots;
+        const JsonValue& sceneJson = gltf["scenes"][(std::size_t)gltf["scene"].AsInteger(0)];
+        if (!sceneJson.IsNull()) {
+            for (const JsonValue& root : sceneJson["nodes"].items) {
+                roots.push_back(root.AsInteger());
+            }
+        } else {
+            //no scene: every node nobody lists as a child
+            std::vector<bool> child(nodes.Size(), false);
+            for (const JsonValue& node : nodes.items) {
+                for (const JsonValue& index : node["children"].items) {
+                    if (index.AsInteger() >= 0 && (std::size_t)index.AsInteger() < child.size()) {
+                        child[(std::size_t)index.AsInteger()] = true;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < child.size(); ++i) {
+                if (!child[i]) {
+                    roots.push_back((long long)i);
+                }
+            }
+        }
+
+        std::vector<bool> visited(nodes.Size(), false);
+        std::vector<std::pair<long long, int>> stack;      //glTF node, parent in scene.nodes
+        for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+            stack.push_back({ *root, -1 });
+        }
+        while (!stack.empty()) {
+            auto [index, parent] = stack.back();
+            stack.pop_back();
+            if (index < 0 || (std::size_t)index >= nodes.Size() || visited[(std::size_t)index]) {
+                continue;
+            }
+            visited[(std::size_t)index] = true;
+            const JsonValue& json = nodes[(std::size_t)index];
+
+            GltfNode node;
+            node.name = json["name"].string;
+            node.parent = parent;
+            node.mesh = (int)json["mesh"].AsInteger(-1);
+            localMatrix(json, node.local);
+            if (parent >= 0) {
+                multiply(scene.nodes[parent].world, node.local, node.world);
+            } else {
+                std::memcpy(node.world, node.local, sizeof(node.world));
+            }
+            scene.nodes.push_back(node);
+
+            int self = (int)scene.nodes.size() - 1;
+            const JsonValue& children = json["children"];
+            for (std::size_t c = children.Size(); c-- > 0;) {
+                stack.push_back({ children[c].AsInteger(), self });
+            }
+        }
+    }
+
+    void transformPoint(const float matrix[16], const float point[3], float result[3])
+    {
+        for (int row = 0; row < 3; ++row) {
+            result[row] = matrix[row] * point[0] + matrix[4 + row] * point[1] + matrix[8 + row] * point[2] + matrix[12 + row];
+        }
+    }
+
+    //world bounds over the corners of every drawn primitive's box
+    void sceneBounds(GltfScene& scene)
+    {
+        bool first = true;
+        for (const GltfNode& node : scene.nodes) {
+            for (const GltfPrimitive& primitive : scene.primitives) {
+                if (primitive.mesh != node.mesh) {
+                    continue;
+                }
+                for (int corner = 0; corner < 8; ++corner) {
+                    float point[3], world[3];
+                    for (int c = 0; c < 3; ++c) {
+                        point[c] = (corner >> c) & 1 ? primitive.data.boundsMax[c] : primitive.data.boundsMin[c];
+                    }
+                    transformPoint(node.world, point, world);
+                    for (int c = 0; c < 3; ++c) {
+                        scene.boundsMin[c] = first ? world[c] : std::min(scene.boundsMin[c], world[c]);
+                        scene.boundsMax[c] = first ? world[c] : std::max(scene.boundsMax[c], world[c]);
+                    }
+                    first = false;
+                }
+            }
+        }
+    }
+
+    std::string directoryOf(const std::string& path)
+    {
+        std::size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    }
+
+    bool fail(const char* what, const std::string& path)
+    {
+        std::cout << "ERROR: " << what << ": " << path << std::endl;
+        return false;
+    }
+
+}
+
+//--------------------------------------------------ENTRY POINTS----------------------------------------------------------------------
+
+namespace GltfLoader {
+
+    bool Load(const std::string& path, GltfScene& scene)
+    {
+        auto start = std::chrono::steady_clock::now();
+        scene = GltfScene();
+        scene.files.push_back(std::make_unique<MappedFile>());
+        MappedFile& file = *scene.files.back();
+        if (!file.Open(path)) {
+            return fail("GLTF COULD NOT OPEN", path);
+        }
+
+        //.glb: 12 byte header, then a JSON chunk and an optional BIN chunk, both 4 byte aligned
+        const unsigned char* data = file.Data();
+        const char* json = (const char*)data;
+        std::size_t jsonBytes = file.Size();
+        Buffer binary;
+        if (file.Size() >= 12 && std::memcmp(data, "glTF", 4) == 0) {
+            uint32_t header[3], chunk[2];
+            std::memcpy(header, data, sizeof(header));
+            if (header[1] != 2 || header[2] > file.Size() || header[2] < 20) {
+                return fail("GLTF UNSUPPORTED GLB", path);
+            }
+            std::size_t offset = 12;
+            std::memcpy(chunk, data + offset, sizeof(chunk));
+            if (chunk[1] != 0x4E4F534A || offset + 8 + chunk[0] > header[2]) {
+                return fail("GLTF UNSUPPORTED GLB", path);
+            }
+            json = (const char*)data + offset + 8;
+            jsonBytes = chunk[0];
+            offset += 8 + ((chunk[0] + 3) & ~3u);
+            if (offset + 8 <= header[2]) {
+                std::memcpy(chunk, data + offset, sizeof(chunk));
+                if (chunk[1] == 0x004E4942 && offset + 8 + chunk[0] <= header[2]) {
+                    binary.data = data + offset + 8;
+                    binary.size = chunk[0];
+                }
+            }
+        }
+
+        JsonValue gltf;
+        if (!JsonParser(json, jsonBytes).Parse(gltf) || gltf["asset"]["version"].string.compare(0, 1, "2") != 0) {
+            return fail("GLTF INVALID", path);
+        }
+
+        //buffer 0 without an uri is the GLB's BIN chunk, the others are files next to the .gltf
+        std::vector<Buffer> buffers;
+        for (const JsonValue& bufferJson : gltf["buffers"].items) {
+            const std::string& uri = bufferJson["uri"].string;
+            Buffer buffer;
+            if (uri.empty()) {
+                buffer = binary;
+            } else if (uri.compare(0, 5, "data:") == 0) {
+                return fail("GLTF EMBEDDED BUFFERS NOT SUPPORTED", path);
+            } else {
+                scene.files.push_back(std::make_unique<MappedFile>());
+                if (!scene.files.back()->Open(directoryOf(path) + uri)) {
+                    return fail("GLTF COULD NOT OPEN BUFFER", directoryOf(path) + uri);
+                }
+                buffer.data = scene.files.back()->Data();
+                buffer.size = scene.files.back()->Size();
+            }
+            if ((std::size_t)bufferJson["byteLength"].AsInteger(0) > buffer.size) {
+                return fail("GLTF BUFFER TRUNCATED", path);
+            }
+            buffers.push_back(buffer);
+        }
+
+        const JsonValue& meshes = gltf["meshes"];
+        for (std::size_t m = 0; m < meshes.Size(); ++m) {
+            for (const JsonValue& json : meshes[m]["primitives"].items) {
+                GltfPrimitive primitive;
+                primitive.mesh = (int)m;
+                if (!loadPrimitive(gltf, json, buffers, scene, primitive)) {
+                    scene.stats.skippedPrimitives++;
+                    continue;
+                }
+                (primitive.converted ? scene.stats.convertedPrimitives : scene.stats.zeroCopyPrimitives)++;
+                scene.primitives.push_back(std::move(primitive));
+            }
+        }
+        if (scene.stats.skippedPrimitives) {
+            std::cout << "ERROR: GLTF PRIMITIVES SKIPPED: " << scene.stats.skippedPrimitives << " in " << path << std::endl;
+        }
+
+        flattenNodes(gltf, scene);
+        sceneBounds(scene);
+        scene.stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    void Upload(const GltfScene& scene, GLuint program, std::vector<std::unique_ptr<Mesh>>& meshes,
+                std::vector<Object3D>& objects, const float* root)
+    {
+        std::vector<Mesh*> primitiveMeshes;
+        for (const GltfPrimitive& primitive : scene.primitives) {
+            meshes.push_back(std::make_unique<Mesh>(primitive.data));
+            primitiveMeshes.push_back(meshes.back().get());
+        }
+        Instantiate(scene, program, primitiveMeshes, objects, root);
+    }
+
+    void Instantiate(const GltfScene& scene, GLuint program, const std::vector<Mesh*>& primitiveMeshes,
+                     std::vector<Object3D>& objects, const float* root)
+    {
+        //primitives of every glTF mesh
+        std::vector<std::vector<Mesh*>> meshPrimitives;
+        for (std::size_t p = 0; p < scene.primitives.size() && p < primitiveMeshes.size(); ++p) {
+            int mesh = scene.primitives[p].mesh;
+            if ((std::size_t)mesh >= meshPrimitives.size()) {
+                meshPrimitives.resize(mesh + 1);
+            }
+            meshPrimitives[mesh].push_back(primitiveMeshes[p]);
+        }
+
+        for (const GltfNode& node : scene.nodes) {
+            if (node.mesh < 0 || (std::size_t)node.mesh >= meshPrimitives.size()) {
+                continue;
+            }
+            float transform[16];
+            if (root) {
+                multiply(root, node.world, transform);
+            } else {
+                std::memcpy(transform, node.world, sizeof(transform));
+            }
+            for (Mesh* mesh : meshPrimitives[node.mesh]) {
+                objects.emplace_back(mesh, program);
+                objects.back().SetTransform(transform);
+            }
+        }
+    }
+
+}
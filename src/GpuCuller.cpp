@@ -0,0 +1,606 @@
+#include "GpuCuller.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+namespace {
+
+    //one invocation per object, 2D dispatch so more than 65535 * 64 objects fit
+    //phase 0 = frustum only, 1 = frustum and visible last frame, 2 = frustum and depth pyramid
+    const char* cullComputeSource = R"(#version 430 core
+layout(local_size_x = 64) in;
+
+struct Object {
+    mat4 model;
+    uvec4 batch;
+};
+struct Batch {
+    mat4 dequantization;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uvec4 command;
+};
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { Object objects[]; };
+layout(std430, binding = 1) readonly buffer Batches { Batch batches[]; };
+layout(std430, binding = 2) buffer Commands { Command commands[]; };
+layout(std430, binding = 3) writeonly buffer Instances { mat4 instances[]; };
+layout(std430, binding = 4) buffer Visibility { uint visibility[]; };
+layout(std430, binding = 5) buffer Counters { uint occludedCount; uint occludedTriangles; };
+
+uniform vec4 uPlanes[6];
+uniform uint uObjectCount;
+uniform int uPhase;
+uniform uint uCommandOffset;
+uniform mat4 uViewProjection;
+uniform ivec2 uScreenSize;
+uniform int uLevels;
+uniform sampler2D uPyramid;
+
+shared uint groupOccluded;
+shared uint groupTriangles;
+
+bool occluded(vec3 center, vec3 extents)
+{
+    vec3 ndcMin = vec3(1.0), ndcMax = vec3(-1.0);
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center + extents * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = uViewProjection * vec4(corner, 1.0);
+        //crosses the camera plane, the projection says nothing
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        ndcMin = min(ndcMin, clip.xyz / clip.w);
+        ndcMax = max(ndcMax, clip.xyz / clip.w);
+    }
+    if (ndcMin.z < -1.0) {
+        return false;
+    }
+
+    //pixel rect, then the level where it spans at most 2x2 texels, texel t of level l covers pixels t << (l + 1)
+    //and the last texel of a level everything past that
+    vec2 screen = vec2(uScreenSize);
+    ivec2 pixelLow = ivec2(clamp((ndcMin.xy * 0.5 + 0.5) * screen, vec2(0.0), screen - 1.0));
+    ivec2 pixelHigh = ivec2(clamp((ndcMax.xy * 0.5 + 0.5) * screen, vec2(0.0), screen - 1.0));
+    int level = 0;
+    ivec2 low, high;
+    for (;; ++level) {
+        ivec2 last = textureSize(uPyramid, level) - 1;
+        low = min(pixelLow >> (level + 1), last);
+        high = min(pixelHigh >> (level + 1), last);
+        if (level == uLevels - 1 || all(lessThanEqual(high - low, ivec2(1)))) {
+            break;
+        }
+    }
+    float farthest = max(max(texelFetch(uPyramid, low, level).r, texelFetch(uPyramid, ivec2(high.x, low.y), level).r),
+                         max(texelFetch(uPyramid, ivec2(low.x, high.y), level).r, texelFetch(uPyramid, high, level).r));
+    return ndcMin.z * 0.5 + 0.5 > farthest;
+}
+
+void cull(uint index)
+{
+    mat4 model = objects[index].model;
+    Batch batch = batches[objects[index].batch.x];
+
+    //world box around the transformed mesh box: center through the matrix, extents through |matrix|
+    vec3 center = (model * vec4(0.5 * (batch.boundsMin.xyz + batch.boundsMax.xyz), 1.0)).xyz;
+    vec3 halfSize = 0.5 * (batch.boundsMax.xyz - batch.boundsMin.xyz);
+    vec3 extents = abs(model[0].xyz) * halfSize.x + abs(model[1].xyz) * halfSize.y + abs(model[2].xyz) * halfSize.z;
+    for (int p = 0; p < 6; ++p) {
+        if (dot(uPlanes[p].xyz, center) + uPlanes[p].w < -dot(abs(uPlanes[p].xyz), extents)) {
+            if (uPhase == 2) {
+                visibility[index] = 0u;
+            }
+            return;
+        }
+    }
+
+    uint command = batch.command.x;
+    uint first = commands[command].baseInstance;
+    if (uPhase == 1 && visibility[index] == 0u) {
+        return;
+    }
+    if (uPhase == 2) {
+        bool drawn = visibility[index] != 0u;
+        bool visible = !occluded(center, extents);
+        visibility[index] = visible ? 1u : 0u;
+        if (drawn) {
+            return;
+        }
+        if (!visible) {
+            atomicAdd(groupOccluded, 1u);
+            atomicAdd(groupTriangles, commands[command].count / 3u);
+            return;
+        }
+        //after the instances phase 1 wrote for the batch, every writer stores the same base
+        first += commands[command].instanceCount;
+        commands[command + uCommandOffset].baseInstance = first;
+    }
+
+    command += uCommandOffset;
+    uint slot = atomicAdd(commands[command].instanceCount, 1u);
+    instances[first + slot] = model * batch.dequantization;
+}
+
+void main()
+{
+    if (gl_LocalInvocationIndex == 0u) {
+        groupOccluded = 0u;
+        groupTriangles = 0u;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    uint index = gl_WorkGroupID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x;
+    if (index < uObjectCount) {
+        cull(index);
+    }
+
+    //one global atomic per group instead of one per occluded object
+    memoryBarrierShared();
+    barrier();
+    if (gl_LocalInvocationIndex == 0u && groupOccluded != 0u) {
+        atomicAdd(occludedCount, groupOccluded);
+        atomicAdd(occludedTriangles, groupTriangles);
+    }
+}
+)";
+
+    //one level of the depth pyramid, every texel keeps the farthest of the 2x2 below it,
+    //level 0 reads the depth buffer copy, the others the level before through an image
+    //the levels halve rounding down as GL wants them, so on an odd level the last texel takes 3 columns / rows
+    const char* pyramidComputeSource = R"(#version 430 core
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r32f, binding = 0) readonly uniform image2D uSource;
+layout(r32f, binding = 1) writeonly uniform image2D uTarget;
+uniform sampler2D uDepth;
+uniform int uFromDepth;
+uniform ivec2 uSourceSize;
+uniform ivec2 uTargetSize;
+
+float source(ivec2 texel)
+{
+    //odd depth buffer: the last texel of level 0 has no right / top neighbour
+    texel = min(texel, uSourceSize - 1);
+    return uFromDepth != 0 ? texelFetch(uDepth, texel, 0).r : imageLoad(uSource, texel).r;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, uTargetSize))) {
+        return;
+    }
+    ivec2 below = texel * 2;
+    float farthest = max(max(source(below), source(below + ivec2(1, 0))), max(source(below + ivec2(0, 1)), source(below + ivec2(1, 1))));
+    bool extraColumn = texel.x == uTargetSize.x - 1 && uSourceSize.x > uTargetSize.x * 2;
+    bool extraRow = texel.y == uTargetSize.y - 1 && uSourceSize.y > uTargetSize.y * 2;
+    if (extraColumn) {
+        farthest = max(farthest, max(source(below + ivec2(2, 0)), source(below + ivec2(2, 1))));
+    }
+    if (extraRow) {
+        farthest = max(farthest, max(source(below + ivec2(0, 2)), source(below + ivec2(1, 2))));
+    }
+    if (extraColumn && extraRow) {
+        farthest = max(farthest, source(below + ivec2(2, 2)));
+    }
+    imageStore(uTarget, texel, vec4(farthest));
+}
+)";
+
+    GLuint compileCompute(const char* source)
+    {
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        GLint success = 0;
+        char infoLog[1024];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR: COMPUTE SHADER COMPILATION FAILED\n" << infoLog << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR: COMPUTE SHADER LINKING FAILED\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    GLuint createBuffer(GLenum target, std::size_t size, const void* data, GLenum usage)
+    {
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        GLState::Get().BindBuffer(target, buffer);
+        glBufferData(target, (GLsizeiptr)std::max<std::size_t>(size, 16), data, usage);
+        return buffer;
+    }
+
+}
+
+GpuCuller::~GpuCuller() {
+    Destroy();
+}
+
+bool GpuCuller::Supported() {
+    return hasGLVersion(4, 3) && GLEXT_ARB_compute_shader && GLEXT_ARB_shader_storage_buffer_object && GLEXT_ARB_multi_draw_indirect &&
+           GLEXT_ARB_shader_image_load_store;
+}
+
+bool GpuCuller::Create(const Options& options) {
+    Destroy();
+    if (!Supported()) {
+        std::cout << "ERROR: GPU CULLING NEEDS OPENGL 4.3" << std::endl;
+        return false;
+    }
+    options_ = options;
+    program_ = compileCompute(cullComputeSource);
+    if (!program_) {
+        return false;
+    }
+    planesLocation_ = glGetUniformLocation(program_, "uPlanes");
+    countLocation_ = glGetUniformLocation(program_, "uObjectCount");
+    phaseLocation_ = glGetUniformLocation(program_, "uPhase");
+    commandOffsetLocation_ = glGetUniformLocation(program_, "uCommandOffset");
+    viewProjectionLocation_ = glGetUniformLocation(program_, "uViewProjection");
+    screenSizeLocation_ = glGetUniformLocation(program_, "uScreenSize");
+    levelsLocation_ = glGetUniformLocation(program_, "uLevels");
+    pyramidLocation_ = glGetUniformLocation(program_, "uPyramid");
+
+    if (options_.occlusion) {
+        pyramidProgram_ = compileCompute(pyramidComputeSource);
+        if (!pyramidProgram_) {
+            Destroy();
+            return false;
+        }
+        fromDepthLocation_ = glGetUniformLocation(pyramidProgram_, "uFromDepth");
+        depthLocation_ = glGetUniformLocation(pyramidProgram_, "uDepth");
+        sourceSizeLocation_ = glGetUniformLocation(pyramidProgram_, "uSourceSize");
+        targetSizeLocation_ = glGetUniformLocation(pyramidProgram_, "uTargetSize");
+    }
+    return true;
+}
+
+void GpuCuller::Destroy() {
+    freeBuffers();
+    GLState& state = GLState::Get();
+    for (GLuint* program : { &program_, &pyramidProgram_ }) {
+        if (*program) {
+            state.DeleteProgram(*program);
+            *program = 0;
+        }
+    }
+    for (GLuint* texture : { &depthTexture_, &pyramid_ }) {
+        if (*texture) {
+            state.DeleteTexture(*texture);
+            *texture = 0;
+        }
+    }
+    pyramidWidth_ = pyramidHeight_ = 0;
+    levelSizes_.clear();
+}
+
+void GpuCuller::freeBuffers() {
+    GLState& state = GLState::Get();
+    for (GLuint* buffer : { &objects_, &batchBuffer_, &commands_, &commandTemplate_, &instances_, &visibility_, &counters_ }) {
+        if (*buffer) {
+            state.DeleteBuffer(*buffer);
+            *buffer = 0;
+        }
+    }
+    batches_.clear();
+    objectCount_ = 0;
+    commandCount_ = 0;
+    drawOffset_ = 0;
+    secondPhasePending_ = false;
+}
+
+bool GpuCuller::SetObjects(const std::vector<Object3D>& objects) {
+    if (!program_) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    freeBuffers();
+
+    //batches in first seen order, then every batch gets its instance range
+    std::map<std::tuple<Mesh*, GLuint, GLuint>, uint32_t> slots;
+    std::vector<GpuObject> gpuObjects(objects.size());
+    std::vector<std::size_t> batchSizes;
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        const Object3D& object = objects[i];
+        auto found = slots.emplace(std::make_tuple(object.GetMesh(), object.Program(), object.Texture()), (uint32_t)batches_.size());
+        if (found.second) {
+            batches_.push_back({ object.GetMesh(), object.Program(), object.Texture(), 0, 0 });
+            batchSizes.push_back(0);
+        }
+        uint32_t batch = found.first->second;
+        batchSizes[batch]++;
+        std::copy(object.Transform(), object.Transform() + 16, gpuObjects[i].model);
+        gpuObjects[i].batch = batch;
+        gpuObjects[i].pad[0] = gpuObjects[i].pad[1] = gpuObjects[i].pad[2] = 0;
+    }
+
+    std::vector<GpuBatch> gpuBatches(batches_.size());
+    std::vector<GpuCommand> commands(batches_.size());
+    GLuint firstInstance = 0;
+    for (std::size_t b = 0; b < batches_.size(); ++b) {
+        Batch& batch = batches_[b];
+        const Mesh& mesh = *batch.mesh;
+        batch.firstCommand = (uint32_t)b;
+        batch.commandCount = 1;
+
+        GpuBatch& gpuBatch = gpuBatches[b];
+        mesh.Dequantization().Matrix(gpuBatch.dequantization);
+        for (int c = 0; c < 3; ++c) {
+            gpuBatch.boundsMin[c] = mesh.BoundsMin()[c];
+            gpuBatch.boundsMax[c] = mesh.BoundsMax()[c];
+        }
+        gpuBatch.boundsMin[3] = gpuBatch.boundsMax[3] = 1.0f;
+        gpuBatch.command = batch.firstCommand;
+        gpuBatch.pad[0] = gpuBatch.pad[1] = gpuBatch.pad[2] = 0;
+
+        commands[b] = { (GLuint)mesh.IndexCount(), 0, 0, 0, firstInstance };
+        firstInstance += (GLuint)batchSizes[b];
+    }
+    //the second phase has its own copy of every command, its baseInstance is set by the shader
+    commandCount_ = commands.size();
+    if (options_.occlusion) {
+        commands.insert(commands.end(), commands.begin(), commands.end());
+    }
+
+    objects_ = createBuffer(GL_SHADER_STORAGE_BUFFER, gpuObjects.size() * sizeof(GpuObject), gpuObjects.data(), GL_DYNAMIC_DRAW);
+    batchBuffer_ = createBuffer(GL_SHADER_STORAGE_BUFFER, gpuBatches.size() * sizeof(GpuBatch), gpuBatches.data(), GL_STATIC_DRAW);
+    commandTemplate_ = createBuffer(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(GpuCommand), commands.data(), GL_STATIC_DRAW);
+    commands_ = createBuffer(GL_SHADER_STORAGE_BUFFER, commands.size() * sizeof(GpuCommand), commands.data(), GL_DYNAMIC_COPY);
+    instances_ = createBuffer(GL_SHADER_STORAGE_BUFFER, objects.size() * 16 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+    if (options_.occlusion) {
+        //nothing was visible before the first frame, phase 2 draws it all against an empty pyramid
+        std::vector<uint32_t> visibility(objects.size(), 0);
+        uint32_t counters[4] = {};
+        visibility_ = createBuffer(GL_SHADER_STORAGE_BUFFER, visibility.size() * sizeof(uint32_t), visibility.data(), GL_DYNAMIC_COPY);
+        counters_ = createBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(counters), counters, GL_DYNAMIC_COPY);
+    }
+
+    objectCount_ = objects.size();
+    stats_.objects = objectCount_;
+    stats_.batches = batches_.size();
+    stats_.commands = commands.size();
+    stats_.uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void GpuCuller::UpdateObject(std::size_t index, const Object3D& object) {
+    if (index >= objectCount_) {
+        return;
+    }
+    GLState::Get().BindBuffer(GL_SHADER_STORAGE_BUFFER, objects_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)(index * sizeof(GpuObject)), 16 * sizeof(float), object.Transform());
+}
+
+void GpuCuller::Cull(const Frustum& frustum) {
+    secondPhasePending_ = false;
+    dispatch(frustum, 0);
+}
+
+void GpuCuller::Cull(const Mat4& viewProjection) {
+    viewProjection_ = viewProjection;
+    secondPhasePending_ = options_.occlusion;
+    dispatch(Frustum::FromMatrix(viewProjection), options_.occlusion ? 1 : 0);
+}
+
+bool GpuCuller::CullOccluded(GLuint framebuffer, int width, int height) {
+    if (!secondPhasePending_ || width <= 0 || height <= 0) {
+        return false;
+    }
+    secondPhasePending_ = false;
+    stats_.dispatches = 0;
+    buildPyramid(framebuffer, width, height);
+    dispatch(Frustum::FromMatrix(viewProjection_), 2);
+    return objectCount_ != 0;
+}
+
+void GpuCuller::dispatch(const Frustum& frustum, int phase) {
+    if (phase != 2) {
+        stats_.dispatches = 0;
+    }
+    drawOffset_ = phase == 2 ? commandCount_ : 0;
+    if (objectCount_ == 0) {
+        return;
+    }
+    GLState& state = GLState::Get();
+    if (phase != 2) {
+        //instance counts of both phases back to 0, and the occlusion counters with them; last frame's shaders wrote
+        //both buffers with atomics, the copies must not overtake those writes
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        std::size_t sets = options_.occlusion ? 2 : 1;
+        state.BindBuffer(GL_COPY_READ_BUFFER, commandTemplate_);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, commands_);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)(sets * commandCount_ * sizeof(GpuCommand)));
+        if (counters_) {
+            const uint32_t zero[4] = {};
+            state.BindBuffer(GL_COPY_WRITE_BUFFER, counters_);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(zero), zero);
+        }
+    }
+
+    state.UseProgram(program_);
+    glUniform4fv(planesLocation_, 6, &frustum.planes[0].x);
+    glUniform1ui(countLocation_, (GLuint)objectCount_);
+    glUniform1i(phaseLocation_, phase);
+    glUniform1ui(commandOffsetLocation_, (GLuint)drawOffset_);
+    if (phase == 2) {
+        glUniformMatrix4fv(viewProjectionLocation_, 1, GL_FALSE, viewProjection_.m);
+        glUniform2i(screenSizeLocation_, pyramidWidth_, pyramidHeight_);
+        glUniform1i(levelsLocation_, (GLint)levelSizes_.size() / 2);
+        glUniform1i(pyramidLocation_, (GLint)kPyramidUnit);
+        state.BindTexture(kPyramidUnit, GL_TEXTURE_2D, pyramid_);
+    }
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objects_);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, batchBuffer_);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commands_);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, instances_);
+    if (options_.occlusion) {
+        state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, visibility_);
+        state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, counters_);
+    }
+
+    std::size_t groups = (objectCount_ + kWorkGroupSize - 1) / kWorkGroupSize;
+    GLuint groupsX = (GLuint)std::min<std::size_t>(groups, 65535);
+    GLuint groupsY = (GLuint)((groups + groupsX - 1) / groupsX);
+    glDispatchCompute(groupsX, groupsY, 1);
+    stats_.dispatches++;
+
+    //the draws read the commands as indirect parameters and the matrices as vertex attributes, phase 2 reads the
+    //instance counts phase 1 appended to and the next frame's phase 1 the visibility phase 2 wrote
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCuller::buildPyramid(GLuint framebuffer, int width, int height) {
+    GLState& state = GLState::Get();
+    if (width != pyramidWidth_ || height != pyramidHeight_) {
+        //level 0 is half the framebuffer rounded up, the rest a regular mip chain down to 1x1
+        levelSizes_.clear();
+        int levelWidth = (width + 1) / 2, levelHeight = (height + 1) / 2;
+        for (;;) {
+            levelSizes_.push_back(levelWidth);
+            levelSizes_.push_back(levelHeight);
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+
+        for (GLuint* texture : { &depthTexture_, &pyramid_ }) {
+            if (!*texture) {
+                glGenTextures(1, texture);
+            }
+            state.BindTexture(kPyramidUnit, GL_TEXTURE_2D, *texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        state.BindTexture(kPyramidUnit, GL_TEXTURE_2D, depthTexture_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+        state.BindTexture(kPyramidUnit, GL_TEXTURE_2D, pyramid_);
+        GLint levels = (GLint)levelSizes_.size() / 2;
+        for (GLint level = 0; level < levels; ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelSizes_[level * 2], levelSizes_[level * 2 + 1], 0, GL_RED, GL_FLOAT, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        pyramidWidth_ = width;
+        pyramidHeight_ = height;
+        stats_.pyramidLevels = (std::size_t)levels;
+    }
+
+    //the depth phase 1 left, copied since a renderbuffer or the window's depth can't be sampled
+    state.BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    state.BindTexture(kPyramidUnit, GL_TEXTURE_2D, depthTexture_);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    state.UseProgram(pyramidProgram_);
+    glUniform1i(depthLocation_, (GLint)kPyramidUnit);
+    int sourceWidth = width, sourceHeight = height;
+    for (std::size_t level = 0; level < levelSizes_.size() / 2; ++level) {
+        int targetWidth = levelSizes_[level * 2], targetHeight = levelSizes_[level * 2 + 1];
+        glUniform1i(fromDepthLocation_, level == 0);
+        glUniform2i(sourceSizeLocation_, sourceWidth, sourceHeight);
+        glUniform2i(targetSizeLocation_, targetWidth, targetHeight);
+        if (level > 0) {
+            glBindImageTexture(0, pyramid_, (GLint)level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(1, pyramid_, (GLint)level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((targetWidth + kPyramidGroupSize - 1) / kPyramidGroupSize, (targetHeight + kPyramidGroupSize - 1) / kPyramidGroupSize, 1);
+        stats_.dispatches++;
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        sourceWidth = targetWidth;
+        sourceHeight = targetHeight;
+    }
+}
+
+void GpuCuller::Draw() {
+    stats_.drawCalls = 0;
+    if (objectCount_ == 0) {
+        return;
+    }
+    GLState& state = GLState::Get();
+    state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_);
+    for (const Batch& batch : batches_) {
+        state.UseProgram(batch.program);
+        state.BindVertexArray(batch.mesh->VertexArray());
+        state.BindTexture(0, GL_TEXTURE_2D, batch.texture);
+        //baseInstance offsets into the instance buffer, so the attributes start at 0 for every batch
+        state.BindBuffer(GL_ARRAY_BUFFER, instances_);
+        for (GLuint column = 0; column < 4; ++column) {
+            GLuint location = kInstanceAttribute + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (const void*)(column * 4 * sizeof(float)));
+            glVertexAttribDivisor(location, 1);
+        }
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch.mesh->IndexType(), (const void*)((drawOffset_ + batch.firstCommand) * sizeof(GpuCommand)),
+                                    (GLsizei)batch.commandCount, 0);
+        stats_.drawCalls++;
+    }
+}
+
+std::size_t GpuCuller::CountVisible() const {
+    if (objectCount_ == 0) {
+        return 0;
+    }
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    std::vector<GpuCommand> commands(commandCount_ * (options_.occlusion ? 2 : 1));
+    GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, commands_);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)(commands.size() * sizeof(GpuCommand)), commands.data());
+    std::size_t visible = 0;
+    for (const GpuCommand& command : commands) {
+        visible += command.instanceCount;
+    }
+    return visible;
+}
+
+GpuCuller::OcclusionStats GpuCuller::ReadOcclusionStats() const {
+    OcclusionStats stats;
+    stats.tested = objectCount_;
+    if (objectCount_ == 0 || !options_.occlusion) {
+        return stats;
+    }
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    GLState& state = GLState::Get();
+    std::vector<GpuCommand> commands(commandCount_ * 2);
+    state.BindBuffer(GL_COPY_READ_BUFFER, commands_);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)(commands.size() * sizeof(GpuCommand)), commands.data());
+    uint32_t counters[4] = {};
+    state.BindBuffer(GL_COPY_READ_BUFFER, counters_);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counters), counters);
+
+    for (std::size_t c = 0; c < commands.size(); ++c) {
+        (c < commandCount_ ? stats.firstPhase : stats.secondPhase) += commands[c].instanceCount;
+    }
+    stats.occluded = counters[0];
+    stats.occludedTriangles = counters[1];
+    stats.frustumCulled = objectCount_ - stats.firstPhase - stats.secondPhase - stats.occluded;
+    return stats;
+}
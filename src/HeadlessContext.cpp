@@ -0,0 +1,132 @@
+#include "HeadlessContext.h"
+#include <glad/glad.h>
+#include "GLExtensions.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <iostream>
+
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if (!extensions) {
+        return false;
+    }
+    std::size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        //make sure we matched a whole word, not a prefix of a longer extension name
+        bool startOk = p == extensions || p[-1] == ' ';
+        bool endOk = p[length] == ' ' || p[length] == '\0';
+        if (startOk && endOk) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//prefer the surfaceless platform, it needs neither a window system nor a gpu
+static EGLDisplay openDisplay()
+{
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+HeadlessContext::~HeadlessContext() {
+    Destroy();
+}
+
+bool HeadlessContext::Create(int major, int minor) {
+    display_ = openDisplay();
+    EGLint eglMajor, eglMinor;
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, &eglMajor, &eglMinor)) {
+        std::cout << "ERROR: FAILED TO INITIALIZE EGL DISPLAY" << std::endl;
+        display_ = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "ERROR: EGL DOES NOT SUPPORT DESKTOP OPENGL" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    const char* extensions = eglQueryString(display_, EGL_EXTENSIONS);
+    bool surfaceless = hasExtension(extensions, "EGL_KHR_surfaceless_context");
+
+    //without a config-less context we need a pbuffer config (and a dummy surface if surfaceless is missing)
+    EGLConfig config = (EGLConfig)0;
+    if (!hasExtension(extensions, "EGL_KHR_no_config_context") || !surfaceless) {
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        EGLint count = 0;
+        if (!eglChooseConfig(display_, configAttribs, &config, 1, &count) || count == 0) {
+            std::cout << "ERROR: NO SUITABLE EGL CONFIG" << std::endl;
+            Destroy();
+            return false;
+        }
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context_ == EGL_NO_CONTEXT) {
+        std::cout << "ERROR: FAILED TO CREATE EGL CONTEXT" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface_ = eglCreatePbufferSurface(display_, config, pbufferAttribs);
+    }
+
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+        std::cout << "ERROR: FAILED TO MAKE EGL CONTEXT CURRENT" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        Destroy();
+        return false;
+    }
+    loadGLExtensions((GLADloadproc)eglGetProcAddress);
+
+    std::cout << "HEADLESS CONTEXT: " << glGetString(GL_RENDERER) << " | " << glGetString(GL_VERSION) << std::endl;
+    return true;
+}
+
+void HeadlessContext::Destroy() {
+    if (display_ == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != EGL_NO_SURFACE) {
+        eglDestroySurface(display_, surface_);
+        surface_ = EGL_NO_SURFACE;
+    }
+    if (context_ != EGL_NO_CONTEXT) {
+        eglDestroyContext(display_, context_);
+        context_ = EGL_NO_CONTEXT;
+    }
+    eglTerminate(display_);
+    display_ = EGL_NO_DISPLAY;
+}
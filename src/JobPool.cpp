@@ -0,0 +1,102 @@
+#include "JobPool.h"
+#include <algorithm>
+#include <cstring>
+
+JobPool::~JobPool() {
+    Destroy();
+}
+
+bool JobPool::Create(int threads) {
+    Destroy();
+    if (threads <= 0) {
+        threads = (int)std::thread::hardware_concurrency() - 1;
+    }
+    stopping_ = false;
+    for (int t = 0; t < threads; ++t) {
+        workers_.emplace_back(&JobPool::work, this);
+    }
+    return true;
+}
+
+void JobPool::Destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+int JobPool::Run(std::size_t count, const std::function<void(std::size_t)>& job) {
+    if (count < 2 || workers_.empty()) {
+        for (std::size_t j = 0; j < count; ++j) {
+            job(j);
+        }
+        return 1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        jobCount_ = count;
+        nextJob_ = 0;
+        busy_ = workers_.size();
+        generation_++;
+    }
+    wake_.notify_all();
+    drain();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    job_ = nullptr;
+    return (int)std::min(workers_.size() + 1, count);
+}
+
+int JobPool::Filter(std::size_t total, std::size_t chunkSize, const std::function<std::size_t(std::size_t, std::size_t, uint32_t*)>& chunk,
+                    std::vector<uint32_t>& out) {
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    std::size_t chunks = (total + chunkSize - 1) / chunkSize;
+    //every chunk writes its indices at the start of its own range, packed afterwards
+    out.resize(total);
+    chunkKept_.assign(chunks, 0);
+    int threads = Run(chunks, [&](std::size_t c) {
+        std::size_t begin = c * chunkSize;
+        chunkKept_[c] = chunk(begin, std::min(begin + chunkSize, total), out.data() + begin);
+    });
+
+    std::size_t kept = chunks ? chunkKept_[0] : 0;
+    for (std::size_t c = 1; c < chunks; ++c) {
+        std::size_t begin = c * chunkSize;
+        if (chunkKept_[c] && begin != kept) {
+            std::memmove(out.data() + kept, out.data() + begin, chunkKept_[c] * sizeof(uint32_t));
+        }
+        kept += chunkKept_[c];
+    }
+    out.resize(kept);
+    return threads;
+}
+
+void JobPool::drain() {
+    for (std::size_t j = nextJob_++; j < jobCount_; j = nextJob_++) {
+        (*job_)(j);
+    }
+}
+
+void JobPool::work() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this, seen]() { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (--busy_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <cstdlib>
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    //no mmap here, read the file in once, callers still only see a pointer
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::size_t size = (std::size_t)file.tellg();
+    if (size == 0) {
+        return false;
+    }
+    unsigned char* data = (unsigned char*)std::malloc(size);
+    file.seekg(0);
+    if (!data || !file.read((char*)data, size)) {
+        std::free(data);
+        return false;
+    }
+    data_ = data;
+    size_ = size;
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        ::close(descriptor);
+        return false;
+    }
+    std::size_t size = (std::size_t)info.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    //the mapping keeps its own reference to the file
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    //everything reading these files goes front to back
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_WILLNEED);
+    data_ = (const unsigned char*)mapping;
+    size_ = size;
+#endif
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) {
+#ifdef _WIN32
+        std::free((void*)data_);
+#else
+        munmap((void*)data_, size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -1,23 +1,280 @@
-/*
-TODO: Implement Mesh class
-*/
-#pragma once
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "GLState.h"
+#include "GLExtensions.h"
+#include "MeshFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <utility>
 
-Mesh::Mesh(std::vector<float> vertices, std::size_t size) {
-    this->vertices = vertices;
-    glGenBuffers(1, &VBO_);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glGenVertexArrays(1, &VAO_);
-    glBindVertexArray(VAO_);
-    glBufferData(GL_ARRAY_BUFFER, size, vertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+Mesh::Mesh(const float* vertices, std::size_t size, bool optimize, bool keepCpuCopy, const VertexLayout& layout)
+    : layout_(layout) {
+    //turn the triangle soup into unique vertices + indices
+    std::size_t stride = layout_.SourceFloats();
+    std::size_t soupVertexCount = size / (stride * sizeof(float));
+    MeshOptimizer::DeduplicateVertices(vertices, soupVertexCount, stride, this->vertices, indices);
+    build(optimize, keepCpuCopy);
+}
+
+Mesh::Mesh(const std::vector<float>& vertices, std::size_t size, bool optimize, bool keepCpuCopy, const VertexLayout& layout)
+    : Mesh(vertices.data(), size, optimize, keepCpuCopy, layout) {
+}
+
+Mesh::Mesh(std::vector<float>&& vertices, std::vector<unsigned int>&& indices, bool optimize, bool keepCpuCopy, const VertexLayout& layout)
+    : layout_(layout), vertices(std::move(vertices)), indices(std::move(indices)) {
+    build(optimize, keepCpuCopy);
+}
+
+Mesh::Mesh(const MeshFile& file) {
+    PackedMeshData data;
+    file.PackedData(data);
+    upload(data);
+}
+
+Mesh::Mesh(const PackedMeshData& data) {
+    upload(data);
 }
 
 Mesh::~Mesh() {
-    glDeleteVertexArrays(1, &VAO_);
-    glDeleteBuffers(1, &VBO_);
+    release();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept {
+    *this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    release();
+    VAO_ = std::exchange(other.VAO_, 0);
+    for (int stream = 0; stream < VertexLayout::kMaxStreams; ++stream) {
+        VBOs_[stream] = std::exchange(other.VBOs_[stream], 0);
+    }
+    layout_ = other.layout_;
+    EBO_ = std::exchange(other.EBO_, 0);
+    indexCount_ = std::exchange(other.indexCount_, 0);
+    indexBufferCount_ = std::exchange(other.indexBufferCount_, 0);
+    indexType_ = other.indexType_;
+    vertexCount_ = std::exchange(other.vertexCount_, 0);
+    vertexBytes_ = std::exchange(other.vertexBytes_, 0);
+    indexBytes_ = std::exchange(other.indexBytes_, 0);
+    std::copy(other.boundsMin_, other.boundsMin_ + 3, boundsMin_);
+    std::copy(other.boundsMax_, other.boundsMax_ + 3, boundsMax_);
+    positionQuantization_ = other.positionQuantization_;
+    quantizationError_ = other.quantizationError_;
+    cacheStatsBefore_ = other.cacheStatsBefore_;
+    cacheStatsAfter_ = other.cacheStatsAfter_;
+    lods_ = std::move(other.lods_);
+    meshlets_ = std::move(other.meshlets_);
+    vertices = std::move(other.vertices);
+    indices = std::move(other.indices);
+    return *this;
+}
+
+//optimizes `vertices` + `indices` in place and uploads them
+void Mesh::build(bool optimize, bool keepCpuCopy) {
+    std::size_t stride = layout_.SourceFloats();
+    vertexCount_ = vertices.size() / stride;
+    indexCount_ = (GLsizei)indices.size();
+    indexBufferCount_ = indices.size();
+    lods_.assign(1, { 0, (uint32_t)indexCount_, 0.0f });
+
+    cacheStatsBefore_ = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount_);
+    if (optimize) {
+        //cache order first, overdraw reorders whole clusters of it, fetch order follows the final index order
+        std::vector<std::size_t> clusters;
+        MeshOptimizer::OptimizeVertexCache(indices, vertexCount_, 16, &clusters);
+        MeshOptimizer::OptimizeOverdraw(indices, vertices, stride, clusters);
+        vertexCount_ = MeshOptimizer::OptimizeVertexFetch(vertices, stride, indices);
+        cacheStatsAfter_ = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount_);
+    } else {
+        cacheStatsAfter_ = cacheStatsBefore_;
+    }
+
+    //the position is always the first attribute of the source vertex
+    for (int c = 0; c < 3; ++c) {
+        boundsMin_[c] = vertexCount_ ? vertices[c] : 0.0f;
+        boundsMax_[c] = boundsMin_[c];
+    }
+    for (std::size_t v = 1; v < vertexCount_; ++v) {
+        const float* position = &vertices[v * stride];
+        for (int c = 0; c < 3; ++c) {
+            boundsMin_[c] = std::min(boundsMin_[c], position[c]);
+            boundsMax_[c] = std::max(boundsMax_[c], position[c]);
+        }
+    }
+
+    GLState& state = GLState::Get();
+    glGenVertexArrays(1, &VAO_);
+    state.BindVertexArray(VAO_);
+
+    //plain float layouts upload the source as is, anything packed is converted stream by stream first
+    vertexBytes_ = vertexCount_ * layout_.VertexBytes();
+    glGenBuffers(layout_.StreamCount(), VBOs_);
+    if (layout_.MatchesSource()) {
+        state.BindBuffer(GL_ARRAY_BUFFER, VBOs_[0]);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes_, vertices.data(), GL_STATIC_DRAW);
+    } else {
+        std::vector<uint8_t> streams[VertexLayout::kMaxStreams];
+        positionQuantization_ = layout_.QuantizePositions(boundsMin_, boundsMax_);
+        layout_.Pack(vertices.data(), vertexCount_, streams, &positionQuantization_);
+        quantizationError_ = layout_.MeasureError(vertices.data(), vertexCount_, streams, &positionQuantization_);
+        for (int stream = 0; stream < layout_.StreamCount(); ++stream) {
+            state.BindBuffer(GL_ARRAY_BUFFER, VBOs_[stream]);
+            glBufferData(GL_ARRAY_BUFFER, streams[stream].size(), streams[stream].data(), GL_STATIC_DRAW);
+        }
+    }
+
+    //the element buffer binding is part of the VAO, so bind it while the VAO is bound
+    glGenBuffers(1, &EBO_);
+    uploadIndices(!keepCpuCopy);
+
+    layout_.Apply(VBOs_);
+
+    state.BindVertexArray(0);
+
+    if (!keepCpuCopy) {
+        //swap instead of clear so the memory is actually returned
+        std::vector<float>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
+}
+
+//creates the GL objects for data that needs no conversion
+void Mesh::upload(const PackedMeshData& data) {
+    layout_ = data.layout;
+    vertexCount_ = data.vertexCount;
+    indexBufferCount_ = data.indexCount;
+    indexType_ = data.indexType;
+    std::copy(data.boundsMin, data.boundsMin + 3, boundsMin_);
+    std::copy(data.boundsMax, data.boundsMax + 3, boundsMax_);
+    positionQuantization_ = data.dequantization;
+    quantizationError_ = data.errors;
+    lods_ = data.lods;
+    if (lods_.empty()) {
+        lods_.push_back({ 0, (uint32_t)indexBufferCount_, 0.0f });
+    }
+    indexCount_ = (GLsizei)lods_[0].indexCount;
+    meshlets_ = data.meshlets;
+
+    //the data never changes, immutable storage lets the driver place it once and never expect a reupload
+    auto store = [](GLenum target, std::size_t bytes, const void* source) {
+        if (GLEXT_ARB_buffer_storage) {
+            glBufferStorage(target, (GLsizeiptr)bytes, source, 0);
+        } else {
+            glBufferData(target, (GLsizeiptr)bytes, source, GL_STATIC_DRAW);
+        }
+    };
+
+    GLState& state = GLState::Get();
+    glGenVertexArrays(1, &VAO_);
+    state.BindVertexArray(VAO_);
+    glGenBuffers(layout_.StreamCount(), VBOs_);
+    vertexBytes_ = 0;
+    for (int stream = 0; stream < layout_.StreamCount(); ++stream) {
+        state.BindBuffer(GL_ARRAY_BUFFER, VBOs_[stream]);
+        store(GL_ARRAY_BUFFER, data.streamBytes[stream], data.streams[stream]);
+        vertexBytes_ += data.streamBytes[stream];
+    }
+    glGenBuffers(1, &EBO_);
+    state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    indexBytes_ = data.indexBytes;
+    store(GL_ELEMENT_ARRAY_BUFFER, indexBytes_, data.indices);
+    layout_.Apply(VBOs_);
+    state.BindVertexArray(0);
+}
+
+//(re)fills the bound VAO's element buffer from `indices`, 16 bit when every vertex fits
+void Mesh::uploadIndices(bool narrowInPlace) {
+    GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    if (vertexCount_ <= 0xFFFF) {
+        //half the index memory and bandwidth when every vertex is reachable with 16 bits
+        indexType_ = GL_UNSIGNED_SHORT;
+        indexBytes_ = indices.size() * sizeof(uint16_t);
+        if (!narrowInPlace) {
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes_, shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            //the indices are thrown away anyway, narrow them in place, the write never overtakes the read
+            uint16_t* shortIndices = reinterpret_cast<uint16_t*>(indices.data());
+            for (std::size_t i = 0; i < indices.size(); ++i) {
+                shortIndices[i] = (uint16_t)indices[i];
+            }
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes_, shortIndices, GL_STATIC_DRAW);
+        }
+    } else {
+        indexType_ = GL_UNSIGNED_INT;
+        indexBytes_ = indices.size() * sizeof(unsigned int);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes_, indices.data(), GL_STATIC_DRAW);
+    }
+}
+
+int Mesh::GenerateLods(const LodOptions& options) {
+    if (!HasCpuCopy()) {
+        std::cout << "ERROR: LODS NEED THE CPU COPY OF THE MESH" << std::endl;
+        return 0;
+    }
+    std::size_t stride = layout_.SourceFloats();
+    indices.resize((std::size_t)indexCount_);
+    lods_.assign(1, { 0, (uint32_t)indexCount_, 0.0f });
+
+    //every level starts over from LOD 0, so its error is measured against the full mesh, not the level before
+    std::vector<unsigned int> full(indices), level;
+    std::size_t previous = full.size();
+    float error = 0.0f;
+    while ((int)lods_.size() < options.maxLods) {
+        std::size_t target = (std::size_t)(previous / 3 * options.ratio) * 3;
+        float reached = MeshOptimizer::Simplify(vertices, stride, full, target, options.simplify, level);
+        if (level.empty() || level.size() > previous - (std::size_t)(previous * options.minReduction)) {
+            break;
+        }
+        MeshOptimizer::OptimizeVertexCache(level, vertexCount_);
+        error = std::max(error, reached);
+        lods_.push_back({ (uint32_t)indices.size(), (uint32_t)level.size(), error });
+        indices.insert(indices.end(), level.begin(), level.end());
+        previous = level.size();
+    }
+    indexBufferCount_ = indices.size();
+
+    GLState& state = GLState::Get();
+    state.BindVertexArray(VAO_);
+    uploadIndices(false);
+    state.BindVertexArray(0);
+    return (int)lods_.size();
+}
+
+std::size_t Mesh::BuildMeshlets(std::size_t maxVertices, std::size_t maxTriangles) {
+    if (!HasCpuCopy()) {
+        std::cout << "ERROR: MESHLETS NEED THE CPU COPY OF THE MESH" << std::endl;
+        return 0;
+    }
+    //only LOD 0 is clustered, it is the first range of the buffer so the other levels keep their offsets
+    std::vector<unsigned int> levelZero(indices.begin(), indices.begin() + indexCount_);
+    MeshOptimizer::BuildMeshlets(levelZero, vertices, layout_.SourceFloats(), meshlets_, maxVertices, maxTriangles);
+    std::copy(levelZero.begin(), levelZero.end(), indices.begin());
+
+    GLState& state = GLState::Get();
+    state.BindVertexArray(VAO_);
+    uploadIndices(false);
+    state.BindVertexArray(0);
+    return meshlets_.size();
+}
+
+void Mesh::release() {
+    GLState& state = GLState::Get();
+    state.DeleteVertexArray(VAO_);
+    for (unsigned int& VBO : VBOs_) {
+        state.DeleteBuffer(VBO);
+        VBO = 0;
+    }
+    state.DeleteBuffer(EBO_);
+    VAO_ = EBO_ = 0;
+}
+
+void Mesh::Draw() {
+    GLState::Get().BindVertexArray(VAO_);
+    glDrawElements(GL_TRIANGLES, indexCount_, indexType_, (void*)0);
 }
@@ -0,0 +1,315 @@
+#include "MeshFile.h"
+#include "Mesh.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//every blob starts on a cache line, and on more than any vertex format or index type needs
+static const std::size_t kBlobAlignment = 64;
+
+static std::size_t alignBlob(std::size_t offset)
+{
+    return (offset + kBlobAlignment - 1) / kBlobAlignment * kBlobAlignment;
+}
+
+MeshFile::~MeshFile() {
+    Close();
+}
+
+bool MeshFile::Open(const std::string& path) {
+    Close();
+    if (!file_.Open(path)) {
+        return false;
+    }
+    data_ = file_.Data();
+    size_ = file_.Size();
+    if (!validate()) {
+        std::cout << "ERROR: MESH FILE INVALID: " << path << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::Close() {
+    file_.Close();
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    layout_ = VertexLayout();
+}
+
+bool MeshFile::validate() {
+    if (size_ < sizeof(MeshFileHeader)) {
+        return false;
+    }
+    const MeshFileHeader* header = (const MeshFileHeader*)data_;
+    if (std::memcmp(header->magic, "MMSH", 4) != 0 || header->version != kMeshFileVersion || header->fileBytes != size_) {
+        return false;
+    }
+    if (header->attributeCount == 0 || header->attributeCount > (uint32_t)VertexLayout::kMaxAttributes ||
+        header->sectionCount > (uint32_t)kMeshFileMaxSections) {
+        return false;
+    }
+    if (header->indexType != GL_UNSIGNED_SHORT && header->indexType != GL_UNSIGNED_INT) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+        const MeshFileSectionEntry& section = header->sections[i];
+        if (section.offset % kBlobAlignment != 0 || section.offset > size_ || section.bytes > size_ - section.offset) {
+            return false;
+        }
+    }
+    header_ = header;
+
+    //rebuild the layout the same way it was first described, so strides and offsets come out identical
+    VertexLayout layout;
+    for (uint32_t i = 0; i < header->attributeCount; ++i) {
+        const MeshFileAttribute& attribute = header->attributes[i];
+        if (attribute.components < 1 || attribute.components > 4 || attribute.stream >= VertexLayout::kMaxStreams ||
+            attribute.semantic > (uint8_t)VertexSemantic::Tangent || attribute.format > (uint8_t)VertexFormat::Octahedral16) {
+            header_ = nullptr;
+            return false;
+        }
+        layout.Add((VertexSemantic)attribute.semantic, (VertexFormat)attribute.format, attribute.components,
+                   attribute.normalized != 0, attribute.stream);
+    }
+    //Add() drops combinations it doesn't support (a packed format with too few components...), the file is no good then
+    if (layout.AttributeCount() != (int)header->attributeCount) {
+        header_ = nullptr;
+        return false;
+    }
+    layout_ = layout;
+
+    //every stream and the indices have to be there and exactly as large as the counts say
+    std::size_t bytes = 0;
+    for (int stream = 0; stream < layout_.StreamCount(); ++stream) {
+        if (!Stream(stream, &bytes) || bytes != header->vertexCount * layout_.Stride(stream)) {
+            header_ = nullptr;
+            return false;
+        }
+    }
+    std::size_t indexSize = header->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (!Section(MeshFileSection::Indices, &bytes) || bytes != header->indexCount * indexSize) {
+        header_ = nullptr;
+        return false;
+    }
+    if (Section(MeshFileSection::Lods, &bytes) && bytes % sizeof(MeshLod) != 0) {
+        header_ = nullptr;
+        return false;
+    }
+    //LOD ranges are drawn as they are, so they have to stay inside the index section
+    std::size_t lodCount = 0;
+    const MeshLod* lods = Lods(&lodCount);
+    for (std::size_t i = 0; i < lodCount; ++i) {
+        if ((uint64_t)lods[i].firstIndex + lods[i].indexCount > header->indexCount) {
+            header_ = nullptr;
+            return false;
+        }
+    }
+    //so do meshlets, and they only ever cover LOD 0
+    if (Section(MeshFileSection::Meshlets, &bytes) && bytes % sizeof(MeshOptimizer::Meshlet) != 0) {
+        header_ = nullptr;
+        return false;
+    }
+    std::size_t meshletCount = 0;
+    const MeshOptimizer::Meshlet* meshlets = Meshlets(&meshletCount);
+    uint64_t levelZero = lodCount ? lods[0].indexCount : header->indexCount;
+    for (std::size_t i = 0; i < meshletCount; ++i) {
+        if ((uint64_t)meshlets[i].firstIndex + meshlets[i].indexCount > levelZero) {
+            header_ = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+PositionQuantization MeshFile::Dequantization() const {
+    PositionQuantization quantization;
+    std::memcpy(quantization.offset, header_->dequantizationOffset, sizeof(quantization.offset));
+    std::memcpy(quantization.scale, header_->dequantizationScale, sizeof(quantization.scale));
+    quantization.enabled = header_->quantized != 0;
+    return quantization;
+}
+
+QuantizationError MeshFile::Errors() const {
+    QuantizationError errors;
+    errors.position = header_->errors[0];
+    errors.normal = header_->errors[1];
+    errors.color = header_->errors[2];
+    errors.texCoord = header_->errors[3];
+    return errors;
+}
+
+const void* MeshFile::Section(MeshFileSection type, std::size_t* bytes) const {
+    for (uint32_t i = 0; header_ && i < header_->sectionCount; ++i) {
+        const MeshFileSectionEntry& section = header_->sections[i];
+        if (section.type == (uint32_t)type) {
+            if (bytes) {
+                *bytes = (std::size_t)section.bytes;
+            }
+            return data_ + section.offset;
+        }
+    }
+    if (bytes) {
+        *bytes = 0;
+    }
+    return nullptr;
+}
+
+const void* MeshFile::Stream(int stream, std::size_t* bytes) const {
+    return Section((MeshFileSection)((uint32_t)MeshFileSection::Stream0 + stream), bytes);
+}
+
+const MeshLod* MeshFile::Lods(std::size_t* count) const {
+    std::size_t bytes = 0;
+    const MeshLod* lods = (const MeshLod*)Section(MeshFileSection::Lods, &bytes);
+    *count = bytes / sizeof(MeshLod);
+    return lods;
+}
+
+const MeshOptimizer::Meshlet* MeshFile::Meshlets(std::size_t* count) const {
+    std::size_t bytes = 0;
+    const MeshOptimizer::Meshlet* meshlets = (const MeshOptimizer::Meshlet*)Section(MeshFileSection::Meshlets, &bytes);
+    *count = bytes / sizeof(MeshOptimizer::Meshlet);
+    return meshlets;
+}
+
+void MeshFile::PackedData(PackedMeshData& data) const {
+    data.layout = layout_;
+    for (int stream = 0; stream < layout_.StreamCount(); ++stream) {
+        data.streams[stream] = Stream(stream, &data.streamBytes[stream]);
+    }
+    data.vertexCount = (std::size_t)header_->vertexCount;
+    data.indices = Section(MeshFileSection::Indices, &data.indexBytes);
+    data.indexCount = (std::size_t)header_->indexCount;
+    data.indexType = header_->indexType;
+    std::copy(header_->boundsMin, header_->boundsMin + 3, data.boundsMin);
+    std::copy(header_->boundsMax, header_->boundsMax + 3, data.boundsMax);
+    data.dequantization = Dequantization();
+    data.errors = Errors();
+    std::size_t lodCount = 0;
+    const MeshLod* lods = Lods(&lodCount);
+    data.lods.assign(lods, lods + lodCount);
+    std::size_t meshletCount = 0;
+    const MeshOptimizer::Meshlet* meshlets = Meshlets(&meshletCount);
+    data.meshlets.assign(meshlets, meshlets + meshletCount);
+}
+
+bool MeshFile::Write(const std::string& path, const Mesh& mesh) {
+    const VertexLayout& layout = mesh.Layout();
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "MMSH", 4);
+    header.version = kMeshFileVersion;
+    header.vertexCount = mesh.VertexCount();
+    header.indexCount = (uint64_t)mesh.IndexBufferCount();
+    header.indexType = mesh.IndexType();
+    header.attributeCount = (uint32_t)layout.AttributeCount();
+    for (int i = 0; i < layout.AttributeCount(); ++i) {
+        const VertexAttribute& source = layout.Attribute(i);
+        MeshFileAttribute& attribute = header.attributes[i];
+        attribute.semantic = (uint8_t)source.semantic;
+        attribute.format = (uint8_t)source.format;
+        attribute.components = source.components;
+        attribute.normalized = source.normalized ? 1 : 0;
+        attribute.stream = source.stream;
+    }
+    std::memcpy(header.boundsMin, mesh.BoundsMin(), sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, mesh.BoundsMax(), sizeof(header.boundsMax));
+    const PositionQuantization& quantization = mesh.Dequantization();
+    std::memcpy(header.dequantizationOffset, quantization.offset, sizeof(header.dequantizationOffset));
+    std::memcpy(header.dequantizationScale, quantization.scale, sizeof(header.dequantizationScale));
+    header.quantized = quantization.enabled ? 1 : 0;
+    const QuantizationError& errors = mesh.QuantizationErrors();
+    header.errors[0] = errors.position;
+    header.errors[1] = errors.normal;
+    header.errors[2] = errors.color;
+    header.errors[3] = errors.texCoord;
+
+    //the GPU copy is the one that counts, it is packed already and still there when the CPU copy was dropped
+    std::vector<unsigned char> blobs[VertexLayout::kMaxStreams + 3];
+    GLState& state = GLState::Get();
+    auto readBack = [&state](GLuint buffer, std::size_t bytes, std::vector<unsigned char>& destination) {
+        destination.resize(bytes);
+        state.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)bytes, destination.data());
+    };
+    for (int stream = 0; stream < layout.StreamCount(); ++stream) {
+        readBack(mesh.VertexBuffer(stream), mesh.VertexCount() * layout.Stride(stream), blobs[stream]);
+    }
+    std::size_t indexSize = mesh.IndexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    readBack(mesh.ElementBuffer(), mesh.IndexBufferCount() * indexSize, blobs[VertexLayout::kMaxStreams]);
+    const std::vector<MeshLod>& lods = mesh.Lods();
+    blobs[VertexLayout::kMaxStreams + 1].resize(lods.size() * sizeof(MeshLod));
+    std::memcpy(blobs[VertexLayout::kMaxStreams + 1].data(), lods.data(), lods.size() * sizeof(MeshLod));
+    const std::vector<MeshOptimizer::Meshlet>& meshlets = mesh.Meshlets();
+    blobs[VertexLayout::kMaxStreams + 2].resize(meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+    std::memcpy(blobs[VertexLayout::kMaxStreams + 2].data(), meshlets.data(), meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+
+    //lay the sections out behind the header
+    MeshFileSection types[VertexLayout::kMaxStreams + 3];
+    for (int stream = 0; stream < VertexLayout::kMaxStreams; ++stream) {
+        types[stream] = (MeshFileSection)((uint32_t)MeshFileSection::Stream0 + stream);
+    }
+    types[VertexLayout::kMaxStreams] = MeshFileSection::Indices;
+    types[VertexLayout::kMaxStreams + 1] = MeshFileSection::Lods;
+    types[VertexLayout::kMaxStreams + 2] = MeshFileSection::Meshlets;
+    std::size_t offset = alignBlob(sizeof(MeshFileHeader));
+    for (int i = 0; i < VertexLayout::kMaxStreams + 3; ++i) {
+        bool present = i < layout.StreamCount() || (i >= VertexLayout::kMaxStreams && i < VertexLayout::kMaxStreams + 2) ||
+                       !blobs[i].empty();
+        if (!present) {
+            continue;
+        }
+        MeshFileSectionEntry& section = header.sections[header.sectionCount++];
+        section.type = (uint32_t)types[i];
+        section.offset = offset;
+        section.bytes = blobs[i].size();
+        offset = alignBlob(offset + blobs[i].size());
+    }
+    header.fileBytes = offset;
+
+    //write to a temporary file and rename, so a crash never leaves a truncated mesh behind, a failure no file at all
+    std::string temporaryPath = path + ".tmp";
+    std::error_code error;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cout << "ERROR: MESH FILE NOT WRITABLE: " << path << std::endl;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        static const char padding[kBlobAlignment] = {};
+        file.write((const char*)&header, sizeof(header));
+        std::size_t written = sizeof(header);
+        for (uint32_t i = 0; i < header.sectionCount; ++i) {
+            const MeshFileSectionEntry& section = header.sections[i];
+            file.write(padding, (std::streamsize)(section.offset - written));
+            int blob = section.type == (uint32_t)MeshFileSection::Indices ? VertexLayout::kMaxStreams
+                     : section.type == (uint32_t)MeshFileSection::Lods ? VertexLayout::kMaxStreams + 1
+                     : section.type == (uint32_t)MeshFileSection::Meshlets ? VertexLayout::kMaxStreams + 2
+                     : (int)section.type;
+            file.write((const char*)blobs[blob].data(), (std::streamsize)section.bytes);
+            written = section.offset + section.bytes;
+        }
+        file.write(padding, (std::streamsize)(header.fileBytes - written));
+        file.close();
+        if (file.fail()) {
+            std::cout << "ERROR: MESH FILE NOT WRITABLE: " << path << std::endl;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::cout << "ERROR: MESH FILE NOT WRITABLE: " << path << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,986 @@
+#include "MeshImporter.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+    struct Range {
+        std::size_t begin, end;
+    };
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int threadCount(const MeshImporter::Options& options, std::size_t bytes)
+    {
+        int threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+        std::size_t byBytes = bytes / std::max<std::size_t>(options.minChunkBytes, 1);
+        return (int)std::max<std::size_t>(1, std::min<std::size_t>(std::max(threads, 1), byBytes));
+    }
+
+    //runs function(0..count-1), index 0 on the calling thread
+    template <typename Function>
+    void parallelFor(int count, const Function& function)
+    {
+        std::vector<std::thread> workers;
+        for (int i = 1; i < count; ++i) {
+            workers.emplace_back(function, i);
+        }
+        function(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    //cuts [begin, end) into at most `count` ranges that each start at the beginning of a line
+    std::vector<Range> splitLines(const char* data, std::size_t begin, std::size_t end, int count)
+    {
+        std::vector<Range> ranges;
+        std::size_t start = begin;
+        for (int i = 1; i < count; ++i) {
+            std::size_t cut = begin + (end - begin) * i / count;
+            if (cut < start) {
+                continue;
+            }
+            const char* newline = (const char*)std::memchr(data + cut, '\n', end - cut);
+            std::size_t next = newline ? (std::size_t)(newline - data) + 1 : end;
+            if (next > start) {
+                ranges.push_back({ start, next });
+                start = next;
+            }
+        }
+        if (start < end || ranges.empty()) {
+            ranges.push_back({ start, end });
+        }
+        return ranges;
+    }
+
+    const char* lineEnd(const char* p, const char* end)
+    {
+        const char* newline = (const char*)std::memchr(p, '\n', end - p);
+        return newline ? newline : end;
+    }
+
+    const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            ++p;
+        }
+        return p;
+    }
+
+    const char* skipToken(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+            ++p;
+        }
+        return p;
+    }
+
+    //from_chars does not take a leading '+', denormals come back as out of range and are flushed to 0
+    bool parseFloat(const char*& p, const char* end, float& value)
+    {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            value = 0.0f;
+        } else if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    bool parseInteger(const char*& p, const char* end, int64_t& value)
+    {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    bool reportError(const char* what, const std::string& name, std::size_t offset)
+    {
+        std::cout << "ERROR: " << what << ": " << name << " (byte " << offset << ")" << std::endl;
+        return false;
+    }
+
+    //float source layout of the imported vertices, in the order the importers write them
+    VertexLayout importLayout(bool normals, bool texCoords, bool colors)
+    {
+        VertexLayout layout;
+        layout.Add(VertexSemantic::Position, VertexFormat::Float, 3);
+        if (normals) {
+            layout.Add(VertexSemantic::Normal, VertexFormat::Float, 3);
+        }
+        if (texCoords) {
+            layout.Add(VertexSemantic::TexCoord0, VertexFormat::Float, 2);
+        }
+        if (colors) {
+            layout.Add(VertexSemantic::Color, VertexFormat::Float, 3);
+        }
+        return layout;
+    }
+
+//--------------------------------------------------OBJ----------------------------------------------------------------------
+
+    //corner indices as a chunk sees them: >= 0 absolute (0 based), kMissing, or relative to the chunk's own elements
+    //(negative OBJ indices count back from the last element parsed so far, which may be in an earlier chunk)
+    const int64_t kMissing = -1;
+    const int64_t kRelative = int64_t(1) << 40;
+
+    struct ObjChunk {
+        std::vector<float> positions, colors, texCoords, normals;
+        std::vector<int64_t> corners;   //position, texcoord, normal per triangle corner
+        bool hasTexCoords = false, hasNormals = false;
+        std::size_t errorOffset = 0;
+        const char* error = nullptr;
+    };
+
+    int64_t objIndex(int64_t index, std::size_t localCount)
+    {
+        return index > 0 ? index - 1 : (int64_t)localCount + index - kRelative;
+    }
+
+    //v/vt/vn, v//vn, v/vt or v
+    bool parseObjCorner(const char*& p, const char* end, const ObjChunk& chunk, int64_t corner[3])
+    {
+        int64_t index = 0;
+        if (!parseInteger(p, end, index) || index == 0) {
+            return false;
+        }
+        corner[0] = objIndex(index, chunk.positions.size() / 3);
+        corner[1] = corner[2] = kMissing;
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                if (!parseInteger(p, end, index) || index == 0) {
+                    return false;
+                }
+                corner[1] = objIndex(index, chunk.texCoords.size() / 2);
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                if (!parseInteger(p, end, index) || index == 0) {
+                    return false;
+                }
+                corner[2] = objIndex(index, chunk.normals.size() / 3);
+            }
+        }
+        return true;
+    }
+
+    void parseObjChunk(const char* data, Range range, ObjChunk& chunk)
+    {
+        const char* p = data + range.begin;
+        const char* end = data + range.end;
+        std::vector<int64_t> polygon;
+        float values[6];
+        while (p < end) {
+            const char* line = skipSpaces(p, end);
+            const char* eol = lineEnd(line, end);
+            p = eol + 1;
+            if (line + 1 >= eol) {
+                continue;
+            }
+
+            bool ok = true;
+            if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+                //"v x y z" or "v x y z r g b" (vertex colors, as written by most scanners)
+                const char* q = line + 2;
+                for (int i = 0; i < 3 && ok; ++i) {
+                    ok = parseFloat(q, eol, values[i]);
+                }
+                chunk.positions.insert(chunk.positions.end(), values, values + 3);
+                q = skipSpaces(q, eol);
+                if (ok && q < eol) {
+                    for (int i = 3; i < 6 && ok; ++i) {
+                        ok = parseFloat(q, eol, values[i]);
+                    }
+                    chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+                }
+            } else if (line[0] == 'v' && line[1] == 't') {
+                const char* q = line + 2;
+                ok = parseFloat(q, eol, values[0]) && parseFloat(q, eol, values[1]);
+                chunk.texCoords.insert(chunk.texCoords.end(), values, values + 2);
+            } else if (line[0] == 'v' && line[1] == 'n') {
+                const char* q = line + 2;
+                ok = parseFloat(q, eol, values[0]) && parseFloat(q, eol, values[1]) && parseFloat(q, eol, values[2]);
+                chunk.normals.insert(chunk.normals.end(), values, values + 3);
+            } else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+                const char* q = line + 1;
+                polygon.clear();
+                while (ok && (q = skipSpaces(q, eol)) < eol) {
+                    int64_t corner[3];
+                    ok = parseObjCorner(q, eol, chunk, corner);
+                    polygon.insert(polygon.end(), corner, corner + 3);
+                    chunk.hasTexCoords |= corner[1] != kMissing;
+                    chunk.hasNormals |= corner[2] != kMissing;
+                }
+                //fan, (0, i, i + 1)
+                for (std::size_t i = 1; ok && i + 1 < polygon.size() / 3; ++i) {
+                    chunk.corners.insert(chunk.corners.end(), polygon.begin(), polygon.begin() + 3);
+                    chunk.corners.insert(chunk.corners.end(), polygon.begin() + i * 3, polygon.begin() + i * 3 + 6);
+                }
+            }
+            //comments, groups, materials, smoothing groups, lines and points are not geometry we draw
+
+            if (!ok) {
+                chunk.error = "OBJ PARSE FAILED";
+                chunk.errorOffset = (std::size_t)(line - data);
+                return;
+            }
+        }
+    }
+
+    //index triple -> unique vertex, open addressing over a power of two table kept at most half full
+    class CornerTable {
+        public:
+            //most files have about one unique vertex per position, start there and grow if they don't
+            explicit CornerTable(std::size_t expectedVertices) {
+                resize(expectedVertices * 2);
+            }
+
+            //returns the vertex of the triple, `keys` receives new triples at the end
+            uint32_t Insert(const uint32_t key[3], std::vector<uint32_t>& keys) {
+                std::size_t mask = slots_.size() - 1;
+                for (std::size_t slot = hash(key) & mask;; slot = (slot + 1) & mask) {
+                    uint32_t vertex = slots_[slot];
+                    if (vertex == kEmpty) {
+                        vertex = (uint32_t)(keys.size() / 3);
+                        keys.insert(keys.end(), key, key + 3);
+                        slots_[slot] = vertex;
+                        if ((std::size_t)vertex * 2 >= slots_.size()) {
+                            grow(keys);
+                        }
+                        return vertex;
+                    }
+                    if (std::memcmp(&keys[vertex * 3], key, 3 * sizeof(uint32_t)) == 0) {
+                        return vertex;
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+
+            static std::size_t hash(const uint32_t key[3]) {
+                uint64_t hash = (key[0] * 0x9E3779B97F4A7C15ull) ^ (key[1] * 0xC2B2AE3D27D4EB4Full) ^ (key[2] * 0x165667B19E3779F9ull);
+                return (std::size_t)(hash ^ (hash >> 29));
+            }
+
+            void resize(std::size_t minimum) {
+                std::size_t capacity = 64;
+                while (capacity < minimum) {
+                    capacity *= 2;
+                }
+                slots_.assign(capacity, kEmpty);
+            }
+
+            void grow(const std::vector<uint32_t>& keys) {
+                resize(slots_.size() * 2);
+                std::size_t mask = slots_.size() - 1;
+                for (uint32_t vertex = 0; vertex < keys.size() / 3; ++vertex) {
+                    std::size_t slot = hash(&keys[vertex * 3]) & mask;
+                    while (slots_[slot] != kEmpty) {
+                        slot = (slot + 1) & mask;
+                    }
+                    slots_[slot] = vertex;
+                }
+            }
+
+            std::vector<uint32_t> slots_;
+    };
+
+    bool mergeObjChunks(std::vector<ObjChunk>& chunks, MeshImporter::Result& result, const std::string& name)
+    {
+        //where every chunk's elements start in the whole file
+        std::size_t chunkCount = chunks.size();
+        std::vector<std::size_t> positionBase(chunkCount), texCoordBase(chunkCount), normalBase(chunkCount);
+        std::size_t positions = 0, texCoords = 0, normals = 0, colors = 0, corners = 0;
+        bool hasTexCoords = false, hasNormals = false;
+        for (std::size_t c = 0; c < chunkCount; ++c) {
+            positionBase[c] = positions;
+            texCoordBase[c] = texCoords;
+            normalBase[c] = normals;
+            positions += chunks[c].positions.size() / 3;
+            texCoords += chunks[c].texCoords.size() / 2;
+            normals += chunks[c].normals.size() / 3;
+            colors += chunks[c].colors.size() / 3;
+            corners += chunks[c].corners.size() / 3;
+            hasTexCoords |= chunks[c].hasTexCoords;
+            hasNormals |= chunks[c].hasNormals;
+        }
+        //colors only count if every vertex has one
+        bool hasColors = colors > 0 && colors == positions;
+        if (positions > 0xFFFFFFFEu || corners > 0xFFFFFFFFu) {
+            return reportError("OBJ TOO LARGE", name, 0);
+        }
+
+        //absolute indices, range checked, missing attributes become kMissingIndex
+        const uint32_t kMissingIndex = 0xFFFFFFFFu;
+        std::atomic<bool> valid(true);
+        parallelFor((int)chunkCount, [&](int c) {
+            const std::size_t bases[3] = { positionBase[c], texCoordBase[c], normalBase[c] };
+            const std::size_t counts[3] = { positions, texCoords, normals };
+            std::vector<int64_t>& chunkCorners = chunks[c].corners;
+            for (std::size_t i = 0; i < chunkCorners.size(); ++i) {
+                int64_t& index = chunkCorners[i];
+                int attribute = (int)(i % 3);
+                if (index == kMissing) {
+                    index = kMissingIndex;
+                    continue;
+                }
+                if (index < -kRelative / 2) {
+                    index = (int64_t)bases[attribute] + index + kRelative;
+                }
+                if (index < 0 || (std::size_t)index >= counts[attribute]) {
+                    valid = false;
+                    return;
+                }
+            }
+        });
+        if (!valid) {
+            return reportError("OBJ INDEX OUT OF RANGE", name, 0);
+        }
+
+        result.layout = importLayout(hasNormals, hasTexCoords, hasColors);
+        std::size_t stride = result.layout.SourceFloats();
+        result.indices.resize(corners);
+        std::vector<uint32_t> keys;
+
+        if (!hasTexCoords && !hasNormals) {
+            //positions are the vertices already, nothing to deduplicate
+            std::size_t index = 0;
+            for (const ObjChunk& chunk : chunks) {
+                for (std::size_t i = 0; i < chunk.corners.size(); i += 3) {
+                    result.indices[index++] = (unsigned int)chunk.corners[i];
+                }
+            }
+            keys.resize(positions * 3, kMissingIndex);
+            for (std::size_t v = 0; v < positions; ++v) {
+                keys[v * 3] = (uint32_t)v;
+            }
+        } else {
+            CornerTable table(positions);
+            keys.reserve(positions * 3);
+            std::size_t index = 0;
+            for (const ObjChunk& chunk : chunks) {
+                for (std::size_t i = 0; i < chunk.corners.size(); i += 3) {
+                    uint32_t key[3] = { (uint32_t)chunk.corners[i], (uint32_t)chunk.corners[i + 1], (uint32_t)chunk.corners[i + 2] };
+                    result.indices[index++] = table.Insert(key, keys);
+                }
+            }
+        }
+
+        //gather the attribute lists of all chunks, then interleave every unique vertex in parallel
+        auto flatten = [&chunks](std::vector<float> ObjChunk::*member, std::size_t total) {
+            std::vector<float> all;
+            all.reserve(total);
+            for (ObjChunk& chunk : chunks) {
+                all.insert(all.end(), (chunk.*member).begin(), (chunk.*member).end());
+                std::vector<float>().swap(chunk.*member);
+            }
+            return all;
+        };
+        std::vector<float> allPositions = flatten(&ObjChunk::positions, positions * 3);
+        std::vector<float> allNormals = flatten(&ObjChunk::normals, normals * 3);
+        std::vector<float> allTexCoords = flatten(&ObjChunk::texCoords, texCoords * 2);
+        std::vector<float> allColors = hasColors ? flatten(&ObjChunk::colors, colors * 3) : std::vector<float>();
+
+        std::size_t vertexCount = keys.size() / 3;
+        result.vertices.assign(vertexCount * stride, 0.0f);
+        std::vector<Range> vertexRanges;
+        for (std::size_t c = 0; c < chunkCount; ++c) {
+            vertexRanges.push_back({ vertexCount * c / chunkCount, vertexCount * (c + 1) / chunkCount });
+        }
+        parallelFor((int)chunkCount, [&](int c) {
+            for (std::size_t v = vertexRanges[c].begin; v < vertexRanges[c].end; ++v) {
+                const uint32_t* key = &keys[v * 3];
+                float* out = &result.vertices[v * stride];
+                std::memcpy(out, &allPositions[key[0] * 3], 3 * sizeof(float));
+                out += 3;
+                if (hasNormals) {
+                    if (key[2] != kMissingIndex) {
+                        std::memcpy(out, &allNormals[key[2] * 3], 3 * sizeof(float));
+                    }
+                    out += 3;
+                }
+                if (hasTexCoords) {
+                    if (key[1] != kMissingIndex) {
+                        std::memcpy(out, &allTexCoords[key[1] * 2], 2 * sizeof(float));
+                    }
+                    out += 2;
+                }
+                if (hasColors) {
+                    std::memcpy(out, &allColors[key[0] * 3], 3 * sizeof(float));
+                }
+            }
+        });
+        return true;
+    }
+
+//--------------------------------------------------PLY----------------------------------------------------------------------
+
+    enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+    struct PlyProperty {
+        std::string name;
+        PlyType type = PlyType::Invalid;
+        bool list = false;
+        PlyType countType = PlyType::Invalid;
+        int target = -1;            //vertex: float slot in the imported vertex, -1 = not imported
+        float scale = 1.0f;         //vertex: integer colors are normalized
+    };
+
+    struct PlyElement {
+        std::string name;
+        std::size_t count = 0;
+        std::vector<PlyProperty> properties;
+    };
+
+    struct PlyHeader {
+        enum Format { Ascii, BinaryLittleEndian, BinaryBigEndian } format = Ascii;
+        std::vector<PlyElement> elements;
+        std::size_t bodyOffset = 0;
+    };
+
+    PlyType plyType(const std::string& name)
+    {
+        if (name == "char" || name == "int8") return PlyType::Int8;
+        if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+        if (name == "short" || name == "int16") return PlyType::Int16;
+        if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+        if (name == "int" || name == "int32") return PlyType::Int32;
+        if (name == "uint" || name == "uint32") return PlyType::UInt32;
+        if (name == "float" || name == "float32") return PlyType::Float32;
+        if (name == "double" || name == "float64") return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    std::size_t plyTypeSize(PlyType type)
+    {
+        static const std::size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+        return sizes[(int)type];
+    }
+
+    bool parsePlyHeader(const char* data, std::size_t size, PlyHeader& header)
+    {
+        const char* p = data;
+        const char* end = data + size;
+        bool first = true;
+        while (p < end) {
+            const char* eol = lineEnd(p, end);
+            std::istringstream line(std::string(p, eol));
+            p = eol + 1;
+            std::string keyword;
+            line >> keyword;
+            if (first) {
+                if (keyword != "ply") {
+                    return false;
+                }
+                first = false;
+            } else if (keyword == "format") {
+                std::string format;
+                line >> format;
+                if (format == "ascii") {
+                    header.format = PlyHeader::Ascii;
+                } else if (format == "binary_little_endian") {
+                    header.format = PlyHeader::BinaryLittleEndian;
+                } else if (format == "binary_big_endian") {
+                    header.format = PlyHeader::BinaryBigEndian;
+                } else {
+                    return false;
+                }
+            } else if (keyword == "element") {
+                PlyElement element;
+                line >> element.name >> element.count;
+                header.elements.push_back(element);
+            } else if (keyword == "property") {
+                if (header.elements.empty()) {
+                    return false;
+                }
+                PlyProperty property;
+                std::string type;
+                line >> type;
+                if (type == "list") {
+                    std::string countType;
+                    line >> countType >> type;
+                    property.list = true;
+                    property.countType = plyType(countType);
+                    if (property.countType == PlyType::Invalid) {
+                        return false;
+                    }
+                }
+                line >> property.name;
+                property.type = plyType(type);
+                if (property.type == PlyType::Invalid) {
+                    return false;
+                }
+                header.elements.back().properties.push_back(property);
+            } else if (keyword == "end_header") {
+                header.bodyOffset = (std::size_t)(p - data);
+                return p <= end;
+            }
+            //comment, obj_info
+        }
+        return false;
+    }
+
+    //maps the vertex properties we know onto the imported vertex, returns the layout
+    VertexLayout mapPlyVertex(PlyElement& vertex)
+    {
+        auto find = [&vertex](std::initializer_list<const char*> names) -> PlyProperty* {
+            for (PlyProperty& property : vertex.properties) {
+                for (const char* name : names) {
+                    if (!property.list && property.name == name) {
+                        return &property;
+                    }
+                }
+            }
+            return nullptr;
+        };
+        PlyProperty* position[3] = { find({ "x" }), find({ "y" }), find({ "z" }) };
+        PlyProperty* normal[3] = { find({ "nx" }), find({ "ny" }), find({ "nz" }) };
+        PlyProperty* texCoord[2] = { find({ "u", "s", "texture_u", "texture_s" }), find({ "v", "t", "texture_v", "texture_t" }) };
+        PlyProperty* color[3] = { find({ "red", "diffuse_red", "r" }), find({ "green", "diffuse_green", "g" }), find({ "blue", "diffuse_blue", "b" }) };
+        bool hasNormals = normal[0] && normal[1] && normal[2];
+        bool hasTexCoords = texCoord[0] && texCoord[1];
+        bool hasColors = color[0] && color[1] && color[2];
+
+        int slot = 0;
+        auto assign = [&slot](PlyProperty** properties, int count) {
+            for (int i = 0; i < count; ++i, ++slot) {
+                if (properties[i]) {
+                    properties[i]->target = slot;
+                }
+            }
+        };
+        assign(position, 3);
+        if (hasNormals) {
+            assign(normal, 3);
+        }
+        if (hasTexCoords) {
+            assign(texCoord, 2);
+        }
+        if (hasColors) {
+            for (PlyProperty* property : color) {
+                property->scale = property->type == PlyType::UInt8 ? 1.0f / 255.0f : (property->type == PlyType::UInt16 ? 1.0f / 65535.0f : 1.0f);
+            }
+            assign(color, 3);
+        }
+        return importLayout(hasNormals, hasTexCoords, hasColors);
+    }
+
+    template <typename T>
+    T loadBinary(const char* p, bool swap)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, p, sizeof(T));
+        if (swap) {
+            std::reverse(bytes, bytes + sizeof(T));
+        }
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    double readBinary(const char* p, PlyType type, bool swap)
+    {
+        switch (type) {
+            case PlyType::Int8: return (int8_t)*p;
+            case PlyType::UInt8: return (uint8_t)*p;
+            case PlyType::Int16: return loadBinary<int16_t>(p, swap);
+            case PlyType::UInt16: return loadBinary<uint16_t>(p, swap);
+            case PlyType::Int32: return loadBinary<int32_t>(p, swap);
+            case PlyType::UInt32: return loadBinary<uint32_t>(p, swap);
+            case PlyType::Float32: return loadBinary<float>(p, swap);
+            case PlyType::Float64: return loadBinary<double>(p, swap);
+            default: return 0.0;
+        }
+    }
+
+    //bytes of every record, 0 if the element has lists and records differ
+    std::size_t plyFixedStride(const PlyElement& element)
+    {
+        std::size_t stride = 0;
+        for (const PlyProperty& property : element.properties) {
+            if (property.list) {
+                return 0;
+            }
+            stride += plyTypeSize(property.type);
+        }
+        return stride;
+    }
+
+    bool isIndexList(const PlyProperty& property)
+    {
+        return property.list && (property.name == "vertex_indices" || property.name == "vertex_index");
+    }
+
+    //appends the fan of one polygon, false if an index is out of range
+    bool addPolygon(const int64_t* polygon, std::size_t count, std::size_t vertexCount, std::vector<unsigned int>& indices)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (polygon[i] < 0 || (std::size_t)polygon[i] >= vertexCount) {
+                return false;
+            }
+        }
+        for (std::size_t i = 1; i + 1 < count; ++i) {
+            indices.push_back((unsigned int)polygon[0]);
+            indices.push_back((unsigned int)polygon[i]);
+            indices.push_back((unsigned int)polygon[i + 1]);
+        }
+        return true;
+    }
+
+    //one record starting at `p`, vertex values go to `vertex` (null for faces), polygon indices to `polygon`; returns the end
+    const char* readBinaryRecord(const char* p, const char* end, const PlyElement& element, bool swap, float* vertex,
+                                 std::vector<int64_t>* polygon)
+    {
+        for (const PlyProperty& property : element.properties) {
+            std::size_t size = plyTypeSize(property.type);
+            if (property.list) {
+                std::size_t countSize = plyTypeSize(property.countType);
+                if (p + countSize > end) {
+                    return nullptr;
+                }
+                std::size_t count = (std::size_t)readBinary(p, property.countType, swap);
+                p += countSize;
+                if (count * size > (std::size_t)(end - p)) {
+                    return nullptr;
+                }
+                if (polygon && isIndexList(property)) {
+                    for (std::size_t i = 0; i < count; ++i, p += size) {
+                        polygon->push_back((int64_t)readBinary(p, property.type, swap));
+                    }
+                } else {
+                    p += count * size;
+                }
+            } else {
+                if (p + size > end) {
+                    return nullptr;
+                }
+                if (vertex && property.target >= 0) {
+                    vertex[property.target] = (float)readBinary(p, property.type, swap) * property.scale;
+                }
+                p += size;
+            }
+        }
+        return p;
+    }
+
+    const char* readAsciiRecord(const char* p, const char* end, const PlyElement& element, float* vertex, std::vector<int64_t>* polygon)
+    {
+        for (const PlyProperty& property : element.properties) {
+            if (property.list) {
+                int64_t count = 0;
+                if (!parseInteger(p, end, count) || count < 0) {
+                    return nullptr;
+                }
+                bool indices = polygon && isIndexList(property);
+                for (int64_t i = 0; i < count; ++i) {
+                    int64_t index = 0;
+                    if (indices) {
+                        if (!parseInteger(p, end, index)) {
+                            return nullptr;
+                        }
+                        polygon->push_back(index);
+                    } else {
+                        p = skipToken(p, end);
+                    }
+                }
+            } else if (vertex && property.target >= 0) {
+                float value = 0.0f;
+                if (!parseFloat(p, end, value)) {
+                    return nullptr;
+                }
+                vertex[property.target] = value * property.scale;
+            } else {
+                p = skipToken(p, end);
+            }
+        }
+        return p;
+    }
+
+}
+
+//--------------------------------------------------ENTRY POINTS----------------------------------------------------------------------
+
+namespace MeshImporter {
+
+    bool Load(const std::string& path, Result& result, const Options& options)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (extension != ".obj" && extension != ".ply") {
+            std::cout << "ERROR: MESH IMPORT UNSUPPORTED FORMAT: " << path << std::endl;
+            return false;
+        }
+
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::cout << "ERROR: MESH IMPORT COULD NOT OPEN: " << path << std::endl;
+            return false;
+        }
+        const char* data = (const char*)file.Data();
+        bool loaded = extension == ".obj" ? ParseOBJ(data, file.Size(), result, options, path)
+                                          : ParsePLY(data, file.Size(), result, options, path);
+        result.stats.totalMs = millisecondsSince(start);
+        return loaded;
+    }
+
+    bool ParseOBJ(const char* data, std::size_t size, Result& result, const Options& options, const std::string& name)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result = Result();
+        result.stats.fileBytes = size;
+
+        std::vector<Range> ranges = splitLines(data, 0, size, threadCount(options, size));
+        std::vector<ObjChunk> chunks(ranges.size());
+        parallelFor((int)ranges.size(), [&](int c) { parseObjChunk(data, ranges[c], chunks[c]); });
+        result.stats.threads = (int)ranges.size();
+        result.stats.parseMs = millisecondsSince(start);
+        for (const ObjChunk& chunk : chunks) {
+            if (chunk.error) {
+                return reportError(chunk.error, name, chunk.errorOffset);
+            }
+        }
+
+        auto merge = std::chrono::steady_clock::now();
+        if (!mergeObjChunks(chunks, result, name)) {
+            return false;
+        }
+        result.stats.mergeMs = millisecondsSince(merge);
+        result.stats.vertices = result.vertices.size() / result.layout.SourceFloats();
+        result.stats.triangles = result.indices.size() / 3;
+        result.stats.totalMs = millisecondsSince(start);
+        return true;
+    }
+
+    bool ParsePLY(const char* data, std::size_t size, Result& result, const Options& options, const std::string& name)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result = Result();
+        result.stats.fileBytes = size;
+
+        PlyHeader header;
+        if (!parsePlyHeader(data, size, header)) {
+            return reportError("PLY HEADER INVALID", name, 0);
+        }
+        PlyElement* vertexElement = nullptr;
+        for (PlyElement& element : header.elements) {
+            if (element.name == "vertex") {
+                vertexElement = &element;
+            }
+        }
+        if (!vertexElement || !vertexElement->properties.size()) {
+            return reportError("PLY HAS NO VERTICES", name, 0);
+        }
+        result.layout = mapPlyVertex(*vertexElement);
+        std::size_t stride = result.layout.SourceFloats();
+        std::size_t vertexCount = vertexElement->count;
+        if (vertexCount > 0xFFFFFFFEu) {
+            return reportError("PLY TOO LARGE", name, 0);
+        }
+        result.vertices.assign(vertexCount * stride, 0.0f);
+
+        bool ascii = header.format == PlyHeader::Ascii;
+        bool swap = header.format == PlyHeader::BinaryBigEndian;
+        const char* end = data + size;
+        const char* p = data + header.bodyOffset;
+        int threads = threadCount(options, size);
+        result.stats.threads = 1;
+
+        for (const PlyElement& element : header.elements) {
+            bool isVertex = &element == vertexElement;
+            bool isFace = element.name == "face";
+            std::size_t fixedStride = plyFixedStride(element);
+            std::atomic<bool> valid(true);
+
+            //records in `count` chunks that start at known record numbers: binary fixed size records are computed,
+            //ascii records are lines and the chunk starts are found with one memchr pass
+            std::vector<const char*> chunkStarts;
+            std::vector<std::size_t> chunkFirst;
+            int chunks = (isVertex || isFace) && element.count > 0 ? std::min<int>(threads, (int)std::min<std::size_t>(element.count, 1 << 20)) : 1;
+            const char* elementEnd = nullptr;
+            if (!ascii && fixedStride) {
+                if (element.count * fixedStride > (std::size_t)(end - p)) {
+                    return reportError("PLY TRUNCATED", name, (std::size_t)(p - data));
+                }
+                for (int c = 0; c < chunks; ++c) {
+                    chunkFirst.push_back(element.count * c / chunks);
+                    chunkStarts.push_back(p + chunkFirst.back() * fixedStride);
+                }
+                elementEnd = p + element.count * fixedStride;
+            } else if (ascii) {
+                const char* q = p;
+                for (std::size_t record = 0; record < element.count; ++record) {
+                    if ((int)chunkStarts.size() < chunks && record == element.count * chunkStarts.size() / chunks) {
+                        chunkStarts.push_back(q);
+                        chunkFirst.push_back(record);
+                    }
+                    if (q >= end) {
+                        return reportError("PLY TRUNCATED", name, (std::size_t)(q - data));
+                    }
+                    q = lineEnd(q, end) + 1;
+                }
+                elementEnd = std::min(q, end);
+                chunks = (int)chunkStarts.size();
+            } else {
+                //binary with lists: record sizes are only known by walking them
+                chunks = 1;
+                chunkStarts.push_back(p);
+                chunkFirst.push_back(0);
+            }
+            chunkFirst.push_back(element.count);
+
+            if (!isVertex && !isFace) {
+                //skip elements we don't import (edges, materials...)
+                if (!elementEnd) {
+                    const char* q = p;
+                    for (std::size_t record = 0; q && record < element.count; ++record) {
+                        q = readBinaryRecord(q, end, element, swap, nullptr, nullptr);
+                    }
+                    if (!q) {
+                        return reportError("PLY TRUNCATED", name, (std::size_t)(p - data));
+                    }
+                    elementEnd = q;
+                }
+                p = elementEnd;
+                continue;
+            }
+
+            if (isVertex) {
+                const char* walked = nullptr;
+                parallelFor(chunks, [&](int c) {
+                    const char* q = chunkStarts[c];
+                    for (std::size_t v = chunkFirst[c]; q && v < chunkFirst[c + 1]; ++v) {
+                        float* vertex = &result.vertices[v * stride];
+                        q = ascii ? readAsciiRecord(q, end, element, vertex, nullptr)
+                                  : readBinaryRecord(q, end, element, swap, vertex, nullptr);
+                        if (q && ascii) {
+                            q = lineEnd(q, end) + 1;
+                        }
+                    }
+                    if (!q) {
+                        valid = false;
+                    } else if (c == chunks - 1) {
+                        walked = q;
+                    }
+                });
+                if (!valid) {
+                    return reportError("PLY VERTEX PARSE FAILED", name, (std::size_t)(p - data));
+                }
+                p = elementEnd ? elementEnd : walked;
+                result.stats.threads = std::max(result.stats.threads, chunks);
+                continue;
+            }
+
+            //faces: binary triangle-only files are the common case for scans, read those as fixed size records in
+            //parallel and check every count; anything else goes record by record
+            std::size_t triangleStride = 0;
+            if (!ascii && element.properties.size() == 1 && isIndexList(element.properties[0])) {
+                triangleStride = plyTypeSize(element.properties[0].countType) + 3 * plyTypeSize(element.properties[0].type);
+            }
+            if (triangleStride && element.count * triangleStride <= (std::size_t)(end - p)) {
+                const PlyProperty& list = element.properties[0];
+                std::size_t countSize = plyTypeSize(list.countType);
+                std::size_t indexSize = plyTypeSize(list.type);
+                std::vector<unsigned int> indices(element.count * 3);
+                std::atomic<bool> triangles(true), inRange(true);
+                int faceChunks = std::min<int>(threads, (int)std::max<std::size_t>(1, std::min<std::size_t>(element.count, 1 << 20)));
+                parallelFor(faceChunks, [&](int c) {
+                    std::size_t first = element.count * c / faceChunks;
+                    std::size_t last = element.count * (c + 1) / faceChunks;
+                    const char* q = p + first * triangleStride;
+                    for (std::size_t f = first; f < last && triangles; ++f, q += triangleStride) {
+                        if (readBinary(q, list.countType, swap) != 3.0) {
+                            triangles = false;
+                            return;
+                        }
+                        for (int corner = 0; corner < 3; ++corner) {
+                            double index = readBinary(q + countSize + corner * indexSize, list.type, swap);
+                            if (index < 0.0 || index >= (double)vertexCount) {
+                                inRange = false;
+                                return;
+                            }
+                            indices[f * 3 + corner] = (unsigned int)index;
+                        }
+                    }
+                });
+                //past a polygon that isn't a triangle every record is misaligned and the indices the chunks read mean
+                //nothing, so a range error only counts for a triangle-only element; the loop below reads the rest
+                if (triangles) {
+                    if (!inRange) {
+                        return reportError("PLY INDEX OUT OF RANGE", name, (std::size_t)(p - data));
+                    }
+                    result.indices.insert(result.indices.end(), indices.begin(), indices.end());
+                    p += element.count * triangleStride;
+                    result.stats.threads = std::max(result.stats.threads, faceChunks);
+                    continue;
+                }
+            }
+
+            std::vector<std::vector<unsigned int>> chunkIndices(chunks);
+            const char* walked = nullptr;
+            parallelFor(chunks, [&](int c) {
+                std::vector<int64_t> polygon;
+                const char* q = chunkStarts[c];
+                for (std::size_t f = chunkFirst[c]; q && f < chunkFirst[c + 1]; ++f) {
+                    polygon.clear();
+                    q = ascii ? readAsciiRecord(q, end, element, nullptr, &polygon)
+                              : readBinaryRecord(q, end, element, swap, nullptr, &polygon);
+                    if (q && !addPolygon(polygon.data(), polygon.size(), vertexCount, chunkIndices[c])) {
+                        q = nullptr;
+                    }
+                    if (q && ascii) {
+                        q = lineEnd(q, end) + 1;
+                    }
+                }
+                if (!q) {
+                    valid = false;
+                } else if (c == chunks - 1) {
+                    walked = q;
+                }
+            });
+            if (!valid) {
+                return reportError("PLY FACE PARSE FAILED", name, (std::size_t)(p - data));
+            }
+            for (const std::vector<unsigned int>& indices : chunkIndices) {
+                result.indices.insert(result.indices.end(), indices.begin(), indices.end());
+            }
+            p = elementEnd ? elementEnd : walked;
+            result.stats.threads = std::max(result.stats.threads, chunks);
+        }
+
+        result.stats.parseMs = millisecondsSince(start);
+        result.stats.vertices = vertexCount;
+        result.stats.triangles = result.indices.size() / 3;
+        result.stats.totalMs = result.stats.parseMs;
+        return true;
+    }
+
+}
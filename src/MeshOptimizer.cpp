@@ -0,0 +1,834 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace MeshOptimizer {
+
+//FNV-1a over the raw bytes of one record, so -0.0 and 0.0 (or different NaNs) stay distinct vertices
+static uint32_t hashRecord(const float* record, std::size_t stride)
+{
+    const unsigned char* bytes = (const unsigned char*)record;
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < stride * sizeof(float); ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::size_t DeduplicateVertices(const float* vertices, std::size_t vertexCount, std::size_t stride,
+                                std::vector<float>& uniqueVertices, std::vector<unsigned int>& indices)
+{
+    uniqueVertices.clear();
+    indices.resize(vertexCount);
+    if (vertexCount == 0) {
+        return 0;
+    }
+
+    //open addressing table of unique vertex ids, sized to a power of two at most half full
+    std::size_t tableSize = 1;
+    while (tableSize < vertexCount * 2) {
+        tableSize <<= 1;
+    }
+    const unsigned int empty = ~0u;
+    std::vector<unsigned int> table(tableSize, empty);
+    std::size_t mask = tableSize - 1;
+    std::size_t recordBytes = stride * sizeof(float);
+
+    uniqueVertices.reserve(vertexCount * stride);
+    unsigned int uniqueCount = 0;
+
+    for (std::size_t i = 0; i < vertexCount; ++i) {
+        const float* record = vertices + i * stride;
+        std::size_t slot = hashRecord(record, stride) & mask;
+
+        //linear probing until we hit the same record or an empty slot
+        while (table[slot] != empty &&
+               std::memcmp(uniqueVertices.data() + (std::size_t)table[slot] * stride, record, recordBytes) != 0) {
+            slot = (slot + 1) & mask;
+        }
+
+        if (table[slot] == empty) {
+            table[slot] = uniqueCount++;
+            uniqueVertices.insert(uniqueVertices.end(), record, record + stride);
+        }
+        indices[i] = table[slot];
+    }
+    return uniqueCount;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, std::size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) {
+        return stats;
+    }
+
+    //FIFO by timestamps: the clock only ticks on a miss, so a vertex is still cached for the next `cacheSize` misses
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int timestamp = cacheSize + 1;
+    for (unsigned int index : indices) {
+        if (timestamp - cacheTime[index] > cacheSize) {
+            cacheTime[index] = timestamp++;
+            stats.transformedVertices++;
+        }
+    }
+
+    //only vertices that are actually referenced count for ATVR
+    std::vector<bool> used(vertexCount, false);
+    std::size_t usedCount = 0;
+    for (unsigned int index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = (float)stats.transformedVertices / (indices.size() / 3);
+    stats.atvr = (float)stats.transformedVertices / usedCount;
+    return stats;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, std::size_t vertexCount, unsigned int cacheSize, std::vector<std::size_t>* clusters)
+{
+    std::size_t triangleCount = indices.size() / 3;
+    if (clusters) {
+        clusters->clear();
+    }
+    if (triangleCount == 0) {
+        return;
+    }
+
+    //vertex -> triangles adjacency in compressed rows, liveCount = triangles of the vertex not emitted yet
+    std::vector<unsigned int> liveCount(vertexCount, 0);
+    for (unsigned int index : indices) {
+        liveCount[index]++;
+    }
+    std::vector<std::size_t> offsets(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] = offsets[v] + liveCount[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+        }
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int timestamp = cacheSize + 1;
+    std::size_t cursor = 0;
+
+    //recently used vertices that still have triangles first, else the next vertex in input order; -1 when done
+    auto skipDeadEnd = [&]() -> long long {
+        while (!deadEnd.empty()) {
+            unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveCount[vertex] > 0) {
+                return vertex;
+            }
+        }
+        while (cursor < vertexCount) {
+            if (liveCount[cursor] > 0) {
+                return (long long)cursor;
+            }
+            cursor++;
+        }
+        return -1;
+    };
+
+    long long fanning = skipDeadEnd();
+    if (clusters) {
+        clusters->push_back(0);
+    }
+
+    while (fanning >= 0) {
+        //emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (std::size_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                unsigned int vertex = indices[triangle * 3 + k];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveCount[vertex]--;
+                if (timestamp - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = timestamp++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        //next fanning vertex: the oldest candidate that will still be in the cache after emitting its triangles
+        long long next = -1;
+        long long bestPriority = -1;
+        for (unsigned int vertex : candidates) {
+            if (liveCount[vertex] == 0) {
+                continue;
+            }
+            long long priority = 0;
+            long long age = timestamp - cacheTime[vertex];
+            if (age + 2 * (long long)liveCount[vertex] <= cacheSize) {
+                priority = age;
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next == -1) {
+            next = skipDeadEnd();
+            if (clusters && next != -1) {
+                clusters->push_back(output.size() / 3);
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, std::size_t stride,
+                      const std::vector<std::size_t>& clusters, float threshold, unsigned int cacheSize)
+{
+    std::size_t triangleCount = indices.size() / 3;
+    std::size_t vertexCount = vertices.size() / stride;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<std::size_t> hardClusters = clusters;
+    if (hardClusters.empty() || hardClusters[0] != 0) {
+        hardClusters.insert(hardClusters.begin(), 0);
+    }
+
+    //soft boundaries: inside each hard cluster start a new cluster whenever the run so far
+    //is already as cache friendly as the whole cluster (within threshold), so splitting costs little ACMR
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int timestamp = cacheSize + 1;
+    auto flush = [&]() { timestamp += cacheSize + 1; };
+    auto misses = [&](std::size_t triangle) {
+        unsigned int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int vertex = indices[triangle * 3 + k];
+            if (timestamp - cacheTime[vertex] > cacheSize) {
+                cacheTime[vertex] = timestamp++;
+                count++;
+            }
+        }
+        return count;
+    };
+
+    std::vector<std::size_t> softClusters;
+    for (std::size_t h = 0; h < hardClusters.size(); ++h) {
+        std::size_t start = hardClusters[h];
+        std::size_t end = h + 1 < hardClusters.size() ? hardClusters[h + 1] : triangleCount;
+
+        flush();
+        std::size_t clusterMisses = 0;
+        for (std::size_t t = start; t < end; ++t) {
+            clusterMisses += misses(t);
+        }
+        float target = threshold * clusterMisses / (float)(end - start);
+
+        flush();
+        softClusters.push_back(start);
+        std::size_t begin = start, runMisses = 0;
+        for (std::size_t t = start; t < end; ++t) {
+            runMisses += misses(t);
+            if (t + 1 < end && runMisses <= target * (t + 1 - begin)) {
+                softClusters.push_back(t + 1);
+                begin = t + 1;
+                runMisses = 0;
+                flush();
+            }
+        }
+    }
+
+    //sort key: how much the cluster faces away from the mesh center, outer surfaces occlude the inner ones
+    auto position = [&](unsigned int vertex) { return vertices.data() + (std::size_t)vertex * stride; };
+
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+    std::vector<double> clusterKeys(softClusters.size());
+    std::vector<double> clusterData(softClusters.size() * 7, 0.0);    //area-weighted centroid xyz, normal sum xyz, area
+
+    for (std::size_t c = 0; c < softClusters.size(); ++c) {
+        std::size_t start = softClusters[c];
+        std::size_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : triangleCount;
+        double* data = &clusterData[c * 7];
+
+        for (std::size_t t = start; t < end; ++t) {
+            const float* p0 = position(indices[t * 3 + 0]);
+            const float* p1 = position(indices[t * 3 + 1]);
+            const float* p2 = position(indices[t * 3 + 2]);
+            double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            double normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (int k = 0; k < 3; ++k) {
+                double center = (p0[k] + p1[k] + p2[k]) / 3.0;
+                data[k] += center * area;
+                data[3 + k] += normal[k];
+                meshCentroid[k] += center * area;
+            }
+            data[6] += area;
+            meshArea += area;
+        }
+    }
+
+    for (int k = 0; k < 3; ++k) {
+        meshCentroid[k] = meshArea > 0.0 ? meshCentroid[k] / meshArea : 0.0;
+    }
+
+    for (std::size_t c = 0; c < softClusters.size(); ++c) {
+        const double* data = &clusterData[c * 7];
+        double area = data[6] > 0.0 ? data[6] : 1.0;
+        double normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        double key = 0.0;
+        if (normalLength > 0.0) {
+            for (int k = 0; k < 3; ++k) {
+                key += (data[k] / area - meshCentroid[k]) * data[3 + k] / normalLength;
+            }
+        }
+        clusterKeys[c] = key;
+    }
+
+    std::vector<std::size_t> order(softClusters.size());
+    for (std::size_t c = 0; c < order.size(); ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return clusterKeys[a] > clusterKeys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (std::size_t c : order) {
+        std::size_t start = softClusters[c];
+        std::size_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+std::size_t OptimizeVertexFetch(std::vector<float>& vertices, std::size_t stride, std::vector<unsigned int>& indices)
+{
+    std::size_t vertexCount = vertices.size() / stride;
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertexCount, unused);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+
+    unsigned int next = 0;
+    for (unsigned int& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = next++;
+            reordered.insert(reordered.end(), vertices.begin() + (std::size_t)index * stride, vertices.begin() + ((std::size_t)index + 1) * stride);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+    return next;
+}
+
+//symmetric 4x4 plane quadric, `weight` is the area it was accumulated over so the error can be normalized to a distance
+struct Quadric {
+    double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    //plane n.p + d = 0, n unit length
+    void AddPlane(double nx, double ny, double nz, double d, double w) {
+        a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+        a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+        b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void Add(const Quadric& other) {
+        a00 += other.a00; a11 += other.a11; a22 += other.a22;
+        a01 += other.a01; a02 += other.a02; a12 += other.a12;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    //weighted squared distance sum
+    double Evaluate(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                        2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(result, 0.0);
+    }
+};
+
+//plane through three points weighted by the triangle area, false for degenerate triangles
+static bool trianglePlane(const float* p0, const float* p1, const float* p2, double plane[4], double& area)
+{
+    double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+    double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+    double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length <= 0.0) {
+        return false;
+    }
+    for (int c = 0; c < 3; ++c) {
+        plane[c] = n[c] / length;
+    }
+    plane[3] = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+    area = length * 0.5;
+    return true;
+}
+
+static uint64_t edgeKey(unsigned int a, unsigned int b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+float Simplify(const std::vector<float>& vertices, std::size_t stride, const std::vector<unsigned int>& indices,
+               std::size_t targetIndexCount, const SimplifyOptions& options, std::vector<unsigned int>& destination)
+{
+    destination.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    std::size_t vertexCount = vertices.size() / stride;
+    if (destination.size() <= targetIndexCount || vertexCount == 0) {
+        return 0.0f;
+    }
+    auto position = [&](unsigned int v) { return &vertices[(std::size_t)v * stride]; };
+
+    //vertex kinds: free ones collapse anywhere, border ones only along the border, locked ones never move
+    enum Kind : uint8_t { Free, Border, Locked };
+    std::vector<uint8_t> kind(vertexCount, Free);
+
+    //a vertex whose exact position shows up twice sits on an attribute seam
+    {
+        std::vector<unsigned int> byPosition(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            byPosition[v] = v;
+        }
+        std::sort(byPosition.begin(), byPosition.end(), [&](unsigned int a, unsigned int b) {
+            return std::memcmp(position(a), position(b), 3 * sizeof(float)) < 0;
+        });
+        for (std::size_t i = 1; i < vertexCount; ++i) {
+            if (std::memcmp(position(byPosition[i - 1]), position(byPosition[i]), 3 * sizeof(float)) == 0) {
+                kind[byPosition[i - 1]] = kind[byPosition[i]] = Locked;
+            }
+        }
+    }
+
+    //every triangle adds its plane to its corners
+    std::vector<Quadric> quadrics(vertexCount);
+    std::size_t triangleCount = indices.size() / 3;
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        const unsigned int* corner = &indices[t * 3];
+        double plane[4], area;
+        if (!trianglePlane(position(corner[0]), position(corner[1]), position(corner[2]), plane, area)) {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            quadrics[corner[k]].AddPlane(plane[0], plane[1], plane[2], plane[3], area);
+        }
+    }
+
+    //edges used once are open borders, more than twice non-manifold
+    std::vector<uint64_t> edges;
+    for (std::size_t i = 0; i < destination.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            edges.push_back(edgeKey(destination[i + k], destination[i + (k + 1) % 3]));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    auto uses = [&](unsigned int a, unsigned int b) {
+        auto range = std::equal_range(edges.begin(), edges.end(), edgeKey(a, b));
+        return (std::size_t)(range.second - range.first);
+    };
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        const unsigned int* corner = &indices[t * 3];
+        for (int k = 0; k < 3; ++k) {
+            unsigned int a = corner[k], b = corner[(k + 1) % 3];
+            std::size_t count = uses(a, b);
+            if (count > 2 || (count == 1 && options.lockBorder)) {
+                kind[a] = kind[b] = Locked;
+                continue;
+            }
+            if (count == 2) {
+                continue;
+            }
+            for (unsigned int v : { a, b }) {
+                kind[v] = kind[v] == Locked ? Locked : Border;
+            }
+            //a plane along the edge, perpendicular to its triangle, keeps the border on its line,
+            //weighted by the squared edge length so it holds about as firmly as the faces next to it
+            const float* p0 = position(a);
+            const float* p1 = position(b);
+            double face[4], area;
+            if (!trianglePlane(p0, p1, position(corner[(k + 2) % 3]), face, area)) {
+                continue;
+            }
+            double e[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+            double n[3] = { e[1] * face[2] - e[2] * face[1], e[2] * face[0] - e[0] * face[2], e[0] * face[1] - e[1] * face[0] };
+            double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length <= 0.0) {
+                continue;
+            }
+            double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]) / length;
+            for (unsigned int v : { a, b }) {
+                quadrics[v].AddPlane(n[0] / length, n[1] / length, n[2] / length, d, length * length * 10.0);
+            }
+        }
+    }
+
+    std::size_t attributeCount = std::min(options.attributeWeights.size(), stride > 3 ? stride - 3 : 0);
+    double maxErrorSquared = (double)options.maxError * options.maxError;
+    double reached = 0.0;
+
+    struct Collapse {
+        unsigned int source, target;
+        double cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> remap(vertexCount), adjacencyOffsets(vertexCount + 1), adjacency;
+    std::vector<uint8_t> touched(vertexCount);
+
+    //normalized quadric error of moving `source` onto `target`, plus the weighted attribute difference
+    auto cost = [&](unsigned int source, unsigned int target) {
+        Quadric combined = quadrics[source];
+        combined.Add(quadrics[target]);
+        const float* p = position(target);
+        double error = combined.weight > 0.0 ? combined.Evaluate(p) / combined.weight : 0.0;
+        for (std::size_t k = 0; k < attributeCount; ++k) {
+            double difference = (double)position(source)[3 + k] - position(target)[3 + k];
+            error += options.attributeWeights[k] * difference * difference;
+        }
+        return error;
+    };
+
+    auto consider = [&](unsigned int a, unsigned int b, bool border) {
+        Collapse best = { 0, 0, -1.0 };
+        for (int direction = 0; direction < 2; ++direction) {
+            unsigned int source = direction ? b : a;
+            unsigned int target = direction ? a : b;
+            bool allowed = kind[source] == Free || (kind[source] == Border && border && kind[target] != Free);
+            if (!allowed) {
+                continue;
+            }
+            double c = cost(source, target);
+            if (best.cost < 0.0 || c < best.cost) {
+                best = { source, target, c };
+            }
+        }
+        if (best.cost >= 0.0 && best.cost <= maxErrorSquared) {
+            collapses.push_back(best);
+        }
+    };
+
+    //passes of independent collapses, cheapest first, until the target or the error bound is reached
+    while (destination.size() > targetIndexCount) {
+        //an edge touching a free vertex is interior, the triangle running it from the lower to the higher index stands
+        //for it (consistently wound meshes see it exactly once); edges between border vertices may be open, those few
+        //are counted, edges between locked vertices can't collapse at all
+        collapses.clear();
+        edges.clear();
+        for (std::size_t i = 0; i < destination.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int a = destination[i + k], b = destination[i + (k + 1) % 3];
+                if (kind[a] == Free || kind[b] == Free) {
+                    if (a < b) {
+                        consider(a, b, false);
+                    }
+                } else if (kind[a] == Border || kind[b] == Border) {
+                    edges.push_back(edgeKey(a, b));
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (std::size_t i = 0; i < edges.size();) {
+            std::size_t end = i + 1;
+            while (end < edges.size() && edges[end] == edges[i]) {
+                end++;
+            }
+            consider((unsigned int)(edges[i] >> 32), (unsigned int)edges[i], end - i == 1);
+            i = end;
+        }
+        if (collapses.empty()) {
+            break;
+        }
+
+        //an interior collapse removes two triangles, candidates past what the target needs are left for the next pass
+        //instead of reaching for expensive ones while cheap ones are only blocked by their neighbours
+        std::size_t triangles = destination.size() / 3;
+        std::size_t targetTriangles = targetIndexCount / 3;
+        std::size_t candidates = std::min(collapses.size(), (triangles - std::min(triangles, targetTriangles)) / 2 + 1);
+        auto cheaper = [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; };
+        std::nth_element(collapses.begin(), collapses.begin() + (candidates - 1), collapses.end(), cheaper);
+        std::sort(collapses.begin(), collapses.begin() + candidates, cheaper);
+
+        //triangles around every vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int index : destination) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (std::size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(destination.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (std::size_t i = 0; i < destination.size(); ++i) {
+                adjacency[fill[destination[i]]++] = (unsigned int)(i / 3);
+            }
+        }
+
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+        std::size_t collapsed = 0;
+        for (std::size_t c = 0; c < candidates; ++c) {
+            const Collapse& collapse = collapses[c];
+            if (triangles <= targetTriangles) {
+                break;
+            }
+            if (touched[collapse.source] || touched[collapse.target]) {
+                continue;
+            }
+
+            //the source's other triangles must not turn over once it sits on the target
+            bool flips = false;
+            std::size_t removed = 0;
+            const float* moved = position(collapse.target);
+            for (unsigned int a = adjacencyOffsets[collapse.source]; a < adjacencyOffsets[collapse.source + 1] && !flips; ++a) {
+                const unsigned int* corner = &destination[(std::size_t)adjacency[a] * 3];
+                if (corner[0] == collapse.target || corner[1] == collapse.target || corner[2] == collapse.target) {
+                    removed++;
+                    continue;
+                }
+                const float* p[3];
+                const float* q[3];
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = position(corner[k]);
+                    q[k] = corner[k] == collapse.source ? moved : p[k];
+                }
+                float before[3], after[3];
+                for (int pass = 0; pass < 2; ++pass) {
+                    const float* const* r = pass ? q : p;
+                    float* n = pass ? after : before;
+                    float e1[3] = { r[1][0] - r[0][0], r[1][1] - r[0][1], r[1][2] - r[0][2] };
+                    float e2[3] = { r[2][0] - r[0][0], r[2][1] - r[0][1], r[2][2] - r[0][2] };
+                    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                }
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[collapse.source] = collapse.target;
+            quadrics[collapse.target].Add(quadrics[collapse.source]);
+            //the neighbourhood changed, its other collapses wait for the next pass
+            for (unsigned int a = adjacencyOffsets[collapse.source]; a < adjacencyOffsets[collapse.source + 1]; ++a) {
+                const unsigned int* corner = &destination[(std::size_t)adjacency[a] * 3];
+                touched[corner[0]] = touched[corner[1]] = touched[corner[2]] = 1;
+            }
+            triangles -= std::min(triangles, removed);
+            reached = std::max(reached, collapse.cost);
+            collapsed++;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        //apply the pass and drop the triangles that degenerated
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < destination.size(); i += 3) {
+            unsigned int a = remap[destination[i]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            destination[kept++] = a;
+            destination[kept++] = b;
+            destination[kept++] = c;
+        }
+        destination.resize(kept);
+    }
+    return (float)std::sqrt(reached);
+}
+
+//bounding sphere around the box of the meshlet's vertices, normal cone around the mean of its triangle normals
+static void meshletBounds(Meshlet& meshlet, const unsigned int* indices, const std::vector<float>& vertices, std::size_t stride)
+{
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+        const float* p = &vertices[(std::size_t)indices[i] * stride];
+        for (int c = 0; c < 3; ++c) {
+            boundsMin[c] = std::min(boundsMin[c], p[c]);
+            boundsMax[c] = std::max(boundsMax[c], p[c]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        meshlet.center[c] = (boundsMin[c] + boundsMax[c]) * 0.5f;
+    }
+    for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+        const float* p = &vertices[(std::size_t)indices[i] * stride];
+        float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    std::vector<float> normals;
+    normals.reserve(meshlet.indexCount);
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3) {
+        double plane[4], area;
+        if (!trianglePlane(&vertices[(std::size_t)indices[i] * stride], &vertices[(std::size_t)indices[i + 1] * stride],
+                           &vertices[(std::size_t)indices[i + 2] * stride], plane, area)) {
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            normals.push_back((float)plane[c]);
+            axis[c] += (float)plane[c];
+        }
+    }
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minDot = 1.0f;
+    for (int c = 0; c < 3; ++c) {
+        meshlet.coneAxis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+    }
+    for (std::size_t n = 0; n < normals.size(); n += 3) {
+        minDot = std::min(minDot, normals[n] * meshlet.coneAxis[0] + normals[n + 1] * meshlet.coneAxis[1] + normals[n + 2] * meshlet.coneAxis[2]);
+    }
+    //a cone of 90 degrees or more has a triangle facing every viewer
+    meshlet.coneCutoff = length > 0.0f && minDot > 0.0f ? std::sqrt(std::max(0.0f, 1.0f - minDot * minDot)) : 1.0f;
+}
+
+void BuildMeshlets(std::vector<unsigned int>& indices, const std::vector<float>& vertices, std::size_t stride,
+                   std::vector<Meshlet>& meshlets, std::size_t maxVertices, std::size_t maxTriangles)
+{
+    meshlets.clear();
+    std::size_t triangleCount = indices.size() / 3;
+    std::size_t vertexCount = vertices.size() / stride;
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0) {
+        return;
+    }
+
+    //triangles around every vertex
+    std::vector<unsigned int> offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+        offsets[indices[i] + 1]++;
+    }
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+        }
+    }
+
+    std::vector<uint8_t> taken(triangleCount, 0);
+    std::vector<unsigned int> owner(vertexCount, ~0u);     //meshlet that already references the vertex
+    std::vector<unsigned int> order, candidates;
+    order.reserve(triangleCount * 3);
+    std::size_t seed = 0;
+    for (unsigned int id = 0;; ++id) {
+        while (seed < triangleCount && taken[seed]) {
+            seed++;
+        }
+        if (seed == triangleCount) {
+            break;
+        }
+
+        Meshlet meshlet = {};
+        meshlet.firstIndex = (uint32_t)order.size();
+        float sum[3] = { 0.0f, 0.0f, 0.0f };
+        std::size_t triangles = 0;
+        candidates.clear();
+        for (std::size_t next = seed;;) {
+            taken[next] = 1;
+            triangles++;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[next * 3 + k];
+                order.push_back(v);
+                if (owner[v] == id) {
+                    continue;
+                }
+                owner[v] = id;
+                meshlet.vertexCount++;
+                for (int c = 0; c < 3; ++c) {
+                    sum[c] += vertices[(std::size_t)v * stride + c];
+                }
+                for (unsigned int a = offsets[v]; a < offsets[v + 1]; ++a) {
+                    if (!taken[adjacency[a]]) {
+                        candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+            if (triangles == maxTriangles) {
+                break;
+            }
+
+            float center[3] = { sum[0] / meshlet.vertexCount, sum[1] / meshlet.vertexCount, sum[2] / meshlet.vertexCount };
+            std::size_t best = triangleCount;
+            int bestNew = 4;
+            float bestDistance = FLT_MAX;
+            for (std::size_t i = 0; i < candidates.size();) {
+                unsigned int t = candidates[i];
+                if (taken[t]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                i++;
+                int added = 0;
+                float centroid[3] = { 0.0f, 0.0f, 0.0f };
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int v = indices[(std::size_t)t * 3 + k];
+                    added += owner[v] != id;
+                    for (int c = 0; c < 3; ++c) {
+                        centroid[c] += vertices[(std::size_t)v * stride + c] * (1.0f / 3.0f);
+                    }
+                }
+                if (meshlet.vertexCount + added > maxVertices || added > bestNew) {
+                    continue;
+                }
+                float dx = centroid[0] - center[0], dy = centroid[1] - center[1], dz = centroid[2] - center[2];
+                float distance = dx * dx + dy * dy + dz * dz;
+                if (added < bestNew || distance < bestDistance) {
+                    best = t;
+                    bestNew = added;
+                    bestDistance = distance;
+                }
+            }
+            if (best == triangleCount) {
+                break;
+            }
+            next = best;
+        }
+        meshlet.indexCount = (uint32_t)(order.size() - meshlet.firstIndex);
+        meshletBounds(meshlet, &order[meshlet.firstIndex], vertices, stride);
+        meshlets.push_back(meshlet);
+    }
+    indices.swap(order);
+}
+
+}
@@ -0,0 +1,162 @@
+#include "MeshletCuller.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include "GLState.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static const std::size_t kMatrixBytes = 16 * sizeof(float);
+
+MeshletCuller::~MeshletCuller() {
+    Destroy();
+}
+
+bool MeshletCuller::SupportsIndirect() {
+    //baseInstance in the commands is 4.2, multi draw indirect itself 4.3
+    return hasGLVersion(4, 3) && GLEXT_ARB_multi_draw_indirect;
+}
+
+bool MeshletCuller::Create(const Options& options) {
+    Destroy();
+    options_ = options;
+    indirect_ = options_.indirect && SupportsIndirect();
+    glGenBuffers(1, &instances_);
+    if (indirect_) {
+        glGenBuffers(1, &commands_);
+    }
+    stats_ = Stats();
+    stats_.indirect = indirect_;
+    return true;
+}
+
+void MeshletCuller::Destroy() {
+    GLState& state = GLState::Get();
+    state.DeleteBuffer(instances_);
+    state.DeleteBuffer(commands_);
+    instances_ = commands_ = 0;
+    entries_.clear();
+}
+
+void MeshletCuller::BeginFrame(const Frustum& frustum, const Vec3& cameraPosition) {
+    frustum_ = frustum;
+    camera_ = cameraPosition;
+    entries_.clear();
+    matrices_.clear();
+    counts_.clear();
+    offsets_.clear();
+    commandData_.clear();
+    stats_ = Stats();
+    stats_.indirect = indirect_;
+}
+
+std::size_t MeshletCuller::Submit(const Object3D& object) {
+    auto start = std::chrono::steady_clock::now();
+    Mesh& mesh = *object.GetMesh();
+    Mat4 model(object.Transform());
+    std::size_t indexSize = mesh.IndexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    std::size_t firstRange = counts_.size();
+    GLuint instance = (GLuint)entries_.size();
+    auto keep = [&](uint32_t firstIndex, uint32_t indexCount) {
+        counts_.push_back((GLsizei)indexCount);
+        offsets_.push_back((const void*)(firstIndex * indexSize));
+        commandData_.push_back({ indexCount, 1, firstIndex, 0, instance });
+        stats_.triangles += indexCount / 3;
+    };
+    stats_.objects++;
+
+    const std::vector<MeshOptimizer::Meshlet>& meshlets = mesh.Meshlets();
+    if (meshlets.empty()) {
+        keep(0, (uint32_t)mesh.IndexCount());
+    } else {
+        //spheres grow with the largest axis scale, cones only survive a uniform one
+        float scales[3];
+        for (int c = 0; c < 3; ++c) {
+            scales[c] = Length(Vec3(model.m[c * 4], model.m[c * 4 + 1], model.m[c * 4 + 2]));
+        }
+        float maxScale = std::max(scales[0], std::max(scales[1], scales[2]));
+        float minScale = std::min(scales[0], std::min(scales[1], scales[2]));
+        bool cones = options_.coneCulling && maxScale > 0.0f && maxScale - minScale <= maxScale * 1e-3f;
+        Vec3 camera = cones ? TransformPoint(Inverse(model), camera_) : Vec3();
+
+        for (const MeshOptimizer::Meshlet& meshlet : meshlets) {
+            stats_.meshlets++;
+            Vec3 center(meshlet.center);
+            if (!frustum_.Intersects(TransformPoint(model, center), meshlet.radius * maxScale)) {
+                stats_.frustumCulled++;
+                continue;
+            }
+            //the camera sees the back of every triangle if it is inside the cone's back side for the whole sphere
+            Vec3 toCenter = center - camera;
+            if (cones && Dot(toCenter, Vec3(meshlet.coneAxis)) >=
+                         meshlet.coneCutoff * Length(toCenter) + meshlet.radius * (1.0f + meshlet.coneCutoff)) {
+                stats_.backfacing++;
+                continue;
+            }
+            keep(meshlet.firstIndex, meshlet.indexCount);
+        }
+    }
+
+    std::size_t kept = counts_.size() - firstRange;
+    if (kept > 0) {
+        entries_.push_back({ &mesh, object.Program(), object.Texture(), firstRange, kept });
+        if (mesh.Dequantization().enabled) {
+            float dequantization[16];
+            mesh.Dequantization().Matrix(dequantization);
+            model = model * Mat4(dequantization);
+        }
+        matrices_.insert(matrices_.end(), model.Data(), model.Data() + 16);
+    }
+    stats_.ranges += kept;
+    stats_.cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return kept;
+}
+
+void MeshletCuller::Draw() {
+    stats_.drawCalls = 0;
+    if (entries_.empty() || !instances_) {
+        return;
+    }
+    //both buffers are orphaned every frame, the driver hands out fresh storage while the last frame still reads
+    GLState& state = GLState::Get();
+    state.BindBuffer(GL_ARRAY_BUFFER, instances_);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(matrices_.size() * sizeof(float)), matrices_.data(), GL_STREAM_DRAW);
+    if (indirect_) {
+        state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(commandData_.size() * sizeof(Command)), commandData_.data(), GL_STREAM_DRAW);
+    }
+
+    for (std::size_t e = 0; e < entries_.size();) {
+        const Entry& entry = entries_[e];
+        std::size_t end = e + 1;
+        while (indirect_ && end < entries_.size() && entries_[end].mesh == entry.mesh && entries_[end].program == entry.program &&
+               entries_[end].texture == entry.texture) {
+            end++;
+        }
+        state.UseProgram(entry.program);
+        state.BindVertexArray(entry.mesh->VertexArray());
+        state.BindTexture(0, GL_TEXTURE_2D, entry.texture);
+
+        //indirect commands pick their matrix through baseInstance, 3.3 points the attributes at the object's matrix
+        state.BindBuffer(GL_ARRAY_BUFFER, instances_);
+        std::size_t matrixOffset = indirect_ ? 0 : e * kMatrixBytes;
+        for (GLuint column = 0; column < 4; ++column) {
+            GLuint location = kInstanceAttribute + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, kMatrixBytes, (const void*)(matrixOffset + column * 4 * sizeof(float)));
+            glVertexAttribDivisor(location, 1);
+        }
+        if (indirect_) {
+            const Entry& last = entries_[end - 1];
+            std::size_t commandCount = last.firstRange + last.rangeCount - entry.firstRange;
+            glMultiDrawElementsIndirect(GL_TRIANGLES, entry.mesh->IndexType(), (const void*)(entry.firstRange * sizeof(Command)),
+                                        (GLsizei)commandCount, 0);
+        } else {
+            glMultiDrawElements(GL_TRIANGLES, &counts_[entry.firstRange], entry.mesh->IndexType(), &offsets_[entry.firstRange],
+                                (GLsizei)entry.rangeCount);
+        }
+        stats_.drawCalls++;
+        e = end;
+    }
+}
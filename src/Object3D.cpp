@@ -1,3 +1,30 @@
-/*
-TODO: Implement Object3D class
-*/
\ No newline at end of file
+#include "Object3D.h"
+#include <cstring>
+
+Object3D::Object3D(Mesh* mesh, GLuint program, GLuint texture)
+    : mesh_(mesh), program_(program), texture_(texture) {
+    static const float identity[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+    SetTransform(identity);
+}
+
+void Object3D::SetTransform(const float matrix[16]) {
+    std::memcpy(transform_, matrix, sizeof(transform_));
+}
+
+void Object3D::SetPosition(float x, float y, float z) {
+    transform_[12] = x;
+    transform_[13] = y;
+    transform_[14] = z;
+}
+
+//overwrites the diagonal, so any rotation in the matrix is lost
+void Object3D::SetScale(float x, float y, float z) {
+    transform_[0] = x;
+    transform_[5] = y;
+    transform_[10] = z;
+}
@@ -0,0 +1,351 @@
+#include "OcclusionRasterizer.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+    //clip w below this counts as crossing the camera plane
+    const float kMinW = 1e-6f;
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
+
+OcclusionRasterizer::~OcclusionRasterizer() {
+    Destroy();
+}
+
+bool OcclusionRasterizer::Create(const Options& options) {
+    Destroy();
+    if (options.tileSize <= 0 || options.tileSize % 8 != 0 || options.width <= 0 || options.height <= 0 ||
+        options.width % options.tileSize != 0 || options.height % options.tileSize != 0) {
+        std::cout << "ERROR: OCCLUSION BUFFER " << options.width << "x" << options.height << " IS NOT A MULTIPLE OF TILE SIZE "
+                  << options.tileSize << std::endl;
+        return false;
+    }
+    options_ = options;
+    depth_.assign((std::size_t)options_.width * options_.height, 1.0f);
+    tileDepth_.assign((std::size_t)(options_.width / options_.tileSize) * (options_.height / options_.tileSize), 1.0f);
+
+    return pool_.Create(options_.threads);
+}
+
+void OcclusionRasterizer::Destroy() {
+    pool_.Destroy();
+}
+
+void OcclusionRasterizer::BeginFrame(const Mat4& viewProjection) {
+    viewProjection_ = viewProjection;
+    occluders_.clear();
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+    std::fill(tileDepth_.begin(), tileDepth_.end(), 1.0f);
+    stats_.occluders = stats_.triangles = stats_.rasterized = 0;
+}
+
+bool OcclusionRasterizer::AddOccluder(const Object3D& object) {
+    const Mesh* mesh = object.GetMesh();
+    if (!mesh || !mesh->HasCpuCopy()) {
+        return false;
+    }
+    std::size_t stride = mesh->FloatsPerVertex();
+    AddOccluder(mesh->Vertices().data(), stride, mesh->Vertices().size() / stride, mesh->Indices().data(), mesh->Indices().size(),
+                Mat4(object.Transform()));
+    return true;
+}
+
+void OcclusionRasterizer::AddOccluder(const float* positions, std::size_t stride, std::size_t vertexCount, const unsigned int* indices,
+                                      std::size_t indexCount, const Mat4& model) {
+    occluders_.push_back({ positions, stride, vertexCount, indices, indexCount, model, 0, 0 });
+}
+
+void OcclusionRasterizer::Rasterize() {
+    if (depth_.empty()) {
+        return;
+    }
+    //everything gets its own output range, so no step needs a lock
+    std::size_t vertices = 0, triangles = 0;
+    setupJobs_.clear();
+    for (std::size_t o = 0; o < occluders_.size(); ++o) {
+        Occluder& occluder = occluders_[o];
+        occluder.firstVertex = vertices;
+        occluder.firstTriangle = triangles;
+        vertices += occluder.vertexCount;
+        std::size_t count = occluder.indexCount / 3;
+        for (std::size_t begin = 0; begin < count; begin += options_.setupChunkSize) {
+            setupJobs_.push_back({ o, begin, std::min(begin + options_.setupChunkSize, count) });
+        }
+        triangles += count;
+    }
+    screenX_.resize(vertices);
+    screenY_.resize(vertices);
+    screenZ_.resize(vertices);
+    triangles_.resize(triangles);
+    stats_.occluders = occluders_.size();
+    stats_.triangles = triangles;
+
+    auto start = std::chrono::steady_clock::now();
+    run(occluders_.size(), [this](std::size_t o) { transform(occluders_[o]); });
+    stats_.transformMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    run(setupJobs_.size(), [this](std::size_t j) { setup(setupJobs_[j]); });
+    stats_.setupMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    run((std::size_t)(options_.height / options_.tileSize), [this](std::size_t band) { fillBand((int)band); });
+    stats_.rasterMs = millisecondsSince(start);
+
+    std::size_t rasterized = 0;
+    for (const Triangle& triangle : triangles_) {
+        rasterized += triangle.minY <= triangle.maxY;
+    }
+    stats_.rasterized = rasterized;
+}
+
+void OcclusionRasterizer::transform(const Occluder& occluder) {
+    Mat4 matrix = viewProjection_ * occluder.model;
+    float halfWidth = 0.5f * options_.width, halfHeight = 0.5f * options_.height;
+    float* outX = screenX_.data() + occluder.firstVertex;
+    float* outY = screenY_.data() + occluder.firstVertex;
+    float* outZ = screenZ_.data() + occluder.firstVertex;
+    const float* position = occluder.positions;
+    for (std::size_t v = 0; v < occluder.vertexCount; ++v, position += occluder.stride) {
+        Vec4 clip = matrix * Vec4(position[0], position[1], position[2], 1.0f);
+        if (clip.w < kMinW || clip.z < -clip.w) {
+            outX[v] = outY[v] = 0.0f;
+            outZ[v] = -1.0f;
+            continue;
+        }
+        float inverseW = 1.0f / clip.w;
+        outX[v] = (clip.x * inverseW + 1.0f) * halfWidth;
+        outY[v] = (clip.y * inverseW + 1.0f) * halfHeight;
+        outZ[v] = clip.z * inverseW * 0.5f + 0.5f;
+    }
+}
+
+void OcclusionRasterizer::setup(const SetupJob& job) {
+    const Occluder& occluder = occluders_[job.occluder];
+    const float* screenX = screenX_.data() + occluder.firstVertex;
+    const float* screenY = screenY_.data() + occluder.firstVertex;
+    const float* screenZ = screenZ_.data() + occluder.firstVertex;
+    for (std::size_t t = job.begin; t < job.end; ++t) {
+        Triangle& triangle = triangles_[occluder.firstTriangle + t];
+        triangle.minY = 1;
+        triangle.maxY = 0;
+
+        unsigned int index[3] = { occluder.indices[t * 3], occluder.indices[t * 3 + 1], occluder.indices[t * 3 + 2] };
+        if (index[0] >= occluder.vertexCount || index[1] >= occluder.vertexCount || index[2] >= occluder.vertexCount) {
+            continue;
+        }
+        //only the nearest depth is kept, so dropping a triangle can hide less but never too much
+        if (screenZ[index[0]] < 0.0f || screenZ[index[1]] < 0.0f || screenZ[index[2]] < 0.0f) {
+            continue;
+        }
+        float area = (screenX[index[1]] - screenX[index[0]]) * (screenY[index[2]] - screenY[index[0]]) -
+                     (screenX[index[2]] - screenX[index[0]]) * (screenY[index[1]] - screenY[index[0]]);
+        if (area == 0.0f || (area < 0.0f && options_.backfaceCulling)) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(index[1], index[2]);
+            area = -area;
+        }
+        float x[3], y[3], z[3];
+        for (int v = 0; v < 3; ++v) {
+            x[v] = screenX[index[v]];
+            y[v] = screenY[index[v]];
+            z[v] = screenZ[index[v]];
+        }
+
+        //pixels whose center (x + 0.5, y + 0.5) is inside the screen space bounds
+        float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+        float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+        triangle.minX = std::max((int)std::ceil(minX - 0.5f), 0);
+        triangle.maxX = std::min((int)std::floor(maxX - 0.5f), options_.width - 1);
+        triangle.minY = std::max((int)std::ceil(minY - 0.5f), 0);
+        triangle.maxY = std::min((int)std::floor(maxY - 0.5f), options_.height - 1);
+        if (triangle.minX > triangle.maxX) {
+            triangle.minY = 1;
+            triangle.maxY = 0;
+            continue;
+        }
+
+        //counter clockwise, so each edge has the inside on its left; evaluated at pixel centers from integer coordinates
+        for (int e = 0; e < 3; ++e) {
+            int a = e, b = (e + 1) % 3;
+            float edgeA = y[a] - y[b], edgeB = x[b] - x[a];
+            triangle.edgeA[e] = edgeA;
+            triangle.edgeB[e] = edgeB;
+            triangle.edgeC[e] = -(edgeA * x[a] + edgeB * y[a]) + 0.5f * (edgeA + edgeB);
+        }
+        float inverseArea = 1.0f / area;
+        float depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inverseArea;
+        float depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * inverseArea;
+        triangle.depthA = depthA;
+        triangle.depthB = depthB;
+        triangle.depthC = z[0] - depthA * x[0] - depthB * y[0] + 0.5f * (depthA + depthB);
+    }
+}
+
+void OcclusionRasterizer::fillBand(int band) {
+    int width = options_.width, tileSize = options_.tileSize;
+    int bandMinY = band * tileSize, bandMaxY = bandMinY + tileSize - 1;
+    for (const Triangle& triangle : triangles_) {
+        int minY = std::max(triangle.minY, bandMinY), maxY = std::min(triangle.maxY, bandMaxY);
+        if (minY > maxY) {
+            continue;
+        }
+#if MENACE_SIMD_SSE
+        using namespace SimdMath;
+        int firstX = triangle.minX & ~(int)(kWidth - 1);
+        Wide edgeA0 = wideSet(triangle.edgeA[0]), edgeA1 = wideSet(triangle.edgeA[1]), edgeA2 = wideSet(triangle.edgeA[2]);
+        Wide depthA = wideSet(triangle.depthA);
+        Wide startX = wideAdd(wideSet((float)firstX), wideRamp());
+        Wide step = wideSet((float)kWidth);
+        for (int y = minY; y <= maxY; ++y) {
+            float fy = (float)y;
+            Wide row0 = wideSet(triangle.edgeB[0] * fy + triangle.edgeC[0]);
+            Wide row1 = wideSet(triangle.edgeB[1] * fy + triangle.edgeC[1]);
+            Wide row2 = wideSet(triangle.edgeB[2] * fy + triangle.edgeC[2]);
+            Wide rowDepth = wideSet(triangle.depthB * fy + triangle.depthC);
+            float* depth = depth_.data() + (std::size_t)y * width;
+            Wide x = startX;
+            for (int px = firstX; px <= triangle.maxX; px += (int)kWidth, x = wideAdd(x, step)) {
+                Wide outside = wideOr(wideLess(wideMulAdd(edgeA0, x, row0), wideZero()), wideLess(wideMulAdd(edgeA1, x, row1), wideZero()));
+                outside = wideOr(outside, wideLess(wideMulAdd(edgeA2, x, row2), wideZero()));
+                if (wideMask(outside) == (1 << kWidth) - 1) {
+                    continue;
+                }
+                Wide current = wideLoad(depth + px);
+                Wide nearest = wideMin(current, wideMulAdd(depthA, x, rowDepth));
+                wideStore(depth + px, wideSelect(outside, current, nearest));
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; ++y) {
+            float fy = (float)y;
+            float* depth = depth_.data() + (std::size_t)y * width;
+            for (int px = triangle.minX; px <= triangle.maxX; ++px) {
+                float fx = (float)px;
+                bool inside = true;
+                for (int e = 0; e < 3; ++e) {
+                    inside = inside && triangle.edgeA[e] * fx + triangle.edgeB[e] * fy + triangle.edgeC[e] >= 0.0f;
+                }
+                if (inside) {
+                    depth[px] = std::min(depth[px], triangle.depthA * fx + triangle.depthB * fy + triangle.depthC);
+                }
+            }
+        }
+#endif
+    }
+
+    //farthest depth per tile, what IsVisible() looks at first
+    int tilesX = width / tileSize;
+    for (int tile = 0; tile < tilesX; ++tile) {
+        float farthest = 0.0f;
+        for (int y = bandMinY; y <= bandMaxY; ++y) {
+            const float* depth = depth_.data() + (std::size_t)y * width + tile * tileSize;
+            for (int x = 0; x < tileSize; ++x) {
+                farthest = std::max(farthest, depth[x]);
+            }
+        }
+        tileDepth_[(std::size_t)band * tilesX + tile] = farthest;
+    }
+}
+
+bool OcclusionRasterizer::IsVisible(const AABB& box) const {
+    if (depth_.empty()) {
+        return true;
+    }
+    Vec3 ndcMin(1.0f, 1.0f, 1.0f), ndcMax(-1.0f, -1.0f, -1.0f);
+    for (int c = 0; c < 8; ++c) {
+        Vec4 clip = viewProjection_ * Vec4((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y,
+                                           (c & 4) ? box.max.z : box.min.z, 1.0f);
+        //crosses the camera plane, the projection says nothing
+        if (clip.w < kMinW) {
+            return true;
+        }
+        Vec3 ndc = clip.XYZ() * (1.0f / clip.w);
+        ndcMin = Min(ndcMin, ndc);
+        ndcMax = Max(ndcMax, ndc);
+    }
+    if (ndcMin.z < -1.0f) {
+        return true;
+    }
+    //every pixel the box touches, off screen boxes are the frustum's business
+    int width = options_.width, height = options_.height, tileSize = options_.tileSize;
+    int minX = std::max((int)std::floor((ndcMin.x + 1.0f) * 0.5f * width), 0);
+    int maxX = std::min((int)std::floor((ndcMax.x + 1.0f) * 0.5f * width), width - 1);
+    int minY = std::max((int)std::floor((ndcMin.y + 1.0f) * 0.5f * height), 0);
+    int maxY = std::min((int)std::floor((ndcMax.y + 1.0f) * 0.5f * height), height - 1);
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+    float nearest = ndcMin.z * 0.5f + 0.5f;
+
+    int tilesX = width / tileSize;
+    for (int tileY = minY / tileSize; tileY <= maxY / tileSize; ++tileY) {
+        for (int tileX = minX / tileSize; tileX <= maxX / tileSize; ++tileX) {
+            if (tileDepth_[(std::size_t)tileY * tilesX + tileX] < nearest) {
+                continue;
+            }
+            int x0 = std::max(minX, tileX * tileSize), x1 = std::min(maxX, tileX * tileSize + tileSize - 1);
+            int y0 = std::max(minY, tileY * tileSize), y1 = std::min(maxY, tileY * tileSize + tileSize - 1);
+            for (int y = y0; y <= y1; ++y) {
+                const float* depth = depth_.data() + (std::size_t)y * width;
+#if MENACE_SIMD_SSE
+                using namespace SimdMath;
+                Wide boxDepth = wideSet(nearest);
+                for (int x = x0 & ~(int)(kWidth - 1); x <= x1; x += (int)kWidth) {
+                    //lanes inside [x0, x1] whose occluder depth is not in front of the box
+                    int lanes = ((1 << kWidth) - 1) & ~((1 << std::max(x0 - x, 0)) - 1);
+                    if (x1 - x < (int)kWidth - 1) {
+                        lanes &= (1 << (x1 - x + 1)) - 1;
+                    }
+                    if (~wideMask(wideLess(wideLoad(depth + x), boxDepth)) & lanes) {
+                        return true;
+                    }
+                }
+#else
+                for (int x = x0; x <= x1; ++x) {
+                    if (depth[x] >= nearest) {
+                        return true;
+                    }
+                }
+#endif
+            }
+        }
+    }
+    return false;
+}
+
+const std::vector<uint32_t>& OcclusionRasterizer::Cull(const std::vector<Object3D>& objects, const std::vector<uint32_t>& candidates) {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t count = candidates.size();
+    pool_.Filter(count, options_.testChunkSize, [&](std::size_t begin, std::size_t end, uint32_t* out) {
+        std::size_t written = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const Object3D& object = objects[candidates[i]];
+            const Mesh* mesh = object.GetMesh();
+            AABB box = Transform(Mat4(object.Transform()), AABB(Vec3(mesh->BoundsMin()), Vec3(mesh->BoundsMax())));
+            out[written] = candidates[i];
+            written += IsVisible(box);
+        }
+        return written;
+    }, visible_);
+
+    stats_.tested = count;
+    stats_.occluded = count - visible_.size();
+    stats_.testMs = millisecondsSince(start);
+    return visible_;
+}
+
+void OcclusionRasterizer::run(std::size_t count, const std::function<void(std::size_t)>& job) {
+    stats_.threads = pool_.Run(count, job);
+}
@@ -1,5 +1,339 @@
-/*
-TODO: Implement the Renderer class
-*/
-#pragma once
 #include "Renderer.h"
+#include "Mesh.h"
+#include "Object3D.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const uint32_t kSlotMask = 0xFFF;
+static const uint32_t kDepthMask = 0xFFFFFF;
+static const std::size_t kMatrixBytes = 16 * sizeof(float);
+
+Renderer::~Renderer() {
+    Clear();
+}
+
+void Renderer::Clear() {
+    instances_.Destroy();
+    batches_.clear();
+    batchSlots_.clear();
+}
+
+void Renderer::BeginFrame() {
+    commands_.clear();
+    keys_.clear();
+    stats_ = Stats();
+
+    //batches keep their storage from frame to frame, only the ones nothing was submitted to last frame are dropped
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < batches_.size(); ++i) {
+        if (!batches_[i].used) {
+            continue;
+        }
+        if (kept != i) {
+            std::swap(batches_[kept], batches_[i]);
+        }
+        batches_[kept].transforms.clear();
+        batches_[kept].used = false;
+        kept++;
+    }
+    if (kept != batches_.size()) {
+        batches_.resize(kept);
+        batchSlots_.clear();
+        for (std::size_t i = 0; i < batches_.size(); ++i) {
+            batchSlots_[batches_[i].key] = i;
+        }
+    }
+}
+
+void Renderer::Submit(const DrawCommand& command) {
+    commands_.push_back(command);
+    keys_.push_back(makeKey(command));
+}
+
+void Renderer::Submit(Mesh& mesh, GLuint program, GLuint texture, float depth, Pass pass) {
+    DrawCommand command;
+    command.pass = pass;
+    command.program = program;
+    command.VAO = mesh.VertexArray();
+    command.texture = texture;
+    command.depth = depth;
+    command.count = mesh.IndexCount();
+    command.indexType = mesh.IndexType();
+    Submit(command);
+}
+
+void Renderer::Submit(const Object3D& object, float depth, Pass pass) {
+    BatchKey key = { object.GetMesh(), object.Program(), object.Texture(), pass, selectLod(object) };
+    auto found = batchSlots_.find(key);
+    if (found == batchSlots_.end()) {
+        found = batchSlots_.emplace(key, batches_.size()).first;
+        batches_.push_back({ key, 0.0f, false, {} });
+    }
+    Batch& batch = batches_[found->second];
+    batch.depth = batch.used ? std::min(batch.depth, depth) : depth;
+    batch.used = true;
+
+    const PositionQuantization& dequantization = object.GetMesh()->Dequantization();
+    if (!dequantization.enabled) {
+        batch.transforms.insert(batch.transforms.end(), object.Transform(), object.Transform() + 16);
+        return;
+    }
+    //quantized positions: model * dequantization, so the shader needs no extra uniform
+    //the dequantization is scale + translate, so only the columns need scaling and the translation moves
+    const float* model = object.Transform();
+    std::size_t first = batch.transforms.size();
+    batch.transforms.resize(first + 16);
+    float* combined = &batch.transforms[first];
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            combined[column * 4 + row] = model[column * 4 + row] * dequantization.scale[column];
+        }
+    }
+    for (int row = 0; row < 4; ++row) {
+        combined[12 + row] = model[row] * dequantization.offset[0] + model[4 + row] * dequantization.offset[1] +
+                             model[8 + row] * dequantization.offset[2] + model[12 + row];
+    }
+}
+
+void Renderer::SetLodSelection(const float cameraPosition[3], float pixelsPerUnit, float maxPixelError) {
+    std::copy(cameraPosition, cameraPosition + 3, lodCamera_);
+    lodPixelsPerUnit_ = pixelsPerUnit;
+    lodMaxPixelError_ = maxPixelError;
+    lodSelection_ = true;
+}
+
+uint32_t Renderer::selectLod(const Object3D& object) const {
+    const std::vector<MeshLod>& lods = object.GetMesh()->Lods();
+    if (!lodSelection_ || lods.size() < 2) {
+        return 0;
+    }
+    //bounding sphere of the mesh bounds in world space, the largest axis scale grows both radius and error
+    const float* model = object.Transform();
+    const float* boundsMin = object.GetMesh()->BoundsMin();
+    const float* boundsMax = object.GetMesh()->BoundsMax();
+    float center[3], radius = 0.0f, scale = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        float half = (boundsMax[c] - boundsMin[c]) * 0.5f;
+        radius += half * half;
+        center[c] = (boundsMin[c] + boundsMax[c]) * 0.5f;
+        scale = std::max(scale, model[c * 4] * model[c * 4] + model[c * 4 + 1] * model[c * 4 + 1] + model[c * 4 + 2] * model[c * 4 + 2]);
+    }
+    scale = std::sqrt(scale);
+    float distance = 0.0f;
+    for (int row = 0; row < 3; ++row) {
+        float world = model[row] * center[0] + model[4 + row] * center[1] + model[8 + row] * center[2] + model[12 + row];
+        distance += (world - lodCamera_[row]) * (world - lodCamera_[row]);
+    }
+    distance = std::sqrt(distance) - std::sqrt(radius) * scale;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    //levels only get coarser, take the last one still within the budget
+    float pixelsPerError = scale * lodPixelsPerUnit_ / distance;
+    uint32_t lod = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerError <= lodMaxPixelError_) {
+        lod++;
+    }
+    return lod;
+}
+
+std::size_t Renderer::BatchKeyHash::operator()(const BatchKey& key) const {
+    std::size_t hash = std::hash<const void*>()(key.mesh);
+    hash = hash * 31 + key.program;
+    hash = hash * 31 + key.texture;
+    hash = hash * 31 + key.lod;
+    return hash * 31 + key.pass;
+}
+
+//every batch of the frame goes into the ring, each batch becomes a single instanced command
+bool Renderer::queueBatches() {
+    std::size_t bytes = 0;
+    for (const Batch& batch : batches_) {
+        bytes += batch.transforms.size() * sizeof(float);
+    }
+    if (bytes == 0) {
+        return false;
+    }
+
+    //alignment padding is at most one matrix per batch
+    std::size_t needed = bytes + batches_.size() * kMatrixBytes;
+    if (needed > instances_.FrameCapacity() && !instances_.Create(std::max(needed, instances_.FrameCapacity() * 2))) {
+        return false;
+    }
+    instances_.BeginFrame();
+
+    for (Batch& batch : batches_) {
+        if (batch.transforms.empty()) {
+            continue;
+        }
+        std::size_t size = batch.transforms.size() * sizeof(float);
+        RingBuffer::Allocation allocation = instances_.Allocate(size, kMatrixBytes);
+        if (!allocation.data) {
+            batch.transforms.clear();
+            continue;
+        }
+        std::memcpy(allocation.data, batch.transforms.data(), size);
+
+        Mesh& mesh = *batch.key.mesh;
+        const MeshLod& lod = mesh.Lods()[std::min<std::size_t>(batch.key.lod, mesh.Lods().size() - 1)];
+        DrawCommand command;
+        command.pass = batch.key.pass;
+        command.program = batch.key.program;
+        command.VAO = mesh.VertexArray();
+        command.texture = batch.key.texture;
+        command.depth = batch.depth;
+        command.count = (GLsizei)lod.indexCount;
+        command.indexType = mesh.IndexType();
+        command.first = lod.firstIndex * (mesh.IndexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+        command.instanceCount = (GLsizei)(size / kMatrixBytes);
+        command.instanceOffset = (std::size_t)allocation.offset;
+        Submit(command);
+
+        stats_.instances += command.instanceCount;
+        stats_.triangles += (std::size_t)command.instanceCount * (command.count / 3);
+        if (batch.key.lod) {
+            stats_.reducedInstances += command.instanceCount;
+        }
+        batch.transforms.clear();
+    }
+    instances_.Flush();
+    return true;
+}
+
+void Renderer::Flush() {
+    bool instanced = queueBatches();
+    stats_.commands += commands_.size();
+
+    order_.resize(commands_.size());
+    for (uint32_t i = 0; i < order_.size(); ++i) {
+        order_[i] = i;
+    }
+    if (sorting_) {
+        sortQueue();
+    }
+
+    for (uint32_t index : order_) {
+        execute(commands_[index]);
+    }
+    if (instanced) {
+        instances_.EndFrame();
+    }
+
+    commands_.clear();
+    keys_.clear();
+}
+
+//ids are handed out in first-seen order and wrap at 4096, a wrapped id only costs sort quality, never correctness
+uint32_t Renderer::slot(std::unordered_map<GLuint, uint32_t>& slots, GLuint name) {
+    auto found = slots.find(name);
+    if (found != slots.end()) {
+        return found->second;
+    }
+    uint32_t id = (uint32_t)slots.size() & kSlotMask;
+    slots.emplace(name, id);
+    return id;
+}
+
+uint64_t Renderer::makeKey(const DrawCommand& command) {
+    uint64_t program = slot(programSlots_, command.program);
+    uint64_t texture = slot(textureSlots_, command.texture);
+    uint64_t VAO = slot(vaoSlots_, command.VAO);
+    float clamped = std::min(std::max(command.depth, 0.0f), 1.0f);
+    uint64_t depth = (uint64_t)(clamped * kDepthMask) & kDepthMask;
+    uint64_t pass = (uint64_t)command.pass & 0xF;
+
+    if (command.pass == Opaque) {
+        return (pass << 60) | (program << 48) | (texture << 36) | (VAO << 24) | depth;
+    }
+    //blended passes must be drawn back to front, so depth (inverted) wins over state
+    return (pass << 60) | ((kDepthMask - depth) << 36) | (program << 24) | (texture << 12) | VAO;
+}
+
+//LSD radix sort on 8 bit digits, digits where every key agrees (common for the high bytes) are skipped
+void Renderer::sortQueue() {
+    std::size_t count = keys_.size();
+    if (count < 2) {
+        return;
+    }
+
+    scratchKeys_.resize(count);
+    scratchOrder_.resize(count);
+    std::vector<uint64_t>* keysIn = &keys_;
+    std::vector<uint64_t>* keysOut = &scratchKeys_;
+    std::vector<uint32_t>* orderIn = &order_;
+    std::vector<uint32_t>* orderOut = &scratchOrder_;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        std::size_t histogram[256] = { 0 };
+        for (uint64_t key : *keysIn) {
+            histogram[(key >> shift) & 0xFF]++;
+        }
+        if (histogram[((*keysIn)[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t& bucket : histogram) {
+            std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t destination = histogram[((*keysIn)[i] >> shift) & 0xFF]++;
+            (*keysOut)[destination] = (*keysIn)[i];
+            (*orderOut)[destination] = (*orderIn)[i];
+        }
+        std::swap(keysIn, keysOut);
+        std::swap(orderIn, orderOut);
+    }
+
+    //an odd number of scatter passes leaves the result in the scratch buffers
+    if (orderIn != &order_) {
+        order_.swap(scratchOrder_);
+        keys_.swap(scratchKeys_);
+    }
+}
+
+void Renderer::execute(const DrawCommand& command) {
+    //the state cache skips whatever is already bound, the sort makes that the common case
+    GLState& state = GLState::Get();
+    if (state.UseProgram(command.program)) {
+        stats_.programBinds++;
+    } else {
+        stats_.programBindsElided++;
+    }
+
+    if (state.BindVertexArray(command.VAO)) {
+        stats_.vaoBinds++;
+    } else {
+        stats_.vaoBindsElided++;
+    }
+
+    if (state.BindTexture(0, GL_TEXTURE_2D, command.texture)) {
+        stats_.textureBinds++;
+    } else {
+        stats_.textureBindsElided++;
+    }
+
+    if (command.instanceCount > 0) {
+        //the matrix attributes live in the mesh's VAO, point them at this batch's slice of the instance buffer
+        state.BindBuffer(GL_ARRAY_BUFFER, instances_.Buffer());
+        for (GLuint column = 0; column < 4; ++column) {
+            GLuint location = kInstanceAttribute + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, kMatrixBytes,
+                                  (const void*)(command.instanceOffset + column * 4 * sizeof(float)));
+            glVertexAttribDivisor(location, 1);
+        }
+        glDrawElementsInstanced(command.mode, command.count, command.indexType, (const void*)command.first, command.instanceCount);
+        stats_.instancedDraws++;
+    } else if (command.indexType) {
+        glDrawElements(command.mode, command.count, command.indexType, (const void*)command.first);
+    } else {
+        glDrawArrays(command.mode, (GLint)command.first, command.count);
+    }
+    stats_.drawCalls++;
+}
@@ -0,0 +1,137 @@
+#include "RingBuffer.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include <chrono>
+#include <iostream>
+
+//keeps every region start aligned for any power of two alignment GL asks for (uniform offsets are <= 256)
+static const std::size_t kRegionAlignment = 256;
+
+RingBuffer::~RingBuffer() {
+    Destroy();
+}
+
+bool RingBuffer::Create(std::size_t bytesPerFrame, int frames, bool allowPersistent) {
+    Destroy();
+    persistent_ = allowPersistent && GLEXT_ARB_buffer_storage;
+    frameSize_ = (bytesPerFrame + kRegionAlignment - 1) / kRegionAlignment * kRegionAlignment;
+    frames_ = persistent_ ? (frames < 1 ? 1 : frames) : 1;
+    frame_ = 0;
+    head_ = 0;
+    fences_.assign(frames_, nullptr);
+    stats_ = Stats();
+
+    GLState& state = GLState::Get();
+    glGenBuffers(1, &buffer_);
+    state.BindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    GLsizeiptr size = (GLsizeiptr)(frameSize_ * frames_);
+
+    if (persistent_) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped_ = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        if (!mapped_) {
+            std::cout << "ERROR: RING BUFFER PERSISTENT MAPPING FAILED" << std::endl;
+            Destroy();
+            return false;
+        }
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    return true;
+}
+
+void RingBuffer::Destroy() {
+    if (buffer_ && mapped_) {
+        GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    mapped_ = nullptr;
+    for (GLsync& fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    fences_.clear();
+    GLState::Get().DeleteBuffer(buffer_);
+    buffer_ = 0;
+    frameSize_ = 0;
+    frames_ = 0;
+}
+
+void RingBuffer::BeginFrame() {
+    if (!buffer_) {
+        return;
+    }
+    frame_ = (frame_ + 1) % frames_;
+    head_ = 0;
+    stats_.frames++;
+
+    //the region was last written `frames_` frames ago, only block if the GPU still hasn't consumed it
+    GLsync& fence = fences_[frame_];
+    if (!fence) {
+        return;
+    }
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        stats_.fenceWaits++;
+        auto start = std::chrono::steady_clock::now();
+        GLenum result;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        stats_.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+RingBuffer::Allocation RingBuffer::Allocate(std::size_t size, std::size_t alignment) {
+    Allocation allocation;
+    std::size_t base = (std::size_t)frame_ * frameSize_;
+    std::size_t offset = base + head_;
+    if (alignment > 1) {
+        offset = (offset + alignment - 1) / alignment * alignment;
+    }
+    if (offset + size > base + frameSize_) {
+        stats_.overflows++;
+        return allocation;
+    }
+
+    if (!persistent_ && !mapped_) {
+        //first write of the frame orphans the whole buffer, later ones (after a Flush) only touch unused space
+        GLbitfield flags = GL_MAP_WRITE_BIT;
+        flags |= head_ == 0 ? GL_MAP_INVALIDATE_BUFFER_BIT : (GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        mapped_ = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, frameSize_ - offset, flags);
+        mappedStart_ = offset;
+        if (!mapped_) {
+            std::cout << "ERROR: RING BUFFER MAPPING FAILED" << std::endl;
+            return allocation;
+        }
+    }
+
+    allocation.data = mapped_ + (persistent_ ? offset : offset - mappedStart_);
+    allocation.offset = (GLintptr)offset;
+    head_ = offset + size - base;
+    stats_.bytes += size;
+    return allocation;
+}
+
+void RingBuffer::Flush() {
+    //coherent persistent writes are visible to the next GL command, nothing to do
+    if (persistent_ || !mapped_) {
+        return;
+    }
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE) {
+        std::cout << "ERROR: RING BUFFER CONTENTS LOST" << std::endl;
+    }
+    mapped_ = nullptr;
+}
+
+void RingBuffer::EndFrame() {
+    Flush();
+    if (persistent_) {
+        fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,413 @@
+#include "ShaderManager.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//cache file layout: header followed by the raw driver binary
+struct ProgramBinaryHeader {
+    char magic[4];              //"MSPB"
+    uint32_t version;
+    uint64_t key;               //hash of sources + driver, guards against hash-named file collisions
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+static const uint32_t kProgramBinaryVersion = 1;
+
+//FNV-1a, stable across runs and platforms unlike std::hash
+static uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "ERROR: COULD NOT OPEN SHADER FILE " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+//logs the compile error of a shader, the status query blocks until that shader is compiled
+static bool checkShader(GLuint shader, GLenum type)
+{
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR: " << (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT") << " SHADER COMPILATION FAILED\n" << infoLog << std::endl;
+    }
+    return success;
+}
+
+//drawn in place of programs that are still compiling, only relies on attribute 0 being the position
+static const char* fallbackVertexSource = "#version 330 core\n"
+                                          "layout (location = 0) in vec3 aPos;\n"
+                                          "void main()\n"
+                                          "{\n"
+                                          "   gl_Position = vec4(aPos, 1.0);\n"
+                                          "}\n";
+
+static const char* fallbackFragmentSource = "#version 330 core\n"
+                                            "out vec4 FragColor;\n"
+                                            "void main()\n"
+                                            "{\n"
+                                            "   FragColor = vec4(0.5, 0.5, 0.5, 1.0);\n"
+                                            "}\n";
+
+ShaderManager::ShaderManager(std::string cacheDirectory) : cacheDirectory_(std::move(cacheDirectory)) {
+    //a binary is only valid for the exact driver that produced it
+    driverString_ = std::string((const char*)glGetString(GL_VENDOR)) + "|" +
+                    (const char*)glGetString(GL_RENDERER) + "|" +
+                    (const char*)glGetString(GL_VERSION);
+
+    GLint formats = 0;
+    if (GLEXT_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    binaryCacheEnabled_ = !cacheDirectory_.empty() && formats > 0;
+
+    if (binaryCacheEnabled_) {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory_, error);
+        if (error) {
+            std::cout << "ERROR: COULD NOT CREATE SHADER CACHE " << cacheDirectory_ << ", binary cache disabled" << std::endl;
+            binaryCacheEnabled_ = false;
+        }
+    }
+
+    //let the driver use as many compiler threads as it likes
+    if (GLEXT_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+}
+
+ShaderManager::~ShaderManager() {
+    Clear();
+}
+
+GLuint ShaderManager::LoadProgram(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath) {
+    auto existing = programs_.find(name);
+    if (existing != programs_.end()) {
+        return existing->second;
+    }
+
+    std::string vertexSource, fragmentSource;
+    if (!readFile(vertexPath, vertexSource) || !readFile(fragmentPath, fragmentSource)) {
+        return 0;
+    }
+    return LoadProgramFromSource(name, vertexSource, fragmentSource);
+}
+
+GLuint ShaderManager::LoadProgramFromSource(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource) {
+    auto existing = programs_.find(name);
+    if (existing != programs_.end()) {
+        return existing->second;
+    }
+
+    //already requested asynchronously, just wait for that one
+    for (std::size_t i = 0; i < pending_.size(); ++i) {
+        if (pending_[i].name == name) {
+            auto start = std::chrono::steady_clock::now();
+            PendingProgram pending = pending_[i];
+            pending_.erase(pending_.begin() + i);
+            GLuint program = finish(pending);
+            addTime(start);
+            return program;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t key = 0;
+    GLuint program = tryCache(name, key, vertexSource, fragmentSource);
+    if (!program) {
+        stats_.cacheMisses++;
+        PendingProgram pending = submit(name, vertexSource, fragmentSource);
+        pending.key = key;
+        program = finish(pending);
+    }
+    addTime(start);
+    return program;
+}
+
+bool ShaderManager::RequestProgram(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath) {
+    if (programs_.count(name)) {
+        return true;
+    }
+
+    std::string vertexSource, fragmentSource;
+    if (!readFile(vertexPath, vertexSource) || !readFile(fragmentPath, fragmentSource)) {
+        return false;
+    }
+    RequestProgramFromSource(name, vertexSource, fragmentSource);
+    return true;
+}
+
+void ShaderManager::RequestProgramFromSource(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource) {
+    if (programs_.count(name)) {
+        return;
+    }
+    for (const PendingProgram& pending : pending_) {
+        if (pending.name == name) {
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t key = 0;
+    if (!tryCache(name, key, vertexSource, fragmentSource)) {
+        stats_.cacheMisses++;
+        pending_.push_back(submit(name, vertexSource, fragmentSource));
+        pending_.back().key = key;
+    }
+    addTime(start);
+}
+
+void ShaderManager::Update() {
+    if (pending_.empty()) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (GLEXT_KHR_parallel_shader_compile) {
+        //finish everything the driver reports as done, leave the rest for the next frame
+        for (std::size_t i = 0; i < pending_.size();) {
+            if (isComplete(pending_[i])) {
+                finish(pending_[i]);
+                pending_[i] = pending_.back();
+                pending_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    } else {
+        //no way to ask without blocking, so block on a single program per frame
+        finish(pending_.front());
+        pending_.erase(pending_.begin());
+    }
+    addTime(start);
+}
+
+void ShaderManager::WaitAll() {
+    auto start = std::chrono::steady_clock::now();
+    for (PendingProgram& pending : pending_) {
+        finish(pending);
+    }
+    pending_.clear();
+    addTime(start);
+}
+
+GLuint ShaderManager::Get(const std::string& name) const {
+    auto found = programs_.find(name);
+    return found == programs_.end() ? 0 : found->second;
+}
+
+GLuint ShaderManager::GetOrFallback(const std::string& name) {
+    auto found = programs_.find(name);
+    if (found != programs_.end()) {
+        return found->second;
+    }
+
+    //built lazily and blocking, it is tiny and only needed once something is actually pending
+    if (!fallbackProgram_) {
+        PendingProgram fallback = submit("", fallbackVertexSource, fallbackFragmentSource);
+        fallbackProgram_ = finish(fallback);
+    }
+    return fallbackProgram_;
+}
+
+void ShaderManager::Clear() {
+    WaitAll();
+    for (auto& entry : programs_) {
+        GLState::Get().DeleteProgram(entry.second);
+    }
+    programs_.clear();
+    if (fallbackProgram_) {
+        GLState::Get().DeleteProgram(fallbackProgram_);
+        fallbackProgram_ = 0;
+    }
+}
+
+//kicks off compile + link without asking for any status, the driver is free to work on it in the background
+ShaderManager::PendingProgram ShaderManager::submit(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource) {
+    PendingProgram pending;
+    pending.name = name;
+
+    const char* vertexText = vertexSource.c_str();
+    pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertexShader, 1, &vertexText, NULL);
+    glCompileShader(pending.vertexShader);
+
+    const char* fragmentText = fragmentSource.c_str();
+    pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.fragmentShader, 1, &fragmentText, NULL);
+    glCompileShader(pending.fragmentShader);
+
+    pending.program = glCreateProgram();
+    if (binaryCacheEnabled_) {
+        //tell the driver we will ask for the binary, some drivers only keep it around with this hint
+        glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(pending.program, pending.vertexShader);
+    glAttachShader(pending.program, pending.fragmentShader);
+    glLinkProgram(pending.program);
+    return pending;
+}
+
+bool ShaderManager::isComplete(const PendingProgram& pending) const {
+    GLint complete = GL_TRUE;
+    if (GLEXT_KHR_parallel_shader_compile) {
+        glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    return complete == GL_TRUE;
+}
+
+//checks the result of a submitted program (blocks if the driver isn't done) and registers it under its name
+GLuint ShaderManager::finish(PendingProgram& pending) {
+    int success;
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+    if (!success) {
+        //the link log is often empty when a stage failed, report the stages first
+        checkShader(pending.vertexShader, GL_VERTEX_SHADER);
+        checkShader(pending.fragmentShader, GL_FRAGMENT_SHADER);
+        char infoLog[512];
+        glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
+        std::cout << "ERROR: SHADER PROGRAM LINKING FAILED " << pending.name << "\n" << infoLog << std::endl;
+    }
+
+    //delete after linking
+    glDeleteShader(pending.vertexShader);
+    glDeleteShader(pending.fragmentShader);
+
+    if (!success) {
+        GLState::Get().DeleteProgram(pending.program);
+        stats_.failed++;
+        return 0;
+    }
+
+    if (binaryCacheEnabled_ && pending.key) {
+        storeBinary(pending.key, pending.program);
+    }
+    if (!pending.name.empty()) {
+        programs_[pending.name] = pending.program;
+    }
+    return pending.program;
+}
+
+//returns the program straight from the binary cache (and registers it), 0 on a miss; always fills in the key
+GLuint ShaderManager::tryCache(const std::string& name, uint64_t& key, const std::string& vertexSource, const std::string& fragmentSource) {
+    if (!binaryCacheEnabled_) {
+        return 0;
+    }
+    key = cacheKey(vertexSource, fragmentSource);
+    GLuint program = loadBinary(key);
+    if (program) {
+        stats_.cacheHits++;
+        programs_[name] = program;
+    }
+    return program;
+}
+
+void ShaderManager::addTime(std::chrono::steady_clock::time_point start) {
+    stats_.loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+GLuint ShaderManager::loadBinary(uint64_t key) {
+    std::ifstream file(cachePath(key), std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    ProgramBinaryHeader header;
+    if (!file.read((char*)&header, sizeof(header)) ||
+        std::string(header.magic, 4) != "MSPB" || header.version != kProgramBinaryVersion || header.key != key) {
+        return 0;
+    }
+
+    //a truncated or corrupt file must not make us allocate whatever length it claims, the binary is the rest of the file
+    std::streamoff binaryStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - binaryStart;
+    if (header.length == 0 || remaining != (std::streamoff)header.length || !file.seekg(binaryStart)) {
+        return 0;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length)) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)header.length);
+
+    //the driver may reject a binary it produced itself (different build, different gpu), just rebuild then
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLState::Get().DeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ShaderManager::storeBinary(uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, NULL, &binaryFormat, binary.data());
+
+    ProgramBinaryHeader header = { { 'M', 'S', 'P', 'B' }, kProgramBinaryVersion, key, binaryFormat, (uint32_t)length };
+
+    //write to a temporary file and rename, so a crash never leaves a truncated binary behind
+    std::string path = cachePath(key);
+    std::string temporaryPath = path + ".tmp";
+    bool written;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+        file.close();
+        written = !file.fail();
+    }
+    //a failed write or rename leaves no half written file behind, the next run just compiles again
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+uint64_t ShaderManager::cacheKey(const std::string& vertexSource, const std::string& fragmentSource) const {
+    uint64_t hash = fnv1a(driverString_);
+    hash = fnv1a(vertexSource, fnv1a(std::string(1, '\0'), hash));
+    hash = fnv1a(fragmentSource, fnv1a(std::string(1, '\0'), hash));
+    return hash;
+}
+
+std::string ShaderManager::cachePath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(cacheDirectory_) / name).string();
+}
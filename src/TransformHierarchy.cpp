@@ -0,0 +1,297 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //moves every element to its new slot, order[new slot] = old slot
+    template <typename T>
+    void permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+    {
+        std::vector<T> sorted(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    }
+
+}
+
+TransformHierarchy::Handle TransformHierarchy::Add(Handle parent) {
+    if (parent != 0 && !Valid(parent)) {
+        std::cout << "ERROR: TRANSFORM HIERARCHY PARENT DOES NOT EXIST: " << parent << std::endl;
+        return 0;
+    }
+    Handle handle;
+    if (!freeHandles_.empty()) {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    } else {
+        handle = (Handle)slot_.size();
+        slot_.push_back(kNoSlot);
+    }
+    uint32_t slot = (uint32_t)handle_.size();
+    slot_[handle] = slot;
+    handle_.push_back(handle);
+    parent_.push_back(parent ? (int32_t)slot_[parent] : -1);
+    subtree_.push_back(1);
+    flags_.push_back(0);
+    translation_.push_back(Vec3());
+    rotation_.push_back(Quat());
+    scale_.push_back(Vec3(1.0f, 1.0f, 1.0f));
+    local_.push_back(Mat4());
+    world_.push_back(Mat4());
+    queue(slot, false);
+    structureDirty_ = true;
+    return handle;
+}
+
+void TransformHierarchy::Remove(Handle handle) {
+    if (!Valid(handle)) {
+        return;
+    }
+    //the subtree goes with the node when reorder() does not reach it anymore
+    flags_[slot_[handle]] |= kRemoved;
+    structureDirty_ = true;
+}
+
+bool TransformHierarchy::SetParent(Handle handle, Handle parent) {
+    if (!Valid(handle) || (parent != 0 && !Valid(parent))) {
+        std::cout << "ERROR: TRANSFORM HIERARCHY NODE DOES NOT EXIST" << std::endl;
+        return false;
+    }
+    uint32_t slot = slot_[handle];
+    int32_t parentSlot = parent ? (int32_t)slot_[parent] : -1;
+    for (int32_t above = parentSlot; above >= 0; above = parent_[above]) {
+        if ((uint32_t)above == slot) {
+            std::cout << "ERROR: TRANSFORM HIERARCHY PARENT IS BELOW THE NODE: " << parent << std::endl;
+            return false;
+        }
+    }
+    if (parent_[slot] != parentSlot) {
+        parent_[slot] = parentSlot;
+        queue(slot, false);
+        structureDirty_ = true;
+    }
+    return true;
+}
+
+bool TransformHierarchy::Valid(Handle handle) const {
+    return handle != 0 && handle < slot_.size() && slot_[handle] != kNoSlot && !(flags_[slot_[handle]] & kRemoved);
+}
+
+TransformHierarchy::Handle TransformHierarchy::GetParent(Handle handle) const {
+    int32_t parent = parent_[slot_[handle]];
+    return parent < 0 ? 0 : handle_[parent];
+}
+
+void TransformHierarchy::SetLocal(Handle handle, const Vec3& translation, const Quat& rotation, const Vec3& scale) {
+    uint32_t slot = slot_[handle];
+    translation_[slot] = translation;
+    rotation_[slot] = rotation;
+    scale_[slot] = scale;
+    queue(slot, true);
+}
+
+void TransformHierarchy::SetTranslation(Handle handle, const Vec3& translation) {
+    uint32_t slot = slot_[handle];
+    translation_[slot] = translation;
+    queue(slot, true);
+}
+
+void TransformHierarchy::SetRotation(Handle handle, const Quat& rotation) {
+    uint32_t slot = slot_[handle];
+    rotation_[slot] = rotation;
+    queue(slot, true);
+}
+
+void TransformHierarchy::SetScale(Handle handle, const Vec3& scale) {
+    uint32_t slot = slot_[handle];
+    scale_[slot] = scale;
+    queue(slot, true);
+}
+
+void TransformHierarchy::SetLocalMatrix(Handle handle, const Mat4& local) {
+    uint32_t slot = slot_[handle];
+    local_[slot] = local;
+    queue(slot, false);
+    flags_[slot] &= ~kLocalDirty;
+}
+
+void TransformHierarchy::queue(uint32_t slot, bool localDirty) {
+    if (!(flags_[slot] & kQueued)) {
+        flags_[slot] |= kQueued;
+        queued_.push_back(handle_[slot]);
+    }
+    if (localDirty) {
+        flags_[slot] |= kLocalDirty;
+    }
+}
+
+void TransformHierarchy::Update() {
+    auto start = std::chrono::steady_clock::now();
+    if (structureDirty_) {
+        reorder();
+    }
+
+    //subtrees either nest or are disjoint, so after sorting a queued slot inside the previous range is covered by it
+    std::vector<uint32_t> slots;
+    slots.reserve(queued_.size());
+    for (Handle handle : queued_) {
+        if (handle < slot_.size() && slot_[handle] != kNoSlot) {
+            slots.push_back(slot_[handle]);
+        }
+    }
+    queued_.clear();
+    std::sort(slots.begin(), slots.end());
+    std::vector<Range> ranges;
+    std::size_t total = 0;
+    for (uint32_t slot : slots) {
+        if (!ranges.empty() && slot < ranges.back().end) {
+            continue;
+        }
+        ranges.push_back({ slot, slot + subtree_[slot] });
+        total += subtree_[slot];
+    }
+    stats_.dirtyRanges = ranges.size();
+
+    int threads = options_.threads > 0 ? options_.threads : (int)std::thread::hardware_concurrency();
+    if (total < std::max<std::size_t>(options_.minParallelNodes, 1)) {
+        threads = 1;
+    }
+    stats_.threads = std::max(threads, 1);
+    if (threads <= 1) {
+        for (const Range& range : ranges) {
+            updateRange(range.begin, range.end);
+        }
+    } else {
+        //a range is a node plus its children's subtrees, which don't depend on each other once the node is done:
+        //split big ranges that way until there are enough pieces to keep every thread busy
+        std::size_t target = std::max<std::size_t>(total / ((std::size_t)threads * 4), 1024);
+        std::vector<Range> jobs;
+        while (!ranges.empty()) {
+            Range range = ranges.back();
+            ranges.pop_back();
+            if (range.end - range.begin <= target) {
+                jobs.push_back(range);
+                continue;
+            }
+            updateNode(range.begin);
+            for (uint32_t child = range.begin + 1; child < range.end; child += subtree_[child]) {
+                ranges.push_back({ child, child + subtree_[child] });
+            }
+        }
+        if (!pool_) {
+            pool_ = std::make_unique<JobPool>();
+            pool_->Create(threads - 1);
+        }
+        stats_.threads = pool_->Run(jobs.size(), [&](std::size_t job) { updateRange(jobs[job].begin, jobs[job].end); });
+    }
+
+    stats_.updatedNodes = total;
+    stats_.nodes = handle_.size();
+    stats_.updateMs = millisecondsSince(start);
+}
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end) {
+    for (uint32_t slot = begin; slot < end; ++slot) {
+        updateNode(slot);
+    }
+}
+
+void TransformHierarchy::updateNode(uint32_t slot) {
+    uint8_t flags = flags_[slot];
+    if (flags & kLocalDirty) {
+        local_[slot] = Mat4::TRS(translation_[slot], rotation_[slot], scale_[slot]);
+    }
+    flags_[slot] = flags & ~(kQueued | kLocalDirty);
+    int32_t parent = parent_[slot];
+    world_[slot] = parent < 0 ? local_[slot] : world_[parent] * local_[slot];
+}
+
+void TransformHierarchy::reorder() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t count = (uint32_t)handle_.size();
+
+    //children of every slot, in slot order, so siblings keep their relative order
+    std::vector<uint32_t> firstChild(count + 1, 0), children(count);
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        if (parent_[slot] >= 0) {
+            firstChild[parent_[slot] + 1]++;
+        }
+    }
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        firstChild[slot + 1] += firstChild[slot];
+    }
+    std::vector<uint32_t> fill(firstChild.begin(), firstChild.end() - 1);
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        if (parent_[slot] >= 0) {
+            children[fill[parent_[slot]]++] = slot;
+        }
+    }
+
+    //preorder walk from the roots, removed nodes and everything below them are not visited
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < count; ++root) {
+        if (parent_[root] >= 0) {
+            continue;
+        }
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t slot = stack.back();
+            stack.pop_back();
+            if (flags_[slot] & kRemoved) {
+                continue;
+            }
+            order.push_back(slot);
+            for (uint32_t c = firstChild[slot + 1]; c > firstChild[slot]; --c) {
+                stack.push_back(children[c - 1]);
+            }
+        }
+    }
+
+    std::vector<uint32_t> newSlot(count, kNoSlot);
+    for (uint32_t slot = 0; slot < (uint32_t)order.size(); ++slot) {
+        newSlot[order[slot]] = slot;
+    }
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        if (newSlot[slot] == kNoSlot) {
+            slot_[handle_[slot]] = kNoSlot;
+            freeHandles_.push_back(handle_[slot]);
+        }
+    }
+
+    permute(handle_, order);
+    permute(parent_, order);
+    permute(flags_, order);
+    permute(translation_, order);
+    permute(rotation_, order);
+    permute(scale_, order);
+    permute(local_, order);
+    permute(world_, order);
+    subtree_.assign(order.size(), 1);
+    for (uint32_t slot = 0; slot < (uint32_t)order.size(); ++slot) {
+        slot_[handle_[slot]] = slot;
+        if (parent_[slot] >= 0) {
+            parent_[slot] = (int32_t)newSlot[parent_[slot]];
+        }
+    }
+    //parents come first, so one backwards pass sums the subtrees up
+    for (uint32_t slot = (uint32_t)order.size(); slot-- > 0;) {
+        if (parent_[slot] >= 0) {
+            subtree_[parent_[slot]] += subtree_[slot];
+        }
+    }
+
+    structureDirty_ = false;
+    stats_.reorderMs = millisecondsSince(start);
+}
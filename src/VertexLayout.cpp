@@ -0,0 +1,542 @@
+#include "VertexLayout.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent == 0xFF) {
+        //inf stays inf, nan stays a (quiet) nan
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+
+    uint32_t half, rest, halfway;
+    if (halfExponent <= 0) {
+        //subnormal half, the implicit leading 1 becomes explicit and is shifted down
+        if (halfExponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - halfExponent;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1FFF;
+        halfway = 0x1000;
+    }
+    //a carry out of the mantissa correctly bumps the exponent (up to inf)
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    if (exponent == 0) {
+        float magnitude = mantissa * 5.9604645e-8f;     //2^-24
+        return sign ? -magnitude : magnitude;
+    }
+    uint32_t bits;
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static int32_t toSigned(float value, bool normalized, int32_t maximum)
+{
+    if (normalized) {
+        value = std::min(std::max(value, -1.0f), 1.0f) * maximum;
+    }
+    return (int32_t)std::lround(std::min(std::max(value, (float)(-maximum - 1)), (float)maximum));
+}
+
+static uint32_t toUnsigned(float value, bool normalized, uint32_t maximum)
+{
+    if (normalized) {
+        value = std::min(std::max(value, 0.0f), 1.0f) * maximum;
+    }
+    return (uint32_t)std::lround(std::min(std::max(value, 0.0f), (float)maximum));
+}
+
+static float fromSigned(int32_t value, bool normalized, int32_t maximum)
+{
+    return normalized ? std::max((float)value / maximum, -1.0f) : (float)value;
+}
+
+static float fromUnsigned(uint32_t value, bool normalized, uint32_t maximum)
+{
+    return normalized ? (float)value / maximum : (float)value;
+}
+
+static float signNotZero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+//unit vector -> point on the octahedron unfolded into [-1, 1]^2
+static void octahedralEncode(const float* direction, float& u, float& v)
+{
+    float length = std::fabs(direction[0]) + std::fabs(direction[1]) + std::fabs(direction[2]);
+    if (length == 0.0f) {
+        u = v = 0.0f;
+        return;
+    }
+    u = direction[0] / length;
+    v = direction[1] / length;
+    if (direction[2] < 0.0f) {
+        float foldedU = (1.0f - std::fabs(v)) * signNotZero(u);
+        float foldedV = (1.0f - std::fabs(u)) * signNotZero(v);
+        u = foldedU;
+        v = foldedV;
+    }
+}
+
+static void octahedralDecode(float u, float v, float* direction)
+{
+    float z = 1.0f - std::fabs(u) - std::fabs(v);
+    if (z < 0.0f) {
+        float unfoldedU = (1.0f - std::fabs(v)) * signNotZero(u);
+        float unfoldedV = (1.0f - std::fabs(u)) * signNotZero(v);
+        u = unfoldedU;
+        v = unfoldedV;
+    }
+    float length = std::sqrt(u * u + v * v + z * z);
+    direction[0] = u / length;
+    direction[1] = v / length;
+    direction[2] = z / length;
+}
+
+//one attribute of one vertex, source floats -> GPU format
+static void packAttribute(const VertexAttribute& attribute, const float* in, uint8_t* out)
+{
+    int components = attribute.components;
+    bool normalized = attribute.normalized;
+    switch (attribute.format) {
+        case VertexFormat::Float:
+            std::memcpy(out, in, components * sizeof(float));
+            break;
+        case VertexFormat::Half:
+            for (int c = 0; c < components; ++c) {
+                uint16_t half = floatToHalf(in[c]);
+                std::memcpy(out + c * 2, &half, 2);
+            }
+            break;
+        case VertexFormat::UByte:
+            for (int c = 0; c < components; ++c) {
+                out[c] = (uint8_t)toUnsigned(in[c], normalized, 255);
+            }
+            break;
+        case VertexFormat::Byte:
+            for (int c = 0; c < components; ++c) {
+                out[c] = (uint8_t)(int8_t)toSigned(in[c], normalized, 127);
+            }
+            break;
+        case VertexFormat::UShort:
+            for (int c = 0; c < components; ++c) {
+                uint16_t value = (uint16_t)toUnsigned(in[c], normalized, 65535);
+                std::memcpy(out + c * 2, &value, 2);
+            }
+            break;
+        case VertexFormat::Short:
+            for (int c = 0; c < components; ++c) {
+                int16_t value = (int16_t)toSigned(in[c], normalized, 32767);
+                std::memcpy(out + c * 2, &value, 2);
+            }
+            break;
+        case VertexFormat::Int2101010: {
+            uint32_t x = (uint32_t)toSigned(in[0], normalized, 511) & 0x3FF;
+            uint32_t y = (uint32_t)toSigned(in[1], normalized, 511) & 0x3FF;
+            uint32_t z = (uint32_t)toSigned(in[2], normalized, 511) & 0x3FF;
+            uint32_t w = components == 4 ? (uint32_t)toSigned(in[3], normalized, 1) & 0x3 : 0;
+            uint32_t word = x | (y << 10) | (z << 20) | (w << 30);
+            std::memcpy(out, &word, 4);
+            break;
+        }
+        case VertexFormat::Octahedral16: {
+            float u, v;
+            octahedralEncode(in, u, v);
+            int16_t encoded[2] = { (int16_t)toSigned(u, true, 32767), (int16_t)toSigned(v, true, 32767) };
+            std::memcpy(out, encoded, 4);
+            break;
+        }
+    }
+}
+
+//GPU format -> source floats, what the vertex shader ends up with
+static void unpackAttribute(const VertexAttribute& attribute, const uint8_t* in, float* out)
+{
+    int components = attribute.components;
+    bool normalized = attribute.normalized;
+    switch (attribute.format) {
+        case VertexFormat::Float:
+            std::memcpy(out, in, components * sizeof(float));
+            break;
+        case VertexFormat::Half:
+            for (int c = 0; c < components; ++c) {
+                uint16_t half;
+                std::memcpy(&half, in + c * 2, 2);
+                out[c] = halfToFloat(half);
+            }
+            break;
+        case VertexFormat::UByte:
+            for (int c = 0; c < components; ++c) {
+                out[c] = fromUnsigned(in[c], normalized, 255);
+            }
+            break;
+        case VertexFormat::Byte:
+            for (int c = 0; c < components; ++c) {
+                out[c] = fromSigned((int8_t)in[c], normalized, 127);
+            }
+            break;
+        case VertexFormat::UShort:
+            for (int c = 0; c < components; ++c) {
+                uint16_t value;
+                std::memcpy(&value, in + c * 2, 2);
+                out[c] = fromUnsigned(value, normalized, 65535);
+            }
+            break;
+        case VertexFormat::Short:
+            for (int c = 0; c < components; ++c) {
+                int16_t value;
+                std::memcpy(&value, in + c * 2, 2);
+                out[c] = fromSigned(value, normalized, 32767);
+            }
+            break;
+        case VertexFormat::Int2101010: {
+            uint32_t word;
+            std::memcpy(&word, in, 4);
+            for (int c = 0; c < components; ++c) {
+                //shift the field to the top and back down to sign extend it
+                int bits = c < 3 ? 10 : 2;
+                int32_t value = (int32_t)(word << (32 - bits - c * 10)) >> (32 - bits);
+                out[c] = fromSigned(value, normalized, c < 3 ? 511 : 1);
+            }
+            break;
+        }
+        case VertexFormat::Octahedral16: {
+            int16_t encoded[2];
+            std::memcpy(encoded, in, 4);
+            octahedralDecode(fromSigned(encoded[0], true, 32767), fromSigned(encoded[1], true, 32767), out);
+            break;
+        }
+    }
+}
+
+void PositionQuantization::Matrix(float matrix[16]) const {
+    for (int i = 0; i < 16; ++i) {
+        matrix[i] = 0.0f;
+    }
+    matrix[0] = scale[0];
+    matrix[5] = scale[1];
+    matrix[10] = scale[2];
+    matrix[12] = offset[0];
+    matrix[13] = offset[1];
+    matrix[14] = offset[2];
+    matrix[15] = 1.0f;
+}
+
+VertexLayout& VertexLayout::Add(VertexSemantic semantic, VertexFormat format, int components, bool normalized, int stream) {
+    bool packed = format == VertexFormat::Int2101010;
+    bool octahedral = format == VertexFormat::Octahedral16;
+    if (count_ >= kMaxAttributes || stream < 0 || stream >= kMaxStreams ||
+        components < (packed ? 3 : 1) || components > 4 || (octahedral && components != 3)) {
+        std::cout << "ERROR: INVALID VERTEX ATTRIBUTE" << std::endl;
+        return *this;
+    }
+
+    VertexAttribute& attribute = attributes_[count_++];
+    attribute.semantic = semantic;
+    attribute.format = format;
+    attribute.components = (uint8_t)components;
+    attribute.normalized = normalized || octahedral;
+    attribute.stream = (uint8_t)stream;
+    attribute.offset = (uint32_t)strides_[stream];
+
+    strides_[stream] += FormatSize(format, components);
+    streams_ = std::max(streams_, stream + 1);
+    sourceFloats_ += components;
+    return *this;
+}
+
+VertexLayout VertexLayout::PositionColor() {
+    VertexLayout layout;
+    layout.Add(VertexSemantic::Position, VertexFormat::Float, 3)
+          .Add(VertexSemantic::Color, VertexFormat::Float, 3);
+    return layout;
+}
+
+VertexLayout VertexLayout::PositionColorPacked() {
+    VertexLayout layout;
+    layout.Add(VertexSemantic::Position, VertexFormat::Half, 3)
+          .Add(VertexSemantic::Color, VertexFormat::UByte, 3, true);
+    return layout;
+}
+
+VertexLayout VertexLayout::Quantized(const VertexLayout& source, bool octahedralNormals) {
+    VertexLayout layout;
+    for (int a = 0; a < source.count_; ++a) {
+        const VertexAttribute& attribute = source.attributes_[a];
+        int components = attribute.components;
+        int stream = attribute.stream;
+        switch (attribute.semantic) {
+            case VertexSemantic::Position:
+                layout.Add(attribute.semantic, VertexFormat::UShort, components, true, stream);
+                break;
+            case VertexSemantic::Normal:
+                if (octahedralNormals && components == 3) {
+                    layout.Add(attribute.semantic, VertexFormat::Octahedral16, 3, true, stream);
+                } else {
+                    layout.Add(attribute.semantic, VertexFormat::Int2101010, std::max(components, 3), true, stream);
+                }
+                break;
+            case VertexSemantic::Tangent:
+                //w is the handedness sign, 2 bits are plenty
+                layout.Add(attribute.semantic, VertexFormat::Int2101010, std::max(components, 3), true, stream);
+                break;
+            case VertexSemantic::Color:
+                layout.Add(attribute.semantic, VertexFormat::UByte, components, true, stream);
+                break;
+            case VertexSemantic::TexCoord0:
+            case VertexSemantic::TexCoord1:
+                layout.Add(attribute.semantic, VertexFormat::Half, components, false, stream);
+                break;
+        }
+    }
+    return layout;
+}
+
+PositionQuantization VertexLayout::QuantizePositions(const float min[3], const float max[3]) const {
+    PositionQuantization quantization;
+    for (int a = 0; a < count_; ++a) {
+        const VertexAttribute& attribute = attributes_[a];
+        if (attribute.semantic != VertexSemantic::Position || !attribute.normalized) {
+            continue;
+        }
+        bool isSigned = attribute.format == VertexFormat::Short || attribute.format == VertexFormat::Byte ||
+                        attribute.format == VertexFormat::Int2101010;
+        bool isUnsigned = attribute.format == VertexFormat::UShort || attribute.format == VertexFormat::UByte;
+        if (!isSigned && !isUnsigned) {
+            break;
+        }
+        for (int c = 0; c < 3; ++c) {
+            float extent = max[c] - min[c];
+            //flat axis: any scale works, 1 keeps the matrix invertible
+            if (extent <= 0.0f) {
+                extent = isSigned ? 2.0f : 1.0f;
+            }
+            //unsigned formats cover [0, 1] -> [min, max], signed ones [-1, 1] -> [min, max]
+            quantization.scale[c] = isSigned ? extent * 0.5f : extent;
+            quantization.offset[c] = isSigned ? (min[c] + max[c]) * 0.5f : min[c];
+        }
+        quantization.enabled = true;
+        break;
+    }
+    return quantization;
+}
+
+std::size_t VertexLayout::VertexBytes() const {
+    std::size_t bytes = 0;
+    for (int stream = 0; stream < streams_; ++stream) {
+        bytes += strides_[stream];
+    }
+    return bytes;
+}
+
+bool VertexLayout::MatchesSource() const {
+    if (streams_ != 1) {
+        return false;
+    }
+    for (int a = 0; a < count_; ++a) {
+        if (attributes_[a].format != VertexFormat::Float) {
+            return false;
+        }
+    }
+    //float attributes are never padded, so the stride equals the source vertex exactly
+    return true;
+}
+
+void VertexLayout::Pack(const float* source, std::size_t vertexCount, std::vector<uint8_t> streams[kMaxStreams],
+                        const PositionQuantization* positions) const {
+    for (int stream = 0; stream < streams_; ++stream) {
+        //zero filled, so the padding is deterministic
+        streams[stream].assign(vertexCount * strides_[stream], 0);
+    }
+
+    std::size_t sourceOffset = 0;
+    for (int a = 0; a < count_; ++a) {
+        const VertexAttribute& attribute = attributes_[a];
+        std::size_t stride = strides_[attribute.stream];
+        uint8_t* out = streams[attribute.stream].data() + attribute.offset;
+        const float* in = source + sourceOffset;
+        bool remap = positions && positions->enabled && attribute.semantic == VertexSemantic::Position;
+
+        for (std::size_t v = 0; v < vertexCount; ++v, out += stride, in += sourceFloats_) {
+            if (remap) {
+                float remapped[4];
+                for (int c = 0; c < attribute.components; ++c) {
+                    remapped[c] = c < 3 ? (in[c] - positions->offset[c]) / positions->scale[c] : in[c];
+                }
+                packAttribute(attribute, remapped, out);
+            } else {
+                packAttribute(attribute, in, out);
+            }
+        }
+        sourceOffset += attribute.components;
+    }
+}
+
+void VertexLayout::Unpack(const std::vector<uint8_t> streams[kMaxStreams], std::size_t vertexCount, float* destination,
+                          const PositionQuantization* positions) const {
+    std::size_t destinationOffset = 0;
+    for (int a = 0; a < count_; ++a) {
+        const VertexAttribute& attribute = attributes_[a];
+        std::size_t stride = strides_[attribute.stream];
+        const uint8_t* in = streams[attribute.stream].data() + attribute.offset;
+        float* out = destination + destinationOffset;
+        bool remap = positions && positions->enabled && attribute.semantic == VertexSemantic::Position;
+
+        for (std::size_t v = 0; v < vertexCount; ++v, in += stride, out += sourceFloats_) {
+            unpackAttribute(attribute, in, out);
+            if (remap) {
+                for (int c = 0; c < attribute.components && c < 3; ++c) {
+                    out[c] = out[c] * positions->scale[c] + positions->offset[c];
+                }
+            }
+        }
+        destinationOffset += attribute.components;
+    }
+}
+
+QuantizationError VertexLayout::MeasureError(const float* source, std::size_t vertexCount, const std::vector<uint8_t> streams[kMaxStreams],
+                                             const PositionQuantization* positions) const {
+    std::vector<float> decoded(vertexCount * sourceFloats_);
+    Unpack(streams, vertexCount, decoded.data(), positions);
+
+    QuantizationError error;
+    std::size_t offset = 0;
+    for (int a = 0; a < count_; ++a) {
+        const VertexAttribute& attribute = attributes_[a];
+        int components = attribute.components;
+        bool direction = attribute.semantic == VertexSemantic::Normal || attribute.semantic == VertexSemantic::Tangent;
+        float worst = 0.0f;
+
+        for (std::size_t v = 0; v < vertexCount; ++v) {
+            const float* original = source + v * sourceFloats_ + offset;
+            const float* result = decoded.data() + v * sourceFloats_ + offset;
+            if (direction) {
+                //angle between the directions, the formats don't keep the length
+                float dot = 0.0f, lengthA = 0.0f, lengthB = 0.0f;
+                for (int c = 0; c < 3; ++c) {
+                    dot += original[c] * result[c];
+                    lengthA += original[c] * original[c];
+                    lengthB += result[c] * result[c];
+                }
+                if (lengthA > 0.0f && lengthB > 0.0f) {
+                    float cosine = std::min(std::max(dot / std::sqrt(lengthA * lengthB), -1.0f), 1.0f);
+                    worst = std::max(worst, std::acos(cosine) * 57.29578f);
+                }
+            } else {
+                for (int c = 0; c < components; ++c) {
+                    worst = std::max(worst, std::fabs(original[c] - result[c]));
+                }
+            }
+        }
+
+        switch (attribute.semantic) {
+            case VertexSemantic::Position: error.position = std::max(error.position, worst); break;
+            case VertexSemantic::Color: error.color = std::max(error.color, worst); break;
+            case VertexSemantic::Normal:
+            case VertexSemantic::Tangent: error.normal = std::max(error.normal, worst); break;
+            case VertexSemantic::TexCoord0:
+            case VertexSemantic::TexCoord1: error.texCoord = std::max(error.texCoord, worst); break;
+        }
+        offset += components;
+    }
+    return error;
+}
+
+void VertexLayout::Apply(const GLuint* buffers) const {
+    GLState& state = GLState::Get();
+    for (int a = 0; a < count_; ++a) {
+        const VertexAttribute& attribute = attributes_[a];
+        GLuint location = Location(attribute.semantic);
+        //the packed format always has 4 components on the GL side, w is 0 when the source had 3,
+        //octahedral normals are 2 components that the shader turns back into 3
+        GLint size = attribute.components;
+        if (attribute.format == VertexFormat::Int2101010) {
+            size = 4;
+        } else if (attribute.format == VertexFormat::Octahedral16) {
+            size = 2;
+        }
+
+        state.BindBuffer(GL_ARRAY_BUFFER, buffers[attribute.stream]);
+        glVertexAttribPointer(location, size, GLType(attribute.format), attribute.normalized ? GL_TRUE : GL_FALSE,
+                              (GLsizei)strides_[attribute.stream], (const void*)(std::size_t)attribute.offset);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+GLuint VertexLayout::Location(VertexSemantic semantic) {
+    switch (semantic) {
+        case VertexSemantic::Position: return 0;
+        case VertexSemantic::Color: return 1;
+        case VertexSemantic::Normal: return 2;
+        case VertexSemantic::TexCoord0: return 7;
+        case VertexSemantic::TexCoord1: return 8;
+        case VertexSemantic::Tangent: return 9;
+    }
+    return 0;
+}
+
+std::size_t VertexLayout::FormatSize(VertexFormat format, int components) {
+    std::size_t size = 0;
+    switch (format) {
+        case VertexFormat::Float: size = 4 * components; break;
+        case VertexFormat::Half: size = 2 * components; break;
+        case VertexFormat::UByte: size = components; break;
+        case VertexFormat::Byte: size = components; break;
+        case VertexFormat::UShort: size = 2 * components; break;
+        case VertexFormat::Short: size = 2 * components; break;
+        case VertexFormat::Int2101010: size = 4; break;
+        case VertexFormat::Octahedral16: size = 4; break;
+    }
+    return (size + 3) & ~(std::size_t)3;
+}
+
+GLenum VertexLayout::GLType(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::Float: return GL_FLOAT;
+        case VertexFormat::Half: return GL_HALF_FLOAT;
+        case VertexFormat::UByte: return GL_UNSIGNED_BYTE;
+        case VertexFormat::Byte: return GL_BYTE;
+        case VertexFormat::UShort: return GL_UNSIGNED_SHORT;
+        case VertexFormat::Short: return GL_SHORT;
+        case VertexFormat::Int2101010: return GL_INT_2_10_10_10_REV;
+        case VertexFormat::Octahedral16: return GL_SHORT;
+    }
+    return GL_FLOAT;
+}
@@ -1,30 +1,36 @@
 #include "../include/glad/glad.h"
 #include <GLFW/glfw3.h>
+#include "HeadlessContext.h"
+#include "Framebuffer.h"
+#include "GLExtensions.h"
+#include "ShaderManager.h"
+#include "Mesh.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "GltfLoader.h"
+#include "AssetStreamer.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 
-//vertex shader
-//TODO: implement shader class to handle shader compilation and linking
-const char* vertexShaderSource = "#version 330 core\n"
-                                    "layout (location = 0) in vec3 aPos;\n"
-                                    "void main()\n"
-                                    "{\n"
-                                    "   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
-                                    "}\0";
-
-//fragment shader
-const char* fragmentShaderSource = "#version 330 core\n"
-                                   "out vec4 FragColor;\n"
-                                   "void main()\n"
-                                   "{\n"
-                                   "   FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
-                                   "}\0";
+//shaders are loaded from disk by the ShaderManager, MENACE_SHADER_DIR is set by cmake
+#ifndef MENACE_SHADER_DIR
+#define MENACE_SHADER_DIR "shaders"
+#endif
 
 
 //adjust viewport size when window is resized
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::Get().Viewport(0, 0, width, height);
 }
 
 void processInputEscape(GLFWwindow* window)
@@ -35,30 +41,150 @@ void processInputEscape(GLFWwindow* window)
     }
 }
 
-int main()
+//command line options, e.g. `Menace_Graphics --headless --width 1280 --height 720 --frames 300 --output frame`
+struct Options {
+    bool headless = false;
+    int width = 0;              //0 = native resolution of the primary monitor (1920 when headless)
+    int height = 0;             //0 = native resolution of the primary monitor (1080 when headless)
+    int frames = 0;             //0 = run until the window is closed (1 frame when headless)
+    std::string outputPrefix;   //headless only, writes <prefix>_<frame>.ppm for every frame read back
+    std::string scenePath;      //.glb / .gltf, streamed in and drawn once it is uploaded
+    int uploadBudgetKB = 4096;  //bytes the AssetStreamer moves to the GPU per frame
+    bool gpuCulling = false;    //asks for a 4.3 context and culls / draws the scene with GpuCuller, 3.3 falls back to the CPU
+    bool occlusion = false;     //GPU culling plus the two phase depth pyramid test
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+            options.width = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.height = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.outputPrefix = argv[++i];
+        } else if (std::strcmp(argv[i], "--scene") == 0 && hasValue) {
+            options.scenePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--upload-budget") == 0 && hasValue) {
+            options.uploadBudgetKB = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--gpu-culling") == 0) {
+            options.gpuCulling = true;
+        } else if (std::strcmp(argv[i], "--occlusion") == 0) {
+            options.gpuCulling = true;
+            options.occlusion = true;
+        } else {
+            std::cout << "usage: " << argv[0] << " [--headless] [--width W] [--height H] [--frames N] [--output PREFIX]"
+                      << " [--scene FILE.glb] [--upload-budget KB] [--gpu-culling] [--occlusion]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//a glTF scene streaming in, the AssetStreamer owns its meshes
+struct StreamedScene {
+    AssetStreamer::Handle asset = 0;
+    bool instantiated = false;
+    std::vector<Object3D> objects;
+};
+
+//places the scene's objects as soon as its meshes and its program are ready, never waits for either,
+//with GPU culling the objects are uploaded to the GpuCuller once here
+static void updateScene(StreamedScene& streamed, const AssetStreamer& streamer, ShaderManager& shaderManager, GpuCuller* gpuCuller)
+{
+    const GltfScene* scene = streamer.GetScene(streamed.asset);
+    if (streamed.instantiated || !scene || !shaderManager.IsReady("instanced")) {
+        return;
+    }
+    streamed.instantiated = true;
+
+    //there is no camera yet, so scale and center the scene into clip space
+    float extent = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        extent = std::max(extent, scene->boundsMax[c] - scene->boundsMin[c]);
+    }
+    float scale = extent > 0.0f ? 1.8f / extent : 1.0f;
+    float root[16] = { scale, 0, 0, 0,  0, scale, 0, 0,  0, 0, scale, 0,  0, 0, 0, 1 };
+    for (int c = 0; c < 3; ++c) {
+        root[12 + c] = -0.5f * (scene->boundsMin[c] + scene->boundsMax[c]) * scale;
+    }
+    GltfLoader::Instantiate(*scene, shaderManager.Get("instanced"), streamer.GetMeshes(streamed.asset), streamed.objects, root);
+    if (gpuCuller) {
+        gpuCuller->SetObjects(streamed.objects);
+    }
+
+    const AssetStreamer::Stats& stats = streamer.GetStats();
+    std::cout << "SCENE LOADED: " << streamed.objects.size() << " objects, " << scene->stats.zeroCopyPrimitives << " zero copy / "
+              << scene->stats.convertedPrimitives << " converted primitives, decode " << stats.decodeMs << " ms (worker), "
+              << stats.bytesUploaded << " bytes uploaded, slowest frame update " << stats.maxUpdateMs << " ms" << std::endl;
+}
+
+//everything drawn in one frame, shared by the window and the headless loop
+//`gpuCuller` null = cull on the CPU and draw through the renderer, `target` is the framebuffer drawn to,
+//its depth feeds the GpuCuller's occlusion test
+static void renderFrame(Renderer& renderer, FrustumCuller& culler, GpuCuller* gpuCuller, GLuint shaderProgram, Mesh& mesh,
+                        const std::vector<Object3D>& objects, GLuint target, int width, int height)
+{
+    glClearColor(0.2f, 0.9f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    //everything goes through the renderer's queue, it sorts and binds only what changed
+    renderer.BeginFrame();
+    renderer.Submit(mesh, shaderProgram);
+    //only what is on screen gets drawn, with no camera yet the frustum is clip space itself
+    Mat4 viewProjection;
+    if (!gpuCuller) {
+        for (uint32_t index : culler.Cull(Frustum::FromMatrix(viewProjection), objects)) {
+            renderer.Submit(objects[index]);
+        }
+    }
+    renderer.Flush();
+    if (gpuCuller) {
+        gpuCuller->Cull(viewProjection);
+        gpuCuller->Draw();
+        //with occlusion on, a second pass for what the depth of the first one does not hide
+        if (gpuCuller->CullOccluded(target, width, height)) {
+            gpuCuller->Draw();
+        }
+    }
+}
+
+//creates the window at native resolution (or the size given on the command line) and loads GLAD for it
+static GLFWwindow* initWindow(Options& options)
 {
-    //--------------------------------------------------INITIALIZATION----------------------------------------------------------------------
     //initialize GLFW library
     if (!glfwInit()) {
-        return -1;
+        return nullptr;
     }
     std::cout << "Hello, World!" << std::endl;
 
-    //sets version of openGL to 3.3
+    //sets version of openGL to 3.3 (4.3 for --gpu-culling)
     //set openGL profile to core profile, bear this in mind if you decide to gitignore include directory
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); 
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, options.gpuCulling ? 4 : 3); 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); 
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    //get window size based on native resolution
+    //get window size based on native resolution, unless overridden on the command line
     const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (options.width <= 0) options.width = mode->width;
+    if (options.height <= 0) options.height = mode->height;
 
     //Create window
-    GLFWwindow* window = glfwCreateWindow(mode->width, mode->height, "Menace Graphics", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "Menace Graphics", NULL, NULL);
+    if (!window && options.gpuCulling) {
+        //no 4.3 driver, the CPU culling path only needs 3.3
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(options.width, options.height, "Menace Graphics", NULL, NULL);
+    }
     if (!window) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return -1;
+        return nullptr;
     }
 
     //make window's context current, i.e. use the `window` variable's settings and resources for rendering
@@ -67,120 +193,177 @@ int main()
     //initialize GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        glfwTerminate();
+        return nullptr;
     }
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
     //set viewport size
-    glViewport(0, 0, mode->width, mode->height);
+    GLState::Get().Viewport(0, 0, options.width, options.height);
 
     //when window is resized, adjust viewport size accordingly using callback function
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    return window;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return -1;
+    }
+
+    //--------------------------------------------------INITIALIZATION----------------------------------------------------------------------
+    GLFWwindow* window = nullptr;
+    HeadlessContext headlessContext;
+    Framebuffer framebuffer;
+
+    if (options.headless) {
+        //no window, no swap chain: an EGL context renders into an offscreen framebuffer
+        if (!(options.gpuCulling && headlessContext.Create(4, 3)) && !headlessContext.Create(3, 3)) {
+            return -1;
+        }
+        if (options.width <= 0) options.width = 1920;
+        if (options.height <= 0) options.height = 1080;
+        if (options.frames <= 0) options.frames = 1;
+
+        if (!framebuffer.Create(options.width, options.height)) {
+            return -1;
+        }
+        framebuffer.Bind();
+    } else {
+        window = initWindow(options);
+        if (!window) {
+            return -1;
+        }
+    }
+
     //--------------------------------------------------END OF INITIALIZATION---------------------------------------------------------------
 
     //TESTING TRIANGLE 
-    GLfloat vertices[] = {
-        -0.5f, -0.5f, 0.0f,
-         0.5f, -0.5f, 0.0f,
-         0.0f,  0.5f, 0.0f
+    std::vector<float> vertices = {
+        // positions          // colors
+        -0.5f, -0.5f, 0.0f,   1.0f, 0.0f, 0.0f,
+         0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,
+         0.0f,  0.5f, 0.0f,   0.0f, 0.0f, 1.0f
     };
 
     //--------------------------------------------------SETTING UP SHADERS----------------------------------------------------------------------
     /**
      * note: shaders are written in GLSL, and stored in the VRAM, and are compiled and linked to GPU
-     * I will make a shader class to handle this, for now i write here to visualize graphics pipeline
-     
+     * the ShaderManager compiles + links them once and keeps the driver binary in shader_cache/,
+     * later launches load that binary instead of compiling again
     */
+    ShaderManager shaderManager;
 
-    //creates a shader in the VRAM, returns the ID of the shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-
-    //places the shader code in the shader object in the VRAM
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-
-    //compiles the shader source code stored in the shader object in the VRAM 
-    glCompileShader(vertexShader);
-
-    //check if the shader compilation was successful
-    int success;
-    char infoLog[512]; 
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR: VERTEX SHADER COMPILATION FAILED\n" << infoLog << std::endl;
+    //compiles are submitted up front and finished by shaderManager.Update() in the render loop,
+    //until "basic" is ready the loop draws with the manager's fallback program instead of waiting
+    if (!shaderManager.RequestProgram("basic",
+                                      MENACE_SHADER_DIR "/vertex_shader.glsl",
+                                      MENACE_SHADER_DIR "/fragment_shader.glsl")) {
+        return -1;
     }
 
-    //fragment shader, same routine
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR: FRAGMENT SHADER COMPILATION FAILED\n" << infoLog << std::endl;
+    //assets are decoded by worker threads, the render loop only pays for a bounded upload every frame
+    AssetStreamer streamer;
+    AssetStreamer::Options streamOptions;
+    streamOptions.bytesPerFrame = (std::size_t)std::max(options.uploadBudgetKB, 1) * 1024;
+    if (!streamer.Create(streamOptions)) {
+        return -1;
     }
-
-    //SHADER PROGRAM
-    GLuint shaderProgram = glCreateProgram();
-
-    //attach shaders to the program 
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-
-    //link the program
-    glLinkProgram(shaderProgram);
-
-    //delete after linking
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR: SHADER PROGRAM LINKING FAILED\n" << infoLog << std::endl;
-    } else {
-        std::cout << "SHADER PROGRAM LINKING SUCCESSFUL" << std::endl;
+    StreamedScene streamedScene;
+    if (!options.scenePath.empty()) {
+        if (!shaderManager.RequestProgram("instanced",
+                                          MENACE_SHADER_DIR "/instanced_vertex_shader.glsl",
+                                          MENACE_SHADER_DIR "/fragment_shader.glsl")) {
+            return -1;
+        }
+        streamedScene.asset = streamer.Request(options.scenePath);
     }
 
-    //the next rendering loop will use this shader program, i.e. shaders on the VRAM
-    glUseProgram(shaderProgram);
-
     //--------------------------------------------------END OF SETTING UP SHADERS---------------------------------------------------------------
 
     //--------------------------------------------------SETTING UP VERTEX ATTRIBUTES AND BUFFERS----------------------------------------------------------------------
 
-    GLuint VBO;
-    GLuint VAO;
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); //actually storing the buffer data in the VRAM
-
-    glGenVertexArrays(1, &VAO);
-
-    glBindVertexArray(VAO);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    glEnableVertexAttribArray(0);
-
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    //the Mesh owns the VAO/VBO/EBO, the destructor needs the context so it is released before the context is
+    //nothing reads the vertices back, so the CPU copy is dropped after the upload
+    std::unique_ptr<Mesh> triangle = std::make_unique<Mesh>(vertices, vertices.size() * sizeof(float), true, false);
+
+    Renderer renderer;
+    FrustumCuller culler;
+    culler.Create();
+    //null unless --gpu-culling / --occlusion got a 4.3 context
+    GpuCuller gpuCulling;
+    GpuCuller* gpuCuller = nullptr;
+    if (options.gpuCulling) {
+        GpuCuller::Options cullingOptions;
+        cullingOptions.occlusion = options.occlusion;
+        if (GpuCuller::Supported() && gpuCulling.Create(cullingOptions)) {
+            gpuCuller = &gpuCulling;
+        } else {
+            std::cout << "GPU CULLING UNAVAILABLE, CULLING ON THE CPU" << std::endl;
+        }
+    }
 
+    if (options.headless) {
+        //headless output should be deterministic, so no fallback frames here
+        shaderManager.WaitAll();
+        if (!shaderManager.IsReady("basic")) {
+            return -1;
+        }
+        std::cout << "SHADER PROGRAM LOADED in " << shaderManager.GetStats().loadMs << " ms"
+                  << (shaderManager.GetStats().cacheHits ? " (binary cache)" : "") << std::endl;
+
+        //same for the scene, every frame should have it
+        streamer.Finish();
+        updateScene(streamedScene, streamer, shaderManager, gpuCuller);
+
+        //headless loop: no swap, no events, every frame is read back so the timing includes the readback
+        std::vector<unsigned char> pixels;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < options.frames; ++frame) {
+            renderFrame(renderer, culler, gpuCuller, shaderManager.Get("basic"), *triangle, streamedScene.objects, framebuffer.Handle(),
+                        framebuffer.Width(), framebuffer.Height());
+            framebuffer.ReadPixels(pixels);
+
+            if (!options.outputPrefix.empty()) {
+                framebuffer.WritePPM(options.outputPrefix + "_" + std::to_string(frame) + ".ppm", pixels);
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "HEADLESS: " << options.frames << " frames at " << options.width << "x" << options.height
+                  << " in " << seconds << " s (" << options.frames / seconds << " fps)" << std::endl;
+
+        triangle.reset();
+        streamedScene.objects.clear();
+        streamer.Destroy();
+        renderer.Clear();
+        gpuCulling.Destroy();
+        shaderManager.Clear();
+        framebuffer.Destroy();
+        headlessContext.Destroy();
+        return 0;
+    }
 
     //render loop
-    while(!glfwWindowShouldClose(window)) {
+    int frame = 0;
+    while(!glfwWindowShouldClose(window) && (options.frames <= 0 || frame < options.frames)) {
 
         //process input 
         processInputEscape(window);
 
+        //finish whatever the shader compiler is done with
+        shaderManager.Update();
+        streamer.Update();
+        updateScene(streamedScene, streamer, shaderManager, gpuCuller);
+
         //rendering commands
-        glClearColor(0.2f, 0.9f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        renderFrame(renderer, culler, gpuCuller, shaderManager.GetOrFallback("basic"), *triangle, streamedScene.objects, 0, width, height);
 
         //swap buffers
         glfwSwapBuffers(window);
@@ -188,8 +371,16 @@ int main()
         //process events 
         glfwPollEvents();
 
+        ++frame;
     }
 
+    //gl objects must go before the context does
+    triangle.reset();
+    streamedScene.objects.clear();
+    streamer.Destroy();
+    renderer.Clear();
+    gpuCulling.Destroy();
+    shaderManager.Clear();
     glfwTerminate();//clean up resources
 
     return 0;